@@ -0,0 +1,99 @@
+/*!
+ * MCTAttributeIndex.m
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+#import "MCTAttributeIndex.h"
+
+@interface MCTAttributeIndex ()
+
+@property (nonatomic, strong, readonly) NSMutableDictionary<id, NSManagedObjectID *> *objectIDs;
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSManagedObjectID *, id> *values;
+
+@end
+
+@implementation MCTAttributeIndex
+
+- (instancetype)initWithKey:(NSString *)key {
+    self = [super init];
+    if (self) {
+        _key = [key copy];
+        _objectIDs = [[NSMutableDictionary alloc] init];
+        _values = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (NSUInteger)count {
+    return self.objectIDs.count;
+}
+
+- (NSManagedObjectID *)objectIDForValue:(id)value {
+    return self.objectIDs[value];
+}
+
+- (void)addObject:(NSManagedObject *)object {
+    NSManagedObjectID *objectID = object.objectID;
+    if (object.isFault || object.isDeleted) {
+        [self removeObjectID:objectID];
+        return;
+    }
+    id value = [object valueForKey:self.key];
+    id previous = self.values[objectID];
+    if (previous && [previous isEqual:value]) {
+        return;
+    }
+    [self removeObjectID:objectID];
+    if (!value) {
+        return;
+    }
+    NSManagedObjectID *replaced = self.objectIDs[value];
+    if (replaced && ![replaced isEqual:objectID] && [self.values[replaced] isEqual:value]) {
+        // Usually the temporary ID the object had before it was saved.
+        [self.values removeObjectForKey:replaced];
+    }
+    self.objectIDs[value] = objectID;
+    self.values[objectID] = value;
+}
+
+- (void)removeObjectID:(NSManagedObjectID *)objectID {
+    id value = self.values[objectID];
+    if (!value) {
+        return;
+    }
+    [self.values removeObjectForKey:objectID];
+    if ([self.objectIDs[value] isEqual:objectID]) {
+        [self.objectIDs removeObjectForKey:value];
+    }
+}
+
+- (void)removeAllObjects {
+    [self.objectIDs removeAllObjects];
+    [self.values removeAllObjects];
+}
+
+@end
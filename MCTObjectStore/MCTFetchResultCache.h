@@ -0,0 +1,88 @@
+/*!
+ * MCTFetchResultCache.h
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+#ifndef MCTObjectStore_MCTFetchResultCache_h
+#define MCTObjectStore_MCTFetchResultCache_h
+
+@import Foundation;
+@import CoreData;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  The names of the entities whose changes can affect a fetch of `entity` with the predicate and sort descriptors: the
+ *  entity itself and every entity reached through a relationship key path.
+ *
+ *  Returns nil if the dependencies can't be worked out, e.g. for SUBQUERY or unknown keys.
+ */
+FOUNDATION_EXTERN NSSet<NSString *> *_Nullable MCTDependentEntityNames(NSEntityDescription *entity, NSPredicate *_Nullable predicate, NSArray<NSSortDescriptor *> *_Nullable sortDescriptors);
+
+/**
+ *  Object IDs returned by fetch requests, keyed by entity, predicate and sort descriptors.
+ *
+ *  Each result remembers which entities it depends on, the fetched entity and any entity reached through a relationship
+ *  in the predicate or sort descriptors, and is invalidated when an object of one of those entities changes.  Results
+ *  whose dependencies can't be worked out are invalidated by any change.
+ */
+@interface MCTFetchResultCache : NSObject
+
+- (instancetype)initWithCountLimit:(NSUInteger)countLimit NS_DESIGNATED_INITIALIZER;
+
+/**
+ *  The most results held before the least recently used is evicted.
+ */
+@property (atomic, assign) NSUInteger countLimit;
+@property (atomic, assign, readonly) NSUInteger count;
+
+/**
+ *  Incremented by every invalidation.  Pass the value read before fetching to `setObjects:...` so a result that raced
+ *  with an invalidation isn't stored.
+ */
+@property (atomic, assign, readonly) NSUInteger generation;
+
+@property (atomic, assign, readonly) uint64_t hitCount;
+@property (atomic, assign, readonly) uint64_t missCount;
+
+- (nullable NSArray<NSManagedObjectID *> *)objectIDsForFetchRequest:(NSFetchRequest *)fetchRequest;
+- (void)setObjects:(NSArray<NSManagedObject *> *)objects forFetchRequest:(NSFetchRequest *)fetchRequest entity:(NSEntityDescription *)entity generation:(NSUInteger)generation;
+
+/**
+ *  Invalidate the results that depend on the entities of the passed NSManagedObjects or NSManagedObjectIDs.
+ */
+- (void)invalidateObjects:(id<NSFastEnumeration>)objects;
+- (void)invalidateEntityNames:(NSSet<NSString *> *)entityNames;
+- (void)removeAllObjects;
+
+- (void)resetStatistics;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
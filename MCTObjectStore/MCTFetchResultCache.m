@@ -0,0 +1,326 @@
+/*!
+ * MCTFetchResultCache.m
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+@import Darwin.POSIX.pthread;
+
+#import "MCTFetchResultCache.h"
+
+// MARK: - Dependencies
+static BOOL MCTCollectKeyPathEntities(NSString *keyPath, NSEntityDescription *entity, NSMutableSet *names) {
+    NSEntityDescription *current = entity;
+    for (NSString *component in [keyPath componentsSeparatedByString:@"."]) {
+        if ([component hasPrefix:@"@"] || component.length == 0) {
+            continue;
+        }
+        if (!current) {
+            // Walked past an attribute.
+            return YES;
+        }
+        NSRelationshipDescription *relationship = current.relationshipsByName[component];
+        if (relationship) {
+            current = relationship.destinationEntity;
+            if (!current.name) {
+                return NO;
+            }
+            [names addObject:current.name];
+            continue;
+        }
+        if (!current.propertiesByName[component]) {
+            return NO;
+        }
+        current = nil;
+    }
+    return YES;
+}
+
+static BOOL MCTCollectPredicateEntities(NSPredicate *predicate, NSEntityDescription *entity, NSMutableSet *names);
+
+static BOOL MCTCollectExpressionEntities(NSExpression *expression, NSEntityDescription *entity, NSMutableSet *names) {
+    if (!expression) {
+        return YES;
+    }
+    switch (expression.expressionType) {
+        case NSConstantValueExpressionType:
+        case NSEvaluatedObjectExpressionType:
+            return YES;
+        case NSKeyPathExpressionType:
+            return MCTCollectKeyPathEntities(expression.keyPath, entity, names);
+        case NSFunctionExpressionType:
+            if (expression.operand.expressionType != NSEvaluatedObjectExpressionType && !MCTCollectExpressionEntities(expression.operand, entity, names)) {
+                return NO;
+            }
+            for (NSExpression *argument in expression.arguments) {
+                if (!MCTCollectExpressionEntities(argument, entity, names)) {
+                    return NO;
+                }
+            }
+            return YES;
+        case NSAggregateExpressionType:
+            for (id value in expression.collection) {
+                if ([value isKindOfClass:[NSExpression class]] && !MCTCollectExpressionEntities(value, entity, names)) {
+                    return NO;
+                }
+            }
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+static BOOL MCTCollectPredicateEntities(NSPredicate *predicate, NSEntityDescription *entity, NSMutableSet *names) {
+    if (!predicate) {
+        return YES;
+    }
+    if ([predicate isKindOfClass:[NSCompoundPredicate class]]) {
+        for (NSPredicate *subpredicate in [(NSCompoundPredicate *)predicate subpredicates]) {
+            if (!MCTCollectPredicateEntities(subpredicate, entity, names)) {
+                return NO;
+            }
+        }
+        return YES;
+    }
+    if ([predicate isKindOfClass:[NSComparisonPredicate class]]) {
+        NSComparisonPredicate *comparison = (NSComparisonPredicate *)predicate;
+        return (MCTCollectExpressionEntities(comparison.leftExpression, entity, names) && MCTCollectExpressionEntities(comparison.rightExpression, entity, names));
+    }
+    NSString *format = predicate.predicateFormat;
+    return ([format isEqualToString:@"TRUEPREDICATE"] || [format isEqualToString:@"FALSEPREDICATE"]);
+}
+
+NSSet<NSString *> *MCTDependentEntityNames(NSEntityDescription *entity, NSPredicate *predicate, NSArray<NSSortDescriptor *> *sortDescriptors) {
+    NSMutableSet *names = [NSMutableSet setWithObject:entity.name];
+    if (!MCTCollectPredicateEntities(predicate, entity, names)) {
+        return nil;
+    }
+    for (NSSortDescriptor *descriptor in sortDescriptors) {
+        if (!descriptor.key || !MCTCollectKeyPathEntities(descriptor.key, entity, names)) {
+            return nil;
+        }
+    }
+    return names;
+}
+
+// MARK: - Entry
+@interface MCTFetchResultCacheEntry : NSObject
+
+@property (nonatomic, copy) NSArray<NSManagedObjectID *> *objectIDs;
+@property (nonatomic, copy, nullable) NSSet<NSString *> *entityNames;
+@property (nonatomic, assign) uint64_t lastAccess;
+
+@end
+
+@implementation MCTFetchResultCacheEntry
+
+@end
+
+// MARK: - Cache
+@interface MCTFetchResultCache () {
+    pthread_mutex_t _mutex;
+    NSMutableDictionary<NSArray *, MCTFetchResultCacheEntry *> *_entries;
+    NSUInteger _countLimit;
+    NSUInteger _generation;
+    uint64_t _tick;
+    uint64_t _hitCount;
+    uint64_t _missCount;
+}
+
+@end
+
+@implementation MCTFetchResultCache
+
+- (instancetype)init {
+    return [self initWithCountLimit:100];
+}
+- (instancetype)initWithCountLimit:(NSUInteger)countLimit {
+    self = [super init];
+    if (self) {
+        pthread_mutex_init(&_mutex, NULL);
+        _entries = [[NSMutableDictionary alloc] init];
+        _countLimit = countLimit;
+    }
+    return self;
+}
+- (void)dealloc {
+    pthread_mutex_destroy(&_mutex);
+}
+
+// MARK: - Properties
+- (NSUInteger)countLimit {
+    pthread_mutex_lock(&_mutex);
+    NSUInteger limit = _countLimit;
+    pthread_mutex_unlock(&_mutex);
+    return limit;
+}
+- (void)setCountLimit:(NSUInteger)countLimit {
+    pthread_mutex_lock(&_mutex);
+    _countLimit = countLimit;
+    [self evictToCount:countLimit];
+    pthread_mutex_unlock(&_mutex);
+}
+- (NSUInteger)count {
+    pthread_mutex_lock(&_mutex);
+    NSUInteger count = _entries.count;
+    pthread_mutex_unlock(&_mutex);
+    return count;
+}
+- (NSUInteger)generation {
+    pthread_mutex_lock(&_mutex);
+    NSUInteger generation = _generation;
+    pthread_mutex_unlock(&_mutex);
+    return generation;
+}
+- (uint64_t)hitCount {
+    pthread_mutex_lock(&_mutex);
+    uint64_t count = _hitCount;
+    pthread_mutex_unlock(&_mutex);
+    return count;
+}
+- (uint64_t)missCount {
+    pthread_mutex_lock(&_mutex);
+    uint64_t count = _missCount;
+    pthread_mutex_unlock(&_mutex);
+    return count;
+}
+- (void)resetStatistics {
+    pthread_mutex_lock(&_mutex);
+    _hitCount = 0;
+    _missCount = 0;
+    pthread_mutex_unlock(&_mutex);
+}
+
+// MARK: - Access
++ (NSArray *)keyForFetchRequest:(NSFetchRequest *)fetchRequest {
+    return @[
+             fetchRequest.entityName ?: fetchRequest.entity.name ?: @"",
+             fetchRequest.predicate ?: [NSNull null],
+             fetchRequest.sortDescriptors ?: @[]
+             ];
+}
+- (NSArray<NSManagedObjectID *> *)objectIDsForFetchRequest:(NSFetchRequest *)fetchRequest {
+    NSArray *key = [self.class keyForFetchRequest:fetchRequest];
+    pthread_mutex_lock(&_mutex);
+    MCTFetchResultCacheEntry *entry = _entries[key];
+    if (entry) {
+        entry.lastAccess = ++_tick;
+        _hitCount++;
+    } else {
+        _missCount++;
+    }
+    NSArray *objectIDs = entry.objectIDs;
+    pthread_mutex_unlock(&_mutex);
+    return objectIDs;
+}
+- (void)setObjects:(NSArray<NSManagedObject *> *)objects forFetchRequest:(NSFetchRequest *)fetchRequest entity:(NSEntityDescription *)entity generation:(NSUInteger)generation {
+    NSMutableArray *objectIDs = [NSMutableArray arrayWithCapacity:objects.count];
+    for (NSManagedObject *object in objects) {
+        NSManagedObjectID *objectID = object.objectID;
+        if (objectID.isTemporaryID) {
+            // Temporary IDs are replaced when the object is saved.
+            return;
+        }
+        [objectIDs addObject:objectID];
+    }
+
+    MCTFetchResultCacheEntry *entry = [[MCTFetchResultCacheEntry alloc] init];
+    entry.objectIDs = objectIDs;
+    entry.entityNames = MCTDependentEntityNames(entity, fetchRequest.predicate, fetchRequest.sortDescriptors);
+
+    NSArray *key = [self.class keyForFetchRequest:fetchRequest];
+    pthread_mutex_lock(&_mutex);
+    if (generation == _generation && _countLimit > 0) {
+        entry.lastAccess = ++_tick;
+        _entries[key] = entry;
+        [self evictToCount:_countLimit];
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+// MARK: - Invalidation
+- (void)invalidateObjects:(id<NSFastEnumeration>)objects {
+    NSHashTable *entities = [NSHashTable hashTableWithOptions:(NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality)];
+    for (id object in objects) {
+        NSEntityDescription *entity = [object entity];
+        if (entity) {
+            [entities addObject:entity];
+        }
+    }
+    if (entities.count == 0) {
+        return;
+    }
+    NSMutableSet *names = [NSMutableSet set];
+    for (NSEntityDescription *entity in entities) {
+        for (NSEntityDescription *current = entity; current != nil; current = current.superentity) {
+            if (current.name) {
+                [names addObject:current.name];
+            }
+        }
+    }
+    [self invalidateEntityNames:names];
+}
+- (void)invalidateEntityNames:(NSSet<NSString *> *)entityNames {
+    pthread_mutex_lock(&_mutex);
+    _generation++;
+    if (_entries.count > 0) {
+        NSMutableArray *keys = [NSMutableArray array];
+        [_entries enumerateKeysAndObjectsUsingBlock:^(NSArray *key, MCTFetchResultCacheEntry *entry, BOOL *stop) {
+            if (!entry.entityNames || [entry.entityNames intersectsSet:entityNames]) {
+                [keys addObject:key];
+            }
+        }];
+        [_entries removeObjectsForKeys:keys];
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+- (void)removeAllObjects {
+    pthread_mutex_lock(&_mutex);
+    _generation++;
+    [_entries removeAllObjects];
+    pthread_mutex_unlock(&_mutex);
+}
+
+// Must be called with the mutex locked.
+- (void)evictToCount:(NSUInteger)count {
+    while (_entries.count > count) {
+        NSArray *oldestKey = nil;
+        uint64_t oldest = UINT64_MAX;
+        for (NSArray *key in _entries) {
+            uint64_t access = _entries[key].lastAccess;
+            if (access < oldest) {
+                oldest = access;
+                oldestKey = key;
+            }
+        }
+        if (!oldestKey) {
+            return;
+        }
+        [_entries removeObjectForKey:oldestKey];
+    }
+}
+
+@end
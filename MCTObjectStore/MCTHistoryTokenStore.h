@@ -0,0 +1,76 @@
+/*!
+ * MCTHistoryTokenStore.h
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+#ifndef MCTObjectStore_MCTHistoryTokenStore_h
+#define MCTObjectStore_MCTHistoryTokenStore_h
+
+@import Foundation;
+@import CoreData;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  The last persistent history token each consumer processed, and the time of its transaction.
+ *
+ *  Tokens are archived to one file per consumer in the directory, so consumers in other processes sharing the store
+ *  are seen when pruning.  Without a directory they're only kept in memory.
+ */
+NS_CLASS_AVAILABLE(10_13, 11_0)
+@interface MCTHistoryTokenStore : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithDirectoryURL:(nullable NSURL *)URL NS_DESIGNATED_INITIALIZER;
+
+/**
+ *  The directory next to the store, e.g. Store.sqlite.history
+ */
++ (NSURL *)directoryURLForStoreURL:(NSURL *)URL;
+
+@property (nonatomic, copy, readonly, nullable) NSURL *directoryURL;
+
+- (nullable NSPersistentHistoryToken *)tokenForConsumer:(NSString *)consumer;
+- (nullable NSDate *)timestampForConsumer:(NSString *)consumer;
+
+/**
+ *  Pass a nil token & timestamp to remove the consumer.  A nil token with a timestamp makes the consumer start from
+ *  that date, e.g. after its token expired.
+ */
+- (BOOL)setToken:(nullable NSPersistentHistoryToken *)token timestamp:(nullable NSDate *)timestamp forConsumer:(NSString *)consumer error:(NSError **)error;
+
+/**
+ *  The earliest timestamp of any consumer.  History before it has been processed by everyone.
+ */
+- (nullable NSDate *)oldestTimestamp;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
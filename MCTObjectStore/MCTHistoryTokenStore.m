@@ -0,0 +1,175 @@
+/*!
+ * MCTHistoryTokenStore.m
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+@import Darwin.POSIX.pthread;
+
+#import "MCTHistoryTokenStore.h"
+#import "MCTObjectStoreLog.h"
+#import "MCTObjectStoreHelpers.h"
+
+static NSString *const MCTHistoryTokenKey = @"token";
+static NSString *const MCTHistoryTimestampKey = @"timestamp";
+static NSString *const MCTHistoryTokenExtension = @"token";
+
+@interface MCTHistoryTokenStore () {
+    pthread_mutex_t _mutex;
+}
+
+// Consumer -> token & timestamp.
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSString *, NSDictionary *> *entries;
+
+@end
+
+@implementation MCTHistoryTokenStore
+
+- (instancetype)initWithDirectoryURL:(NSURL *)URL {
+    self = [super init];
+    if (self) {
+        pthread_mutex_init(&_mutex, NULL);
+
+        _directoryURL = [URL copy];
+        _entries = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_mutex);
+}
+
++ (NSURL *)directoryURLForStoreURL:(NSURL *)URL {
+    MCTOSParamAssert(URL);
+    return [URL URLByAppendingPathExtension:@"history"];
+}
+
+// MARK: - Tokens
+- (NSPersistentHistoryToken *)tokenForConsumer:(NSString *)consumer {
+    return [self entryForConsumer:consumer][MCTHistoryTokenKey];
+}
+- (NSDate *)timestampForConsumer:(NSString *)consumer {
+    return [self entryForConsumer:consumer][MCTHistoryTimestampKey];
+}
+
+- (BOOL)setToken:(NSPersistentHistoryToken *)token timestamp:(NSDate *)timestamp forConsumer:(NSString *)consumer error:(NSError **)error {
+    MCTOSParamAssert(consumer);
+    NSURL *URL = [self URLForConsumer:consumer];
+    NSDictionary *entry = nil;
+    if (token || timestamp) {
+        NSMutableDictionary *value = [NSMutableDictionary dictionaryWithCapacity:2];
+        value[MCTHistoryTokenKey] = token;
+        value[MCTHistoryTimestampKey] = timestamp;
+        entry = [value copy];
+    }
+
+    BOOL success = YES;
+    pthread_mutex_lock(&_mutex);
+    if (URL) {
+        if (entry) {
+            NSData *data = [NSKeyedArchiver archivedDataWithRootObject:entry requiringSecureCoding:YES error:error];
+            success = (data != nil &&
+                       [[NSFileManager defaultManager] createDirectoryAtURL:self.directoryURL withIntermediateDirectories:YES attributes:nil error:error] &&
+                       [data writeToURL:URL options:NSDataWritingAtomic error:error]);
+        } else {
+            [[NSFileManager defaultManager] removeItemAtURL:URL error:NULL];
+        }
+    }
+    if (success) {
+        self.entries[consumer] = entry;
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (!success) {
+        MCTOSLog(@"Failed to save history token for %@",consumer);
+    }
+    return success;
+}
+
+- (NSDate *)oldestTimestamp {
+    NSMutableArray<NSString *> *consumers = nil;
+    pthread_mutex_lock(&_mutex);
+    consumers = [NSMutableArray arrayWithArray:self.entries.allKeys];
+    pthread_mutex_unlock(&_mutex);
+
+    // Other processes' consumers only exist on disk.
+    if (self.directoryURL) {
+        NSArray<NSURL *> *files = [[NSFileManager defaultManager] contentsOfDirectoryAtURL:self.directoryURL includingPropertiesForKeys:nil options:NSDirectoryEnumerationSkipsHiddenFiles error:NULL];
+        for (NSURL *file in files) {
+            if ([file.pathExtension isEqualToString:MCTHistoryTokenExtension]) {
+                [consumers addObject:[file.lastPathComponent stringByDeletingPathExtension]];
+            }
+        }
+    }
+
+    NSDate *oldest = nil;
+    for (NSString *consumer in [NSSet setWithArray:consumers]) {
+        NSDate *timestamp = [self timestampForConsumer:consumer];
+        if (timestamp && (!oldest || [timestamp compare:oldest] == NSOrderedAscending)) {
+            oldest = timestamp;
+        }
+    }
+    return oldest;
+}
+
+// MARK: - Storage
+- (NSDictionary *)entryForConsumer:(NSString *)consumer {
+    MCTOSParamAssert(consumer);
+    NSURL *URL = [self URLForConsumer:consumer];
+
+    pthread_mutex_lock(&_mutex);
+    NSDictionary *entry = self.entries[consumer];
+    pthread_mutex_unlock(&_mutex);
+
+    // The file is the source of truth, it's also written by other processes.
+    if (!URL) {
+        return entry;
+    }
+    NSData *data = [NSData dataWithContentsOfURL:URL];
+    if (!data) {
+        return entry;
+    }
+    NSSet *classes = [NSSet setWithObjects:[NSDictionary class], [NSString class], [NSDate class], [NSPersistentHistoryToken class], nil];
+    NSError *error = nil;
+    NSDictionary *archived = [NSKeyedUnarchiver unarchivedObjectOfClasses:classes fromData:data error:&error];
+    if (![archived isKindOfClass:[NSDictionary class]]) {
+        MCTOSLog(@"Failed to read history token for %@: %@",consumer,error);
+        return entry;
+    }
+    return archived;
+}
+
+- (NSURL *)URLForConsumer:(NSString *)consumer {
+    if (!self.directoryURL) {
+        return nil;
+    }
+    NSString *name = [consumer stringByReplacingOccurrencesOfString:@"/" withString:@"_"];
+    return [self.directoryURL URLByAppendingPathComponent:[name stringByAppendingPathExtension:MCTHistoryTokenExtension]];
+}
+
+@end
@@ -0,0 +1,79 @@
+/*!
+ * MCTImportPlan.h
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+#ifndef MCTObjectStore_MCTImportPlan_h
+#define MCTObjectStore_MCTImportPlan_h
+
+@import Foundation;
+@import CoreData;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  How values are applied to one NSManagedObject subclass in one model.
+ *
+ *  Holds the class's entity and, for each attribute, the setter implementation and the conversion from common JSON
+ *  types (numbers from strings, dates from ISO 8601 strings or seconds since 1970, etc.) to the attribute's type.
+ *  Built once per class & model, then shared between threads.
+ */
+@interface MCTImportPlan : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  The plan for the class in the model.  nil if the model has no entity for the class.
+ */
++ (nullable instancetype)planForClass:(Class)cls model:(NSManagedObjectModel *)model;
++ (nullable instancetype)planForClass:(Class)cls context:(NSManagedObjectContext *)context;
+
+@property (nonatomic, strong, readonly) NSEntityDescription *entity;
+
+/**
+ *  The property a values key is applied to, after `+remoteKeyMapping`.  nil if the key isn't known.
+ */
+- (nullable NSString *)propertyNameForKey:(NSString *)key;
+
+/**
+ *  The value converted to the type of the attribute for `key`.  Values for other keys are returned as is, NSNull as nil.
+ *  nil if a string can't be converted, e.g. a date in an unknown format.
+ */
+- (nullable id)coercedValue:(nullable id)value forKey:(NSString *)key;
+
+/**
+ *  Set each value on the object.  A value that can't be converted to its attribute's type is skipped, so the attribute
+ *  keeps its current value.
+ */
+- (void)applyValues:(NSDictionary<NSString *, id> *)values toObject:(NSManagedObject *)object;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
@@ -0,0 +1,312 @@
+/*!
+ * MCTImportPlan.m
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+@import ObjectiveC.runtime;
+@import Darwin.POSIX.pthread;
+
+#import "MCTImportPlan.h"
+#import "MCTManagedObject.h"
+#import "MCTObjectStoreLog.h"
+
+static const void *MCTImportPlansKey = &MCTImportPlansKey;
+static pthread_mutex_t MCTImportPlansMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// MARK: - Coercion
+static NSDate *MCTImportDateFromString(NSString *string) {
+    static NSArray<NSDateFormatter *> *formatters;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableArray *list = [NSMutableArray array];
+        for (NSString *format in @[@"yyyy-MM-dd'T'HH:mm:ssZZZZZ", @"yyyy-MM-dd'T'HH:mm:ss.SSSZZZZZ", @"yyyy-MM-dd"]) {
+            NSDateFormatter *formatter = [[NSDateFormatter alloc] init];
+            formatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+            formatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+            formatter.dateFormat = format;
+            [list addObject:formatter];
+        }
+        formatters = [list copy];
+    });
+    for (NSDateFormatter *formatter in formatters) {
+        NSDate *date = [formatter dateFromString:string];
+        if (date) {
+            return date;
+        }
+    }
+    return nil;
+}
+
+static NSScanner *MCTImportScanner(NSString *string) {
+    NSScanner *scanner = [NSScanner scannerWithString:[string stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]]];
+    scanner.charactersToBeSkipped = nil;
+    return scanner;
+}
+
+static NSNumber *MCTImportIntegerFromString(NSString *string) {
+    NSScanner *scanner = MCTImportScanner(string);
+    long long number = 0;
+    return ([scanner scanLongLong:&number] && [scanner isAtEnd]) ? @(number) : nil;
+}
+
+static NSNumber *MCTImportDoubleFromString(NSString *string) {
+    NSScanner *scanner = MCTImportScanner(string);
+    double number = 0.0;
+    return ([scanner scanDouble:&number] && [scanner isAtEnd]) ? @(number) : nil;
+}
+
+static NSNumber *MCTImportBooleanFromString(NSString *string) {
+    NSString *lowercase = [[string stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] lowercaseString];
+    if ([@[@"true", @"yes", @"1"] containsObject:lowercase]) {
+        return @YES;
+    }
+    if ([@[@"false", @"no", @"0"] containsObject:lowercase]) {
+        return @NO;
+    }
+    return nil;
+}
+
+/**
+ *  Convert the value to the attribute type.  Returns NO when a string can't be parsed as the type, the attribute should
+ *  keep its value instead of being cleared or zeroed.
+ */
+static BOOL MCTImportCoerce(id value, NSAttributeType type, id *coerced) {
+    *coerced = nil;
+    if (!value || value == [NSNull null]) {
+        return YES;
+    }
+    id result = value;
+    switch (type) {
+        case NSInteger16AttributeType:
+        case NSInteger32AttributeType:
+        case NSInteger64AttributeType:
+            if ([value isKindOfClass:[NSString class]]) {
+                result = MCTImportIntegerFromString(value);
+            }
+            break;
+        case NSBooleanAttributeType:
+            if ([value isKindOfClass:[NSString class]]) {
+                result = MCTImportBooleanFromString(value);
+            }
+            break;
+        case NSDoubleAttributeType:
+        case NSFloatAttributeType:
+            if ([value isKindOfClass:[NSString class]]) {
+                result = MCTImportDoubleFromString(value);
+            }
+            break;
+        case NSDecimalAttributeType:
+            if ([value isKindOfClass:[NSDecimalNumber class]]) {
+                break;
+            }
+            if ([value isKindOfClass:[NSNumber class]]) {
+                result = [NSDecimalNumber decimalNumberWithDecimal:[(NSNumber *)value decimalValue]];
+            } else if ([value isKindOfClass:[NSString class]]) {
+                result = [NSDecimalNumber decimalNumberWithString:value locale:[NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"]];
+                if ([result isEqual:[NSDecimalNumber notANumber]]) {
+                    result = nil;
+                }
+            }
+            break;
+        case NSStringAttributeType:
+            if ([value isKindOfClass:[NSNumber class]]) {
+                result = [(NSNumber *)value stringValue];
+            }
+            break;
+        case NSDateAttributeType:
+            if ([value isKindOfClass:[NSNumber class]]) {
+                result = [NSDate dateWithTimeIntervalSince1970:[(NSNumber *)value doubleValue]];
+            } else if ([value isKindOfClass:[NSString class]]) {
+                result = MCTImportDateFromString(value);
+            }
+            break;
+        default:
+            break;
+    }
+    if (!result) {
+        return NO;
+    }
+    *coerced = result;
+    return YES;
+}
+
+// MARK: - Setter
+@interface MCTImportSetter : NSObject {
+@public
+    NSString *_propertyName;
+    NSAttributeType _type;
+    SEL _selector;
+    /**
+     *  NULL when the class has no object setter for the property, e.g. a scalar accessor.  Set with KVC instead.
+     */
+    IMP _imp;
+}
+
+@end
+
+@implementation MCTImportSetter
+
+@end
+
+static IMP MCTImportSetterIMP(Class cls, SEL selector) {
+    // Resolves Core Data's dynamic accessors.
+    if (![cls instancesRespondToSelector:selector]) {
+        return NULL;
+    }
+    Method method = class_getInstanceMethod(cls, selector);
+    if (!method || method_getNumberOfArguments(method) != 3) {
+        return NULL;
+    }
+    char *argumentType = method_copyArgumentType(method, 2);
+    BOOL isObject = (argumentType && argumentType[0] == '@');
+    free(argumentType);
+    return (isObject) ? method_getImplementation(method) : NULL;
+}
+
+// MARK: - Plan
+@interface MCTImportPlan ()
+
+@property (nonatomic, assign, readonly) Class cls;
+@property (nonatomic, strong, readonly) NSDictionary<NSString *, MCTImportSetter *> *setters;
+@property (nonatomic, assign, readonly) BOOL ignoresUnknownKeys;
+@property (nonatomic, assign, readonly) BOOL suppressesNoOpWrites;
+
+@end
+
+@implementation MCTImportPlan
+
++ (instancetype)planForClass:(Class)cls context:(NSManagedObjectContext *)context {
+    NSManagedObjectModel *model = context.persistentStoreCoordinator.managedObjectModel;
+    if (!model) {
+        return nil;
+    }
+    return [self planForClass:cls model:model];
+}
++ (instancetype)planForClass:(Class)cls model:(NSManagedObjectModel *)model {
+    NSParameterAssert(cls);
+    NSParameterAssert(model);
+
+    pthread_mutex_lock(&MCTImportPlansMutex);
+    NSMutableDictionary *plans = objc_getAssociatedObject(model, MCTImportPlansKey);
+    if (!plans) {
+        plans = [NSMutableDictionary dictionary];
+        objc_setAssociatedObject(model, MCTImportPlansKey, plans, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    id key = (id<NSCopying>)cls;
+    MCTImportPlan *plan = plans[key];
+    if (!plan) {
+        NSEntityDescription *entity = model.entitiesByName[[cls entityName]];
+        plan = (entity) ? [[self alloc] initWithClass:cls entity:entity] : (id)[NSNull null];
+        plans[key] = plan;
+    }
+    pthread_mutex_unlock(&MCTImportPlansMutex);
+
+    return ((id)plan == [NSNull null]) ? nil : plan;
+}
+
+- (instancetype)initWithClass:(Class)cls entity:(NSEntityDescription *)entity {
+    self = [super init];
+    if (self) {
+        _cls = cls;
+        _entity = entity;
+
+        NSMutableDictionary *setters = [NSMutableDictionary dictionaryWithCapacity:entity.propertiesByName.count];
+        [entity.propertiesByName enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSPropertyDescription *property, BOOL *stop) {
+            if (![property isKindOfClass:[NSAttributeDescription class]] && ![property isKindOfClass:[NSRelationshipDescription class]]) {
+                return;
+            }
+            MCTImportSetter *setter = [[MCTImportSetter alloc] init];
+            setter->_propertyName = name;
+            setter->_type = ([property isKindOfClass:[NSAttributeDescription class]]) ? [(NSAttributeDescription *)property attributeType] : NSUndefinedAttributeType;
+            NSString *selectorName = [NSString stringWithFormat:@"set%@%@:",[[name substringToIndex:1] uppercaseString],[name substringFromIndex:1]];
+            setter->_selector = NSSelectorFromString(selectorName);
+            setter->_imp = MCTImportSetterIMP(cls, setter->_selector);
+            setters[name] = setter;
+        }];
+
+        NSDictionary *mapping = [cls remoteKeyMapping];
+        [mapping enumerateKeysAndObjectsUsingBlock:^(NSString *remoteKey, NSString *name, BOOL *stop) {
+            MCTImportSetter *setter = setters[name];
+            if (setter) {
+                setters[remoteKey] = setter;
+            }
+        }];
+        _ignoresUnknownKeys = (mapping != nil);
+        _suppressesNoOpWrites = ([cls isSubclassOfClass:[MCTManagedObject class]] && [cls suppressesNoOpWrites]);
+        _setters = [setters copy];
+    }
+    return self;
+}
+
+// MARK: - Values
+- (NSString *)propertyNameForKey:(NSString *)key {
+    MCTImportSetter *setter = self.setters[key];
+    return (setter) ? setter->_propertyName : nil;
+}
+- (id)coercedValue:(id)value forKey:(NSString *)key {
+    MCTImportSetter *setter = self.setters[key];
+    if (!setter) {
+        return (value == [NSNull null]) ? nil : value;
+    }
+    id coerced = nil;
+    MCTImportCoerce(value, setter->_type, &coerced);
+    return coerced;
+}
+
+- (void)applyValues:(NSDictionary<NSString *, id> *)values toObject:(NSManagedObject *)object {
+    NSDictionary *setters = self.setters;
+    BOOL ignoresUnknownKeys = self.ignoresUnknownKeys;
+    BOOL suppressesNoOpWrites = self.suppressesNoOpWrites;
+    // A KVO subclass overrides the setters, so only call the implementations directly on the class itself.
+    BOOL direct = (object_getClass(object) == self.cls);
+    [values enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+        MCTImportSetter *setter = setters[key];
+        if (!setter) {
+            if (!ignoresUnknownKeys) {
+                [object setValue:(value == [NSNull null]) ? nil : value forKey:key];
+            }
+            return;
+        }
+        id coerced = nil;
+        if (!MCTImportCoerce(value, setter->_type, &coerced)) {
+            MCTOSLog(@"Keeping %@.%@, couldn't convert %@",object.entity.name,setter->_propertyName,value);
+            return;
+        }
+        if (direct && setter->_imp) {
+            // Calling the setter skips -[MCTManagedObject setValue:forKey:], so drop no-op writes here.
+            if (suppressesNoOpWrites && [(MCTManagedObject *)object suppressNoOpWriteOfValue:coerced forKey:setter->_propertyName]) {
+                return;
+            }
+            ((void(*)(id, SEL, id))setter->_imp)(object, setter->_selector, coerced);
+        } else {
+            [object setValue:coerced forKey:setter->_propertyName];
+        }
+    }];
+}
+
+@end
@@ -36,13 +36,63 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+@class MCTOrderCache;
+
 @interface MCTManagedObject : NSManagedObject
 
 // MARK: - Order Cache
+/**
+ *  The cache ordered relationships are kept in.  Defaults to `[MCTOrderCache sharedCache]`, pass nil to go back to it.
+ */
++ (MCTOrderCache *)orderCache;
++ (void)setOrderCache:(nullable MCTOrderCache *)orderCache;
+
 - (nullable NSArray<__kindof NSManagedObject *> *)cachedOrderedRelations:(NSString *)name sort:(NSArray<__kindof NSManagedObject *> *(^)(NSSet<__kindof NSManagedObject *> *))sort;
+/**
+ *  Returns the to-many relationship `name` ordered by `sortDescriptors`.
+ *
+ *  The order is kept up to date as objects are added to or removed from the relationship instead of
+ *  being re-sorted.  Changing a sort key on a member that points back through a to-one inverse
+ *  discards the cached order so it is rebuilt on next access.
+ */
+- (nullable NSArray<__kindof NSManagedObject *> *)cachedOrderedRelations:(NSString *)name sortDescriptors:(NSArray<NSSortDescriptor *> *)sortDescriptors;
 - (void)clearOrderCache;
 - (void)clearOrderCacheForName:(NSString *)name;
 
+// MARK: - No-op Writes
+/**
+ *  When YES, setting an attribute to the value it already has with `setValue:forKey:`, `importValues:` or
+ *  `setValuesForKeysWithDictionary:` is dropped instead of marking the object updated.  Objects changed some other
+ *  way, e.g. through a property setter, are refreshed before saving when every changed attribute is back to its saved
+ *  value, so they aren't written or merged.  Defaults to NO, override it to opt in.
+ */
++ (BOOL)suppressesNoOpWrites;
+
+/**
+ *  Returns YES, counting the write as suppressed, when the class suppresses no-op writes and `key` is an attribute that
+ *  already has `value`.  Callers writing attributes without `setValue:forKey:` should skip the write when this is YES.
+ */
+- (BOOL)suppressNoOpWriteOfValue:(nullable id)value forKey:(NSString *)key;
+
+/**
+ *  Refresh the updated objects whose classes suppress no-op writes and whose changes are all no-ops, discarding their
+ *  transient values.  MCTObjectContext & its pools call this before saving, call it before saving other contexts.
+ *  Must be called on the context's queue.
+ *
+ *  @return The number of objects refreshed.
+ */
++ (NSUInteger)revertNoOpUpdatesInContext:(NSManagedObjectContext *)context;
+
+/**
+ *  Attribute writes dropped by `suppressNoOpWriteOfValue:forKey:`, across every class.
+ */
+@property (class, readonly) uint64_t suppressedWriteCount;
+/**
+ *  Objects refreshed by `revertNoOpUpdatesInContext:`, across every class.
+ */
+@property (class, readonly) uint64_t revertedUpdateCount;
++ (void)resetNoOpWriteStatistics;
+
 // MARK: - Helpers
 + (nullable id)objectForNotification:(NSNotification *)notification context:(NSManagedObjectContext *)context error:(NSError *__autoreleasing*)error;
 
@@ -57,12 +107,35 @@ NS_ASSUME_NONNULL_BEGIN
 + (NSEntityDescription *)entityInContext:(NSManagedObjectContext *)context;
 
 + (instancetype)insertIntoContext:(NSManagedObjectContext *)context;
+/**
+ *  Insert a new object & apply `values` with `importValues:`.
+ */
 + (instancetype)insertIntoContext:(NSManagedObjectContext *)context values:(nullable NSDictionary<NSString *, id> *)values;
 
+// MARK: - Import
+/**
+ *  Remote keys mapped to the property names they're imported into, e.g. @{@"first_name": @"firstName"}.
+ *
+ *  Returning a mapping also ignores keys that are neither mapped nor properties when importing.  Defaults to nil.
+ */
++ (nullable NSDictionary<NSString *, NSString *> *)remoteKeyMapping;
+
+/**
+ *  Apply values like `setValuesForKeysWithDictionary:`, after mapping remote keys & converting values to the attribute
+ *  types.  Numbers are read from strings, strings from numbers, and dates from ISO 8601 strings or seconds since 1970.
+ *  NSNull sets nil.  A string that can't be converted, e.g. a date in another format, leaves the attribute as it is.
+ */
+- (void)importValues:(NSDictionary<NSString *, id> *)values;
+
 // MARK: - Deleting
 - (void)destroy;
 
 // MARK: - Info
+/**
+ *  Keep the count of objects matching `predicate` up to date as saves happen, so `countInContext:predicate:error:` with the
+ *  same predicate doesn't query the store.  See MCTObjectCountRegistry.
+ */
++ (void)registerCountInContext:(NSManagedObjectContext *)context predicate:(nullable NSPredicate *)predicate;
 + (NSUInteger)countInContext:(NSManagedObjectContext *)context error:(NSError * __nullable *)error;
 + (NSUInteger)countInContext:(NSManagedObjectContext *)context predicate:(nullable NSPredicate *)predicate error:(NSError * __nullable *)error;
 
@@ -27,68 +27,473 @@
  *   @email skylar@pco.bz
  *
  */
-#import <libkern/OSAtomic.h>
+#import <pthread.h>
+#import <stdatomic.h>
 
 #import "MCTManagedObject.h"
+#import "MCTObjectContext.h"
 #import "MCTObjectStoreError.h"
+#import "MCTOrderCache.h"
+#import "MCTObjectCountRegistry.h"
+#import "MCTImportPlan.h"
 
-@interface MCTManagedObject () {
-    OSSpinLock volatile _spinLock;
+// MARK: - Ordered Relation
+// Members are held weakly so a cached relation never keeps objects alive after their context lets them go, a member
+// that's been deallocated makes the relation a miss and it's rebuilt from the owner.
+@interface MCTOrderedRelation : NSObject {
+    NSPointerArray *_members;
+    NSComparator _comparator;
 }
 
-@property (atomic, strong) NSCache *orderCache;
+- (instancetype)initWithSet:(NSSet *)set sortDescriptors:(NSArray<NSSortDescriptor *> *)sortDescriptors NS_DESIGNATED_INITIALIZER;
+- (instancetype)initWithObjects:(NSArray *)objects NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly) NSArray<NSSortDescriptor *> *sortDescriptors;
+
+/**
+ *  The ordered objects, or nil if any of them has been deallocated.
+ */
+@property (nonatomic, copy, readonly, nullable) NSArray *objects;
+
+/**
+ *  Approximate number of bytes held by the relation.
+ */
+@property (nonatomic, assign, readonly) NSUInteger cost;
+
+/**
+ *  Applies a set mutation to the ordered objects.
+ *
+ *  Returns NO if the relation can't be maintained incrementally and should be rebuilt.
+ */
+- (BOOL)applyMutation:(NSKeyValueSetMutationKind)mutationKind objects:(NSSet *)objects;
 
 @end
 
-@implementation MCTManagedObject
-@synthesize orderCache = _orderCache;
+static NSPointerArray *MCTOrderedRelationMembers(NSArray *objects) {
+    NSPointerArray *members = [NSPointerArray weakObjectsPointerArray];
+    for (id object in objects) {
+        [members addPointer:(__bridge void *)object];
+    }
+    return members;
+}
+
+@implementation MCTOrderedRelation
 
-- (nonnull NSManagedObject *)initWithEntity:(nonnull NSEntityDescription *)entity insertIntoManagedObjectContext:(nullable NSManagedObjectContext *)context {
-    self = [super initWithEntity:entity insertIntoManagedObjectContext:context];
+- (instancetype)initWithSet:(NSSet *)set sortDescriptors:(NSArray<NSSortDescriptor *> *)sortDescriptors {
+    self = [super init];
+    if (self) {
+        _sortDescriptors = [sortDescriptors copy];
+        _members = MCTOrderedRelationMembers([set sortedArrayUsingDescriptors:_sortDescriptors]);
+        NSArray *descriptors = _sortDescriptors;
+        _comparator = ^NSComparisonResult(id lhs, id rhs) {
+            for (NSSortDescriptor *descriptor in descriptors) {
+                NSComparisonResult result = [descriptor compareObject:lhs toObject:rhs];
+                if (result != NSOrderedSame) {
+                    return result;
+                }
+            }
+            return NSOrderedSame;
+        };
+    }
+    return self;
+}
+- (instancetype)initWithObjects:(NSArray *)objects {
+    self = [super init];
     if (self) {
-        _spinLock = OS_SPINLOCK_INIT;
+        _members = MCTOrderedRelationMembers(objects);
     }
     return self;
 }
+- (NSArray *)objects {
+    NSUInteger count = _members.count;
+    NSMutableArray *objects = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        id object = (__bridge id)[_members pointerAtIndex:idx];
+        if (!object) {
+            return nil;
+        }
+        [objects addObject:object];
+    }
+    return objects;
+}
+
+- (NSUInteger)cost {
+    // The pointer array and the weak table entry for each member.  Members aren't retained, their memory belongs
+    // to the context.
+    return (sizeof(id) * _members.count * 4) + 64;
+}
+
+- (BOOL)applyMutation:(NSKeyValueSetMutationKind)mutationKind objects:(NSSet *)objects {
+    if (!_comparator) {
+        return NO;
+    }
+    NSMutableArray *ordered = [self.objects mutableCopy];
+    if (!ordered) {
+        return NO;
+    }
+    switch (mutationKind) {
+        case NSKeyValueUnionSetMutation:
+            for (id object in objects) {
+                if ([self indexOfObject:object inObjects:ordered] != NSNotFound) {
+                    continue;
+                }
+                NSUInteger idx = [ordered indexOfObject:object inSortedRange:NSMakeRange(0, ordered.count) options:(NSBinarySearchingInsertionIndex | NSBinarySearchingLastEqual) usingComparator:_comparator];
+                [ordered insertObject:object atIndex:idx];
+            }
+            break;
+        case NSKeyValueMinusSetMutation:
+            for (id object in objects) {
+                NSUInteger idx = [self indexOfObject:object inObjects:ordered];
+                if (idx == NSNotFound) {
+                    // The sort key may have been changed without going through KVO.  Fall back to a scan.
+                    idx = [ordered indexOfObjectIdenticalTo:object];
+                }
+                if (idx != NSNotFound) {
+                    [ordered removeObjectAtIndex:idx];
+                }
+            }
+            break;
+        case NSKeyValueIntersectSetMutation: {
+            NSIndexSet *indexes = [ordered indexesOfObjectsPassingTest:^BOOL(id object, NSUInteger idx, BOOL *stop) {
+                return ![objects containsObject:object];
+            }];
+            [ordered removeObjectsAtIndexes:indexes];
+            break;
+        }
+        case NSKeyValueSetSetMutation:
+            return NO;
+    }
+    _members = MCTOrderedRelationMembers(ordered);
+    return YES;
+}
+- (NSUInteger)indexOfObject:(id)object inObjects:(NSArray *)objects {
+    NSUInteger count = objects.count;
+    NSUInteger idx = [objects indexOfObject:object inSortedRange:NSMakeRange(0, count) options:NSBinarySearchingFirstEqual usingComparator:_comparator];
+    if (idx == NSNotFound) {
+        return NSNotFound;
+    }
+    for (; idx < count; idx++) {
+        id candidate = objects[idx];
+        if (candidate == object) {
+            return idx;
+        }
+        if (_comparator(candidate, object) != NSOrderedSame) {
+            break;
+        }
+    }
+    return NSNotFound;
+}
+
+@end
+
+// MARK: - Sort Key Registry
+// Destination entity name -> sort key -> @[inverse relationship name, relationship name]
+//
+// Every change to a managed object reads the registry, so readers load an immutable snapshot without taking a lock.
+// Registering copies the snapshot under the mutex and publishes the copy.  Old snapshots are kept alive because a
+// reader may still be using one, there's one per owner ever registered so they never add up to much.
+static _Atomic(void *) MCTOrderSortKeySnapshot = NULL;
+static NSMutableArray<NSDictionary *> *MCTOrderSortKeySnapshots = nil;
+static pthread_mutex_t MCTOrderSortKeysMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static NSDictionary<NSString *, NSDictionary<NSString *, NSArray<NSArray<NSString *> *> *> *> *MCTOrderSortKeys(void) {
+    return (__bridge NSDictionary *)atomic_load_explicit(&MCTOrderSortKeySnapshot, memory_order_acquire);
+}
+
+static NSArray<NSString *> *MCTOrderSortKeyNames(NSArray<NSSortDescriptor *> *sortDescriptors) {
+    NSMutableArray *names = [NSMutableArray arrayWithCapacity:sortDescriptors.count];
+    for (NSSortDescriptor *descriptor in sortDescriptors) {
+        NSString *key = [[descriptor.key componentsSeparatedByString:@"."] firstObject];
+        if (key.length > 0) {
+            [names addObject:key];
+        }
+    }
+    return names;
+}
+
+static BOOL MCTOrderSortKeysContain(NSDictionary *snapshot, NSString *entityName, NSArray<NSString *> *keys, NSArray<NSString *> *owner) {
+    NSDictionary *entityKeys = snapshot[entityName];
+    for (NSString *key in keys) {
+        if (![entityKeys[key] containsObject:owner]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+static void MCTRegisterOrderSortKeys(NSRelationshipDescription *relationship, NSArray<NSSortDescriptor *> *sortDescriptors) {
+    NSRelationshipDescription *inverse = relationship.inverseRelationship;
+    NSString *entityName = relationship.destinationEntity.name;
+    if (!inverse || inverse.isToMany || !entityName) {
+        return;
+    }
+    NSArray *owner = @[inverse.name, relationship.name];
+    NSArray *keys = MCTOrderSortKeyNames(sortDescriptors);
+    if (MCTOrderSortKeysContain(MCTOrderSortKeys(), entityName, keys, owner)) {
+        return;
+    }
+
+    pthread_mutex_lock(&MCTOrderSortKeysMutex);
+    NSDictionary *current = MCTOrderSortKeys();
+    if (!MCTOrderSortKeysContain(current, entityName, keys, owner)) {
+        NSMutableDictionary *snapshot = (current) ? [current mutableCopy] : [NSMutableDictionary dictionary];
+        NSMutableDictionary *entityKeys = (snapshot[entityName]) ? [snapshot[entityName] mutableCopy] : [NSMutableDictionary dictionary];
+        for (NSString *key in keys) {
+            NSArray *owners = entityKeys[key] ?: @[];
+            if (![owners containsObject:owner]) {
+                entityKeys[key] = [owners arrayByAddingObject:owner];
+            }
+        }
+        snapshot[entityName] = [entityKeys copy];
+
+        NSDictionary *published = [snapshot copy];
+        if (!MCTOrderSortKeySnapshots) {
+            MCTOrderSortKeySnapshots = [NSMutableArray array];
+        }
+        [MCTOrderSortKeySnapshots addObject:published];
+        atomic_store_explicit(&MCTOrderSortKeySnapshot, (__bridge void *)published, memory_order_release);
+    }
+    pthread_mutex_unlock(&MCTOrderSortKeysMutex);
+}
+
+static NSArray<NSArray<NSString *> *> *MCTOrderSortKeyOwners(NSDictionary *snapshot, NSEntityDescription *entity, NSString *key) {
+    NSArray *owners = nil;
+    for (NSEntityDescription *current = entity; current != nil; current = current.superentity) {
+        NSArray *found = snapshot[current.name][key];
+        if (found.count > 0) {
+            owners = (owners) ? [owners arrayByAddingObjectsFromArray:found] : found;
+        }
+    }
+    return owners;
+}
+
+// MARK: - No-op Writes
+static _Atomic(uint64_t) MCTSuppressedWriteCount = 0;
+static _Atomic(uint64_t) MCTRevertedUpdateCount = 0;
+
+static BOOL MCTValuesEqual(id lhs, id rhs) {
+    if (lhs == [NSNull null]) {
+        lhs = nil;
+    }
+    if (rhs == [NSNull null]) {
+        rhs = nil;
+    }
+    return (lhs == rhs || [lhs isEqual:rhs]);
+}
+
+@interface MCTManagedObject () {
+    NSMutableSet<NSString *> *_orderCacheNames;
+    NSManagedObjectID *_orderCacheObjectID;
+    NSString *_mutatingRelation;
+}
+
+@end
+
+@implementation MCTManagedObject
 
 // MARK: - Changes
 - (void)didChangeValueForKey:(NSString *)inKey withSetMutation:(NSKeyValueSetMutationKind)inMutationKind usingObjects:(NSSet *)inObjects {
-    [self clearOrderCacheForName:inKey];
+    _mutatingRelation = inKey;
     [super didChangeValueForKey:inKey withSetMutation:inMutationKind usingObjects:inObjects];
+    _mutatingRelation = nil;
+
+    if (![_orderCacheNames containsObject:inKey]) {
+        return;
+    }
+    MCTOrderCache *cache = [self orderCache];
+    MCTOrderedRelation *relation = [cache objectForName:inKey owner:self];
+    if (!relation) {
+        return;
+    }
+    if ([relation applyMutation:inMutationKind objects:inObjects]) {
+        [cache setObject:relation forName:inKey owner:self cost:relation.cost];
+    } else {
+        [self clearOrderCacheForName:inKey];
+    }
+}
+- (void)didChangeValueForKey:(NSString *)key {
+    [super didChangeValueForKey:key];
+    if ([_orderCacheNames containsObject:key] && ![key isEqualToString:_mutatingRelation]) {
+        // The whole relationship was replaced, e.g. by a refresh or merge.
+        [self clearOrderCacheForName:key];
+    }
+    [self invalidateOwnerOrderCachesForKey:key];
+}
+- (void)didTurnIntoFault {
+    [self clearOrderCache];
+    [super didTurnIntoFault];
+}
+- (void)invalidateOwnerOrderCachesForKey:(NSString *)key {
+    NSDictionary *snapshot = MCTOrderSortKeys();
+    if (!snapshot) {
+        return;
+    }
+    for (NSArray<NSString *> *owner in MCTOrderSortKeyOwners(snapshot, self.entity, key)) {
+        id object = [self valueForKey:owner[0]];
+        if ([object isKindOfClass:[MCTManagedObject class]]) {
+            [(MCTManagedObject *)object clearOrderCacheForName:owner[1]];
+        }
+    }
 }
 
 // MARK: - Order Cache
+// Read on every ordered relationship access, so it's an atomic pointer instead of a locked variable.  A replaced cache
+// is emptied but never released since a reader may have just loaded it.
+static _Atomic(void *) MCTManagedObjectOrderCache = NULL;
+
++ (MCTOrderCache *)orderCache {
+    MCTOrderCache *cache = (__bridge MCTOrderCache *)atomic_load_explicit(&MCTManagedObjectOrderCache, memory_order_acquire);
+    return cache ?: [MCTOrderCache sharedCache];
+}
++ (void)setOrderCache:(MCTOrderCache *)orderCache {
+    void *previous = atomic_exchange_explicit(&MCTManagedObjectOrderCache, (orderCache) ? (void *)CFBridgingRetain(orderCache) : NULL, memory_order_acq_rel);
+    [(__bridge MCTOrderCache *)previous removeAllObjects];
+}
+- (MCTOrderCache *)orderCache {
+    MCTOrderCache *cache = [MCTManagedObject orderCache];
+    if (_orderCacheNames.count > 0) {
+        NSManagedObjectID *objectID = self.objectID;
+        if (_orderCacheObjectID != objectID && ![_orderCacheObjectID isEqual:objectID]) {
+            // Saving replaced the temporary ID the entries were stored under.
+            [cache moveObjectsForNames:_orderCacheNames owner:self fromObjectID:_orderCacheObjectID];
+            _orderCacheObjectID = objectID;
+        }
+    }
+    return cache;
+}
+- (void)storeOrderedRelation:(MCTOrderedRelation *)relation forName:(NSString *)name {
+    MCTOrderCache *cache = [self orderCache];
+    if (!_orderCacheNames) {
+        _orderCacheNames = [NSMutableSet set];
+    }
+    if (_orderCacheNames.count == 0) {
+        _orderCacheObjectID = self.objectID;
+    }
+    [_orderCacheNames addObject:name];
+    [cache setObject:relation forName:name owner:self cost:relation.cost];
+}
 - (nullable NSArray<__kindof NSManagedObject *> *)cachedOrderedRelations:(NSString *)name sort:(NSArray<__kindof NSManagedObject *> *(^)(NSSet<__kindof NSManagedObject *> *))sort {
-    NSCache *cache = nil;
-    OSSpinLockLock(&_spinLock);
-    cache = self.orderCache;
-    if (!cache) {
-        cache = [[NSCache alloc] init];
-        self.orderCache = cache;
+    NSArray *cached = [[[self orderCache] objectForName:name owner:self] objects];
+    if (cached) {
+        return cached;
     }
-    OSSpinLockUnlock(&_spinLock);
 
-    NSArray *relation = [cache objectForKey:name];
-    if (relation) {
-        return relation;
+    NSSet *set = [self valueForKey:name];
+    NSArray *objects = sort(set);
+
+    if (objects) {
+        [self storeOrderedRelation:[[MCTOrderedRelation alloc] initWithObjects:objects] forName:name];
+    }
+
+    return objects;
+}
+- (nullable NSArray<__kindof NSManagedObject *> *)cachedOrderedRelations:(NSString *)name sortDescriptors:(NSArray<NSSortDescriptor *> *)sortDescriptors {
+    NSParameterAssert(sortDescriptors.count > 0);
+    MCTOrderedRelation *relation = [[self orderCache] objectForName:name owner:self];
+    if (relation && [relation.sortDescriptors isEqualToArray:sortDescriptors]) {
+        NSArray *cached = relation.objects;
+        if (cached) {
+            return cached;
+        }
     }
 
     NSSet *set = [self valueForKey:name];
-    relation = sort(set);
+    if (!set) {
+        return nil;
+    }
 
-    if (relation) {
-        [cache setObject:relation forKey:name];
+    NSRelationshipDescription *description = self.entity.relationshipsByName[name];
+    if (description) {
+        MCTRegisterOrderSortKeys(description, sortDescriptors);
     }
 
-    return relation;
+    relation = [[MCTOrderedRelation alloc] initWithSet:set sortDescriptors:sortDescriptors];
+    [self storeOrderedRelation:relation forName:name];
+
+    return relation.objects;
 }
 - (void)clearOrderCache {
-    OSSpinLockLock(&_spinLock);
-    self.orderCache = nil;
-    OSSpinLockUnlock(&_spinLock);
+    if (_orderCacheNames.count == 0) {
+        return;
+    }
+    [[self orderCache] removeObjectsForNames:_orderCacheNames owner:self];
+    [_orderCacheNames removeAllObjects];
+    _orderCacheObjectID = nil;
 }
 - (void)clearOrderCacheForName:(NSString *)name {
-    [self.orderCache removeObjectForKey:name];
+    if (![_orderCacheNames containsObject:name]) {
+        return;
+    }
+    [[self orderCache] removeObjectForName:name owner:self];
+    [_orderCacheNames removeObject:name];
+}
+
+// MARK: - No-op Writes
++ (BOOL)suppressesNoOpWrites {
+    return NO;
+}
+- (BOOL)suppressNoOpWriteOfValue:(id)value forKey:(NSString *)key {
+    if (![[self class] suppressesNoOpWrites] || !self.entity.attributesByName[key] || !MCTValuesEqual([self valueForKey:key], value)) {
+        return NO;
+    }
+    atomic_fetch_add_explicit(&MCTSuppressedWriteCount, 1, memory_order_relaxed);
+    return YES;
+}
+- (void)setValue:(id)value forKey:(NSString *)key {
+    if ([self suppressNoOpWriteOfValue:value forKey:key]) {
+        return;
+    }
+    [super setValue:value forKey:key];
+}
+/**
+ *  YES when every changed property is an attribute that's back to its saved value.
+ */
+- (BOOL)hasOnlyNoOpChanges {
+    NSDictionary<NSString *, id> *changes = self.changedValues;
+    if (changes.count == 0) {
+        return YES;
+    }
+    NSDictionary<NSString *, NSAttributeDescription *> *attributes = self.entity.attributesByName;
+    for (NSString *key in changes) {
+        if (!attributes[key]) {
+            // Relationships are always written.
+            return NO;
+        }
+    }
+    NSDictionary<NSString *, id> *committed = [self committedValuesForKeys:changes.allKeys];
+    for (NSString *key in changes) {
+        if (!MCTValuesEqual(changes[key], committed[key])) {
+            return NO;
+        }
+    }
+    return YES;
+}
++ (NSUInteger)revertNoOpUpdatesInContext:(NSManagedObjectContext *)context {
+    NSUInteger reverted = 0;
+    for (NSManagedObject *object in [context.updatedObjects allObjects]) {
+        if (![object isKindOfClass:[MCTManagedObject class]] || ![[object class] suppressesNoOpWrites]) {
+            continue;
+        }
+        if ([(MCTManagedObject *)object hasOnlyNoOpChanges]) {
+            [context refreshObject:object mergeChanges:NO];
+            reverted++;
+        }
+    }
+    if (reverted > 0) {
+        atomic_fetch_add_explicit(&MCTRevertedUpdateCount, reverted, memory_order_relaxed);
+    }
+    return reverted;
+}
++ (uint64_t)suppressedWriteCount {
+    return atomic_load(&MCTSuppressedWriteCount);
+}
++ (uint64_t)revertedUpdateCount {
+    return atomic_load(&MCTRevertedUpdateCount);
+}
++ (void)resetNoOpWriteStatistics {
+    atomic_store(&MCTSuppressedWriteCount, 0);
+    atomic_store(&MCTRevertedUpdateCount, 0);
 }
 
 // MARK: - Helpers
@@ -130,25 +535,60 @@
     return [self insertIntoContext:context values:nil];
 }
 + (instancetype)insertIntoContext:(NSManagedObjectContext *)context values:(nullable NSDictionary *)values {
-    NSManagedObject *object = [[self alloc] initWithEntity:[self entityInContext:context] insertIntoManagedObjectContext:context];
+    MCTImportPlan *plan = [MCTImportPlan planForClass:self context:context];
+    NSEntityDescription *entity = (plan) ? plan.entity : [self entityInContext:context];
+    NSManagedObject *object = [[self alloc] initWithEntity:entity insertIntoManagedObjectContext:context];
     if (values.count > 0) {
-        [object setValuesForKeysWithDictionary:values];
+        if (plan) {
+            [plan applyValues:values toObject:object];
+        } else {
+            [object setValuesForKeysWithDictionary:values];
+        }
     }
     return object;
 }
 
+// MARK: - Import
++ (NSDictionary<NSString *, NSString *> *)remoteKeyMapping {
+    return nil;
+}
+- (void)importValues:(NSDictionary<NSString *, id> *)values {
+    MCTImportPlan *plan = [MCTImportPlan planForClass:[self class] context:self.managedObjectContext];
+    if (plan) {
+        [plan applyValues:values toObject:self];
+    } else {
+        [self setValuesForKeysWithDictionary:values];
+    }
+}
+
 // MARK: - Delete
 - (void)destroy {
     [self.managedObjectContext deleteObject:self];
 }
 
 // MARK: - Info
++ (void)registerCountInContext:(NSManagedObjectContext *)context predicate:(NSPredicate *)predicate {
+    NSPersistentStoreCoordinator *coordinator = context.persistentStoreCoordinator;
+    NSParameterAssert(coordinator);
+    [[MCTObjectCountRegistry registryForPersistentStoreCoordinator:coordinator] registerEntityName:[self entityName] predicate:predicate];
+}
 + (NSUInteger)countInContext:(NSManagedObjectContext *)context error:(NSError **)error {
     return [self countInContext:context predicate:nil error:error];
 }
 + (NSUInteger)countInContext:(NSManagedObjectContext *)context predicate:(NSPredicate *)predicate error:(NSError **)error {
+    if (!context.parentContext && !context.hasChanges) {
+        // Registered counts track the store, so they only match contexts without unsaved changes.
+        MCTObjectCountRegistry *registry = [MCTObjectCountRegistry existingRegistryForPersistentStoreCoordinator:context.persistentStoreCoordinator];
+        if (registry) {
+            NSUInteger count = [registry countForEntityName:[self entityName] predicate:predicate inContext:context error:NULL];
+            if (count != NSNotFound) {
+                return count;
+            }
+        }
+    }
     NSFetchRequest *fetchRequest = [NSFetchRequest fetchRequestWithEntityName:[self entityName]];
     fetchRequest.predicate = predicate;
+    fetchRequest.affectedStores = [context.persistentStoreCoordinator mct_affectedStoresForEntityName:fetchRequest.entityName];
     return [context countForFetchRequest:fetchRequest error:error];
 }
 
@@ -39,6 +39,13 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+@class MCTObjectContextPool;
+@class MCTObjectMetrics;
+@class MCTStoreConfiguration;
+@class MCTStoreShard;
+@class MCTWorkingSet;
+@class MCTObjectFuture<__covariant ResultType>;
+
 /**
  *  Object that wraps a CoreData NSManagedObjectContext
  *
@@ -58,6 +65,20 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (atomic, assign, readonly, getter=isReady) BOOL ready;
 
+/**
+ *  Limit merges from other contexts' saves to these entities (and their sub-entities).
+ *
+ *  Defaults to nil, which merges changes to every entity.
+ */
+@property (atomic, copy, nullable) NSSet<NSString *> *mergeEntityNames;
+
+/**
+ *  The pool of private contexts used by `performInDisposable:` and imports.
+ *
+ *  Created when the context is prepared & shared with contexts created by `newObjectContextWithType:error:`
+ */
+@property (atomic, strong, readonly, nullable) MCTObjectContextPool *disposableContextPool;
+
 /**
  *  Perform the block in the context queue
  *
@@ -73,9 +94,10 @@ NS_ASSUME_NONNULL_BEGIN
 /**
  *  Perform the block in a disposable private context.
  *
- *  The context is created with a private queue type, using the store's NSPersistentStoreCoordinator.
+ *  The context is taken from `disposableContextPool`, using the store's NSPersistentStoreCoordinator.  If every pooled
+ *  context is in use the call waits for one to be returned.
  *
- *  After the block executes the context saves itself if it has changes.
+ *  After the block executes the context saves itself if it has changes, and is reset before it's returned to the pool.
  *
  *  @param block The block to perform.
  */
@@ -104,6 +126,71 @@ NS_ASSUME_NONNULL_BEGIN
  */
 + (BOOL)handleSaveError:(NSError *)error inContext:(NSManagedObjectContext *)ctx;
 
+// MARK: - Metrics
+/**
+ *  Records perform, fetch, save, merge and batch request timings when set.  Contexts created with
+ *  `newObjectContextWithType:error:` share it.  Defaults to nil.
+ */
+@property (atomic, strong, nullable) MCTObjectMetrics *metrics;
+
+// MARK: - Coalesced Saves
+/**
+ *  When YES, saves requested with `saveWithCompletion:` are grouped into a single save of the context.
+ *
+ *  Defaults to NO.
+ */
+@property (atomic, assign) BOOL coalescesSaves;
+/**
+ *  How long to wait after the first requested save before saving.  Defaults to 0.25 seconds.
+ */
+@property (atomic, assign) NSTimeInterval saveCoalescingInterval;
+/**
+ *  Save immediately when the context has at least this many inserted, updated, or deleted objects.  Defaults to 500.
+ *
+ *  Pass 0 to only save when the coalescing interval elapses.
+ */
+@property (atomic, assign) NSUInteger maximumPendingSaveChanges;
+
+/**
+ *  Request a save of the backing context.
+ *
+ *  If `coalescesSaves` is NO the save happens as soon as the context's queue is available.  Otherwise it is grouped with
+ *  every other save requested in the coalescing window.  A call to `save:` also saves any pending requests.
+ *
+ *  @param completion Called on the context's queue after the save that included this request.
+ */
+- (void)saveWithCompletion:(nullable void(^)(BOOL success, NSError *_Nullable error))completion;
+
+// MARK: - Fetch Result Cache
+/**
+ *  When YES, `all:predicate:sortDescriptors:error:` remembers the object IDs it fetched and returns them again without
+ *  going to the store until an object of an entity the fetch depends on is inserted, updated or deleted.
+ *
+ *  Predicates must be deterministic; a predicate that compares against the current date will keep returning the first
+ *  result.  Defaults to NO.
+ */
+@property (atomic, assign) BOOL cachesFetchResults;
+/**
+ *  The most fetch results held at once.  Defaults to 100.
+ */
+@property (atomic, assign) NSUInteger fetchResultCacheLimit;
+
+@property (atomic, assign, readonly) uint64_t fetchResultCacheHitCount;
+@property (atomic, assign, readonly) uint64_t fetchResultCacheMissCount;
+
+/**
+ *  Remove every cached fetch result and reset the hit and miss counts.
+ */
+- (void)clearFetchResultCache;
+
+// MARK: - Working Set
+/**
+ *  Keeps the context's realized objects within a budget by turning the least recently used back into faults.  Objects
+ *  fetched with `all:` & `objectOfClass:withValue:forKey:`, and objects inserted or updated in the context, are marked
+ *  as used.  Defaults to nil, no limit.
+ */
+@property (atomic, strong, nullable) MCTWorkingSet *workingSet;
+
 // MARK: - Prepare
 /**
  *  Prepare the context with a model file with the passed name
@@ -120,11 +207,61 @@ NS_ASSUME_NONNULL_BEGIN
 - (BOOL)prepareWithModel:(NSManagedObjectModel *)model storeURL:(nullable NSURL *)URL persistentStoreType:(nullable NSString *)storeType;
 - (BOOL)prepareWithModel:(NSManagedObjectModel *)model storeURL:(nullable NSURL *)URL persistentStoreType:(nullable NSString *)storeType contextType:(NSManagedObjectContextConcurrencyType)contextType error:(NSError **)error;
 
+/**
+ *  @param configuration Store options & SQLite pragmas.  If nil is passed `defaultPersistentStoreOptions` are used.
+ */
+- (BOOL)prepareWithModel:(NSManagedObjectModel *)model storeURL:(nullable NSURL *)URL persistentStoreType:(nullable NSString *)storeType configuration:(nullable MCTStoreConfiguration *)configuration contextType:(NSManagedObjectContextConcurrencyType)contextType error:(NSError **)error;
+
 - (BOOL)prepareWithPersistentStoreCoordinator:(NSPersistentStoreCoordinator *)coordinator contextType:(NSManagedObjectContextConcurrencyType)contextType error:(NSError **)error;
+/**
+ *  Prepare the context as a child of the parent's context.
+ *
+ *  @see newChildObjectContextWithType:error:
+ */
+- (BOOL)prepareWithParentObjectContext:(MCTObjectContext *)parent contextType:(NSManagedObjectContextConcurrencyType)contextType error:(NSError **)error;
 
+/**
+ *  Create a coordinator and add the store to it.  Safe to call from any thread.
+ *
+ *  When a progress is passed and the store was created with an earlier model version, the store is migrated before
+ *  it's added so the migration can report progress.  The progress is completed once the store is added.
+ *
+ *  @param storeType If nil is passed an in-memory store is used when there's no URL, otherwise SQLite.
+ *  @param progress  Optional progress to report the migration to.  Cancelling it cancels the migration.
+ */
++ (nullable NSPersistentStoreCoordinator *)newPersistentStoreCoordinatorWithModel:(NSManagedObjectModel *)model storeURL:(nullable NSURL *)URL persistentStoreType:(nullable NSString *)storeType progress:(nullable NSProgress *)progress error:(NSError **)error;
++ (nullable NSPersistentStoreCoordinator *)newPersistentStoreCoordinatorWithModel:(NSManagedObjectModel *)model storeURL:(nullable NSURL *)URL persistentStoreType:(nullable NSString *)storeType configuration:(nullable MCTStoreConfiguration *)configuration progress:(nullable NSProgress *)progress error:(NSError **)error;
+/**
+ *  Create a coordinator with a store for each shard.  Safe to call from any thread.
+ *
+ *  Shards aren't migrated up front, stores created with an earlier model version are migrated automatically when
+ *  they're added.
+ *
+ *  @param configuration Options for shards without their own `storeConfiguration`.  If nil is passed
+ *                       `defaultPersistentStoreOptions` are used.
+ */
++ (nullable NSPersistentStoreCoordinator *)newPersistentStoreCoordinatorWithModel:(NSManagedObjectModel *)model shards:(NSArray<MCTStoreShard *> *)shards configuration:(nullable MCTStoreConfiguration *)configuration error:(NSError **)error;
+
+/**
+ *  Load the momd (or mom) with the name from the bundle.  Every call for the same file returns the same instance, copy it
+ *  before making changes.
+ */
 + (nullable NSManagedObjectModel *)modelWithName:(NSString *)name bundle:(nullable NSBundle *)bundle;
 
 - (nullable instancetype)newObjectContextWithType:(NSManagedObjectContextConcurrencyType)contextType error:(NSError **)error;
+/**
+ *  Create a context whose saves push its changes into this context instead of the store.  After each push this context
+ *  writes them with `saveWithCompletion:`, so set `coalescesSaves` to group the pushes from several children into one
+ *  write.
+ *
+ *  Inserted objects are given permanent IDs when the child saves, which still reserves their primary keys in the store.
+ */
+- (nullable instancetype)newChildObjectContextWithType:(NSManagedObjectContextConcurrencyType)contextType error:(NSError **)error;
+
+/**
+ *  The context a child saves into.  nil for contexts that save to the store.
+ */
+@property (atomic, weak, readonly, nullable) MCTObjectContext *parentObjectContext;
 
 // MARK: - Meta
 /**
@@ -146,16 +283,278 @@ NS_ASSUME_NONNULL_BEGIN
 - (NSArray *)all:(Class)type predicate:(nullable NSPredicate *)predicate;
 - (NSArray *)all:(Class)type predicate:(nullable NSPredicate *)predicate sortDescriptors:(nullable NSArray *)sort;
 - (NSArray *)all:(Class)type predicate:(nullable NSPredicate *)predicate sortDescriptors:(nullable NSArray *)sort error:(NSError **)error;
+/**
+ *  Fetch every object of the type.  Pass YES for `bypassCache` to go to the store even when `cachesFetchResults` is on.
+ *  The result of a bypassed fetch isn't cached.
+ */
+- (NSArray *)all:(Class)type predicate:(nullable NSPredicate *)predicate sortDescriptors:(nullable NSArray *)sort bypassCache:(BOOL)bypassCache error:(NSError **)error;
 
 - (NSArray *)all:(Class)type where:(NSString *)fmt, ... NS_FORMAT_FUNCTION(2, 3);
 
 @end
 
+@interface MCTObjectContext (Indexes)
+
+/**
+ *  Keep an in-memory map from the attribute's values to object IDs for objects of the class.
+ *
+ *  The index covers objects registered in the context.  It's updated as objects are inserted, changed, deleted, merged
+ *  or refreshed, and cleared when the context is reset.  Values should be unique.
+ */
+- (void)indexAttribute:(NSString *)key ofClass:(Class)type;
+
+/**
+ *  Find the object of the class whose `key` equals `value`.
+ *
+ *  Indexed attributes are looked up in the index first, and the hit is checked against the object's current value so
+ *  changes made behind the context's back, like batch updates, can't return the wrong object.  A miss, or an attribute
+ *  that isn't indexed, falls back to a fetch, and the fetched object is added to the index.
+ */
+- (nullable id)objectOfClass:(Class)type withValue:(id)value forKey:(NSString *)key;
+- (nullable id)objectOfClass:(Class)type withValue:(id)value forKey:(NSString *)key error:(NSError **)error;
+
+@end
+
+@interface MCTObjectContext (Import)
+
+/**
+ *  Insert or update objects of `type` from an array of value dictionaries.
+ *
+ *  The import runs in a private context on the store's NSPersistentStoreCoordinator.  Values are processed in batches,
+ *  each batch resolves existing objects with a single `key IN (...)` fetch, creates only the missing objects, saves, and
+ *  then resets the private context so memory stays flat regardless of the number of values.
+ *
+ *  Values without a key value are always inserted.
+ *
+ *  @param type      The NSManagedObject subclass to import
+ *  @param values    The attribute values for each object
+ *  @param key       The attribute that uniquely identifies an object, e.g. `remoteID`
+ *  @param batchSize The number of values processed per fetch/save.  Pass 0 for the default.
+ *  @param error     Any fetch or save error that could be encountered
+ *
+ *  @return Import successful
+ */
+- (BOOL)import:(Class)type values:(NSArray<NSDictionary<NSString *, id> *> *)values uniqueKey:(NSString *)key batchSize:(NSUInteger)batchSize error:(NSError **)error;
+- (BOOL)import:(Class)type values:(NSArray<NSDictionary<NSString *, id> *> *)values uniqueKey:(NSString *)key error:(NSError **)error;
+
+@end
+
+@interface MCTObjectContext (Enumeration)
+
+/**
+ *  Walk the matching objects in `batchSize` chunks without loading the whole result.
+ *
+ *  Each batch continues from the last sort value seen instead of using a fetch offset, runs inside an autorelease pool,
+ *  and the context is reset afterwards so memory is bounded by the batch size.  Enumeration happens in a context from
+ *  `disposableContextPool`; objects are only valid inside the block and changes to them are discarded.
+ *
+ *  Objects sharing a sort value are enumerated in no particular order; the objects already returned with the last value
+ *  are excluded from the next batch, so a sort key with many repeated values is slower.  Objects with a nil value for
+ *  the sort key are enumerated after all the others.
+ *
+ *  @param type      The NSManagedObject subclass to enumerate
+ *  @param predicate The objects to enumerate.  If nil is passed all objects are enumerated.
+ *  @param sortKey   The attribute to order by & continue from.  An indexed attribute is fastest.
+ *  @param ascending The sort order
+ *  @param batchSize The number of objects fetched at once.  Pass 0 for the default.
+ *  @param error     Any fetch error that could be encountered
+ *  @param block     Called for each object.  Set stop to YES to end enumeration.
+ *
+ *  @return NO if a fetch failed
+ */
+- (BOOL)enumerate:(Class)type predicate:(nullable NSPredicate *)predicate sortKey:(NSString *)sortKey ascending:(BOOL)ascending batchSize:(NSUInteger)batchSize error:(NSError **)error usingBlock:(void(^)(__kindof NSManagedObject *object, BOOL *stop))block;
+
+@end
+
+typedef NS_ENUM(NSInteger, MCTObjectAggregateFunction) {
+    MCTObjectAggregateFunctionCount,
+    MCTObjectAggregateFunctionSum,
+    MCTObjectAggregateFunctionAverage,
+    MCTObjectAggregateFunctionMinimum,
+    MCTObjectAggregateFunctionMaximum
+};
+
+/**
+ *  Queries that return dictionaries computed by the store instead of managed objects.
+ *
+ *  These only reflect saved data, unsaved changes in the context are not included.
+ */
+@interface MCTObjectContext (Queries)
+
+/**
+ *  Fetch only the requested columns.
+ *
+ *  @param type       The NSManagedObject subclass to query
+ *  @param properties Attribute names, NSPropertyDescriptions, or NSExpressionDescriptions to fetch
+ *  @param groupBy    Attribute names to group by.  Every fetched attribute that isn't an aggregate must be included.
+ *  @param predicate  The objects to query.  If nil is passed all objects are queried.
+ *  @param sort       The order of the rows
+ *  @param distinct   Only return unique rows
+ *  @param error      Any fetch error that could be encountered
+ *
+ *  @return A dictionary per row keyed by property name, or nil on failure
+ */
+- (nullable NSArray<NSDictionary<NSString *, id> *> *)values:(Class)type properties:(NSArray *)properties groupBy:(nullable NSArray *)groupBy predicate:(nullable NSPredicate *)predicate sortDescriptors:(nullable NSArray<NSSortDescriptor *> *)sort distinct:(BOOL)distinct error:(NSError **)error;
+- (nullable NSArray<NSDictionary<NSString *, id> *> *)values:(Class)type properties:(NSArray *)properties predicate:(nullable NSPredicate *)predicate sortDescriptors:(nullable NSArray<NSSortDescriptor *> *)sort distinct:(BOOL)distinct error:(NSError **)error;
+
+/**
+ *  Compute an aggregate of `key` for each group.
+ *
+ *  @return A dictionary per group, with the group by values & the aggregate under `MCTObjectAggregateResultKey`
+ */
+- (nullable NSArray<NSDictionary<NSString *, id> *> *)aggregate:(Class)type function:(MCTObjectAggregateFunction)function key:(NSString *)key groupBy:(nullable NSArray<NSString *> *)groupBy predicate:(nullable NSPredicate *)predicate error:(NSError **)error;
+/**
+ *  Compute an aggregate of `key` across every matching object.
+ */
+- (nullable id)aggregate:(Class)type function:(MCTObjectAggregateFunction)function key:(NSString *)key predicate:(nullable NSPredicate *)predicate error:(NSError **)error;
+
++ (NSExpressionDescription *)expressionDescriptionForFunction:(MCTObjectAggregateFunction)function key:(NSString *)key entity:(nullable NSEntityDescription *)entity;
+
+@end
+
+FOUNDATION_EXTERN NSString *const MCTObjectAggregateResultKey;
+
+@interface MCTObjectContext (BatchRequests)
+
+/**
+ *  Delete all objects of `type` matching the predicate directly in the persistent store.
+ *
+ *  Objects are not loaded into memory.  The deleted objects are merged into this context before returning, and into every
+ *  other MCTObjectContext using the same NSPersistentStoreCoordinator asynchronously.
+ *
+ *  Only supported for SQLite stores.  Unsaved changes in the context are not considered.
+ *
+ *  @param type      The NSManagedObject subclass to delete
+ *  @param predicate The objects to delete.  If nil is passed all objects are deleted.
+ *  @param error     Any error that could be encountered
+ *
+ *  @return The object IDs of the deleted objects, or nil on failure
+ */
+- (nullable NSArray<NSManagedObjectID *> *)batchDelete:(Class)type predicate:(nullable NSPredicate *)predicate error:(NSError **)error NS_AVAILABLE(10_11, 9_0);
+
+/**
+ *  Update all objects of `type` matching the predicate directly in the persistent store.
+ *
+ *  Changes are merged the same way as `batchDelete:predicate:error:`
+ *
+ *  @param type      The NSManagedObject subclass to update
+ *  @param predicate The objects to update.  If nil is passed all objects are updated.
+ *  @param values    Attribute names mapped to the new value, either a constant or an NSExpression
+ *  @param error     Any error that could be encountered
+ *
+ *  @return The object IDs of the updated objects, or nil on failure
+ */
+- (nullable NSArray<NSManagedObjectID *> *)batchUpdate:(Class)type predicate:(nullable NSPredicate *)predicate values:(NSDictionary<NSString *, id> *)values error:(NSError **)error;
+
+/**
+ *  Merge changes made directly in the store into the context.
+ *
+ *  @param changes `NSDeletedObjectsKey` and/or `NSUpdatedObjectsKey` mapped to arrays of NSManagedObjectID
+ */
+- (void)mergeBatchChanges:(NSDictionary<NSString *, NSArray<NSManagedObjectID *> *> *)changes;
+
+@end
+
+FOUNDATION_EXTERN NSString *const MCTObjectContextDidExecuteBatchRequestNotification;
+
+/**
+ *  SQLite maintenance.  The stores are removed from the coordinator & added back, so every MCTObjectContext using the
+ *  coordinator is reset first.  Fails with MCTObjectStoreErrorUnsavedChanges if any of them have unsaved changes.
+ *
+ *  Call these when the app is idle, e.g. entering the background.
+ */
+@interface MCTObjectContext (Maintenance)
+
+/**
+ *  Copy the WAL back into the database & truncate it.
+ */
+- (BOOL)checkpointPersistentStores:(NSError **)error;
+/**
+ *  Rebuild the database to reclaim free pages, then update the query planner's statistics.
+ */
+- (BOOL)vacuumPersistentStores:(NSError **)error;
+
+/**
+ *  Destroy the store at the URL and add an empty one in its place, leaving the coordinator's other stores as they are.
+ *  Every MCTObjectContext using the coordinator is reset first, unsaved changes are discarded.
+ */
+- (BOOL)rebuildPersistentStoreAtURL:(NSURL *)URL error:(NSError **)error NS_AVAILABLE(10_11, 9_0);
+
+@end
+
+/**
+ *  Reading the persistent history of stores added with `tracksPersistentHistory`, to pick up changes saved by other
+ *  processes or coordinators.
+ */
+@interface MCTObjectContext (PersistentHistory)
+
+/**
+ *  The transactions saved after the token, oldest first, with their changes.
+ *
+ *  Fails with NSPersistentHistoryTokenExpiredError when history after the token has been deleted.
+ *
+ *  @param token If nil is passed all of the history is fetched.
+ */
+- (nullable NSArray<NSPersistentHistoryTransaction *> *)historyTransactionsAfterToken:(nullable NSPersistentHistoryToken *)token error:(NSError **)error NS_AVAILABLE(10_13, 11_0);
+- (nullable NSArray<NSPersistentHistoryTransaction *> *)historyTransactionsAfterDate:(NSDate *)date error:(NSError **)error NS_AVAILABLE(10_13, 11_0);
+
+/**
+ *  Merge the transactions' changes into this context, and every other MCTObjectContext using the coordinator, the same
+ *  way batch request changes are merged.
+ */
+- (void)mergeHistoryTransactions:(NSArray<NSPersistentHistoryTransaction *> *)transactions NS_AVAILABLE(10_13, 11_0);
+
+- (BOOL)deleteHistoryBeforeDate:(NSDate *)date error:(NSError **)error NS_AVAILABLE(10_13, 11_0);
+
+@end
+
+/**
+ *  Non-blocking versions of the perform, fetch, insert, & save methods.
+ *
+ *  Work is queued on the context with `performBlock:` and the returned future completes on the main queue unless another
+ *  queue is passed.  Managed objects in results are replaced with their (permanent) NSManagedObjectIDs, resolve them with
+ *  `mct_existingObjectsWithIDs:error:` in the context you use them from.
+ */
+@interface MCTObjectContext (Futures)
+
+/**
+ *  @param block   The work to perform.  Return the result, or nil and set the error.
+ *  @param queue   The queue the future completes on.  If nil is passed the main queue is used.
+ *  @param qos     The quality of service for the future's completion blocks.  The work runs on the context's queue.
+ */
+- (MCTObjectFuture *)futureAndReturnInContext:(id _Nullable(^)(NSManagedObjectContext *ctx, NSError **error))block queue:(nullable dispatch_queue_t)queue qualityOfService:(NSQualityOfService)qos;
+- (MCTObjectFuture *)futureAndReturnInContext:(id _Nullable(^)(NSManagedObjectContext *ctx, NSError **error))block;
+- (MCTObjectFuture *)futureInContext:(void(^)(NSManagedObjectContext *ctx))block;
+
+- (MCTObjectFuture<NSArray<NSManagedObjectID *> *> *)futureAll:(Class)type predicate:(nullable NSPredicate *)predicate sortDescriptors:(nullable NSArray *)sort;
+- (MCTObjectFuture<NSManagedObjectID *> *)futureInsertNewObject:(Class)type;
+- (MCTObjectFuture<NSNumber *> *)futureSave;
+
+@end
+
 @interface NSManagedObjectContext (MCTObjectStoreAdditions)
 
 - (BOOL)saveIfNeeded DEPRECATED_MSG_ATTRIBUTE("See saveIfNeeded: instead");
 - (BOOL)saveIfNeeded:(NSError **)error;
 
+/**
+ *  The objects for the IDs, in the same order.  Must be called on the context's queue.
+ *
+ *  @return nil if any object couldn't be found
+ */
+- (nullable NSArray<__kindof NSManagedObject *> *)mct_existingObjectsWithIDs:(NSArray<NSManagedObjectID *> *)objectIDs error:(NSError **)error;
+
+@end
+
+@interface NSPersistentStoreCoordinator (MCTObjectStoreAdditions)
+
+/**
+ *  The stores whose configuration includes the entity or any of its subentities.
+ *
+ *  @return nil when every store does, so requests don't need to be limited.
+ */
+- (nullable NSArray<NSPersistentStore *> *)mct_affectedStoresForEntityName:(NSString *)entityName;
+
 @end
 
 NS_ASSUME_NONNULL_END
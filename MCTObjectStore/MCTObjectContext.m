@@ -36,6 +36,18 @@
 #import "MCTObjectStoreError.h"
 #import "MCTObjectStoreHelpers.h"
 #import "MCTManagedObject.h"
+#import "MCTObjectContextRegistry.h"
+#import "MCTObjectContextPool.h"
+#import "MCTObjectFuture.h"
+#import "MCTFetchResultCache.h"
+#import "MCTAttributeIndex.h"
+#import "MCTObjectMetrics.h"
+#import "MCTObjectMigrator.h"
+#import "MCTStoreConfiguration.h"
+#import "MCTStoreShard.h"
+#import "MCTImportPlan.h"
+#import "MCTWorkingSet.h"
+#import "NSPredicate+MCTObjectStore.h"
 
 #define CHECK_TYPE_EXE(x_type) if (![type isSubclassOfClass:[NSManagedObject class]]) { \
 @throw [NSException exceptionWithName:MCTObjectStoreGenericException \
@@ -45,16 +57,78 @@
 
 #define __assert_var __attribute__((__unused__))
 
+static BOOL MCTEntityIsIncluded(NSEntityDescription *entity, NSSet<NSString *> *names) {
+    for (NSEntityDescription *current = entity; current != nil; current = current.superentity) {
+        if ([names containsObject:current.name]) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+static BOOL MCTAddPersistentStore(NSPersistentStoreCoordinator *psc, NSString *storeType, NSString *configurationName, NSURL *URL, NSDictionary *options, NSError **error) {
+    BOOL success = NO;
+
+    @try {
+        NSPersistentStore *store = [psc addPersistentStoreWithType:storeType configuration:configurationName URL:URL options:options error:error];
+        success = (store != nil);
+    }
+    @catch (NSException *exception) {
+        NSLog(@"Failed to add store.  Exception caught!");
+        NSLog(@"%@",exception);
+    }
+
+    return success;
+}
+
 @interface MCTObjectContext () {
     pthread_mutex_t _mutex;
+
+    NSMutableArray *_pendingSaveCompletions;
+    NSUInteger _pendingSaveGeneration;
+    BOOL _pendingSaveScheduled;
+
+    NSMutableArray *_pendingMerges;
+    BOOL _pendingMergeScheduled;
+    uint64_t _pendingMergeEnqueuedAt;
+
+    MCTFetchResultCache *_fetchResultCache;
+    BOOL _cachesFetchResults;
+
+    MCTWorkingSet *_workingSet;
+
+    // Entity name -> key -> index.  Only touched on the context's queue.
+    NSMutableDictionary<NSString *, NSMutableDictionary<NSString *, MCTAttributeIndex *> *> *_attributeIndexes;
 }
 
 @property (atomic, strong, readwrite) NSManagedObjectContext *context;
 
 @property (atomic, assign, readwrite, getter=isReady) BOOL ready;
 
+@property (atomic, strong, readwrite) MCTObjectContextPool *disposableContextPool;
+
+@property (atomic, weak, readwrite) MCTObjectContext *parentObjectContext;
+
+- (BOOL)savePendingInContext:(NSManagedObjectContext *)ctx error:(NSError *__autoreleasing*)error;
+- (void)didExecuteBatchRequestWithChanges:(NSDictionary *)changes;
+- (void)didUseObjects:(id<NSFastEnumeration>)objects;
+- (void)updateRetainsRegisteredObjects;
+
 @end
 
+static void(^MCTMeasuredBlock(MCTObjectMetrics *metrics, void(^block)(void)))(void) {
+    uint64_t enqueued = MCTObjectMetricsAbsoluteTime();
+    [metrics operationWillEnqueue];
+    return ^{
+        uint64_t start = MCTObjectMetricsAbsoluteTime();
+        [metrics operationDidDequeue];
+        uint64_t signpost = [metrics beginSignpostForOperation:MCTObjectMetricsOperationPerform];
+        block();
+        [metrics endSignpostForOperation:MCTObjectMetricsOperationPerform identifier:signpost];
+        [metrics recordOperation:MCTObjectMetricsOperationPerform waitTime:(start - enqueued) duration:(MCTObjectMetricsAbsoluteTime() - start) size:0];
+    };
+}
+
 @implementation MCTObjectContext
 @synthesize context = _context;
 @synthesize ready = _ready;
@@ -63,7 +137,10 @@
 - (void)setContext:(NSManagedObjectContext *)context {
     pthread_mutex_lock(&_mutex);
     _context = context;
+    MCTWorkingSet *workingSet = _workingSet;
     pthread_mutex_unlock(&_mutex);
+    workingSet.context = context;
+    [self updateRetainsRegisteredObjects];
 }
 - (NSManagedObjectContext *)context {
     pthread_mutex_lock(&_mutex);
@@ -82,6 +159,64 @@
     pthread_mutex_unlock(&_mutex);
     return ready;
 }
+- (void)setCachesFetchResults:(BOOL)cachesFetchResults {
+    pthread_mutex_lock(&_mutex);
+    _cachesFetchResults = cachesFetchResults;
+    pthread_mutex_unlock(&_mutex);
+    if (!cachesFetchResults) {
+        [_fetchResultCache removeAllObjects];
+    }
+}
+- (BOOL)cachesFetchResults {
+    pthread_mutex_lock(&_mutex);
+    BOOL caches = _cachesFetchResults;
+    pthread_mutex_unlock(&_mutex);
+    return caches;
+}
+- (void)setWorkingSet:(MCTWorkingSet *)workingSet {
+    pthread_mutex_lock(&_mutex);
+    MCTWorkingSet *old = _workingSet;
+    _workingSet = workingSet;
+    NSManagedObjectContext *ctx = _context;
+    pthread_mutex_unlock(&_mutex);
+    if (old != workingSet) {
+        old.context = nil;
+    }
+    workingSet.context = ctx;
+    [self updateRetainsRegisteredObjects];
+    [workingSet setNeedsTrim];
+}
+- (void)updateRetainsRegisteredObjects {
+    NSManagedObjectContext *ctx = self.context;
+    // The main context keeps its objects so they don't disappear from under the UI, unless a working set decides
+    // which objects stay realized.  Retained faults would never be released.
+    BOOL retains = (ctx.concurrencyType == NSMainQueueConcurrencyType && self.workingSet == nil);
+    [ctx performBlock:^{
+        ctx.retainsRegisteredObjects = retains;
+    }];
+}
+- (MCTWorkingSet *)workingSet {
+    pthread_mutex_lock(&_mutex);
+    MCTWorkingSet *workingSet = _workingSet;
+    pthread_mutex_unlock(&_mutex);
+    return workingSet;
+}
+- (void)setFetchResultCacheLimit:(NSUInteger)fetchResultCacheLimit {
+    _fetchResultCache.countLimit = fetchResultCacheLimit;
+}
+- (NSUInteger)fetchResultCacheLimit {
+    return _fetchResultCache.countLimit;
+}
+- (uint64_t)fetchResultCacheHitCount {
+    return _fetchResultCache.hitCount;
+}
+- (uint64_t)fetchResultCacheMissCount {
+    return _fetchResultCache.missCount;
+}
+- (void)clearFetchResultCache {
+    [_fetchResultCache removeAllObjects];
+    [_fetchResultCache resetStatistics];
+}
 
 // MARK: - Init
 - (instancetype)init {
@@ -92,6 +227,16 @@
         NSAssert(status == 0, @"Failed to create mutex for context");
 
         _ready = NO;
+
+        _coalescesSaves = NO;
+        _saveCoalescingInterval = 0.25;
+        _maximumPendingSaveChanges = 500;
+        _pendingSaveCompletions = [[NSMutableArray alloc] init];
+        _pendingMerges = [[NSMutableArray alloc] init];
+
+        _cachesFetchResults = NO;
+        _fetchResultCache = [[MCTFetchResultCache alloc] initWithCountLimit:100];
+        _attributeIndexes = [[NSMutableDictionary alloc] init];
 #if TARGET_OS_IPHONE
         [[NSNotificationCenter defaultCenter] addObserver:self
                                                  selector:@selector(applicationDidEnterBackgroundNotification:)
@@ -117,11 +262,14 @@
 - (void)applicationDidEnterBackgroundNotification:(NSNotification *)notification {
     if ([self isReady]) {
         [self save:NULL];
+        // A child's save only reaches its parent, wait for the parent to write it.
+        [self.parentObjectContext save:NULL];
     }
 }
 - (void)applicationWillTerminateNotification:(NSNotification *)notification {
     if ([self isReady]) {
         [self save:NULL];
+        [self.parentObjectContext save:NULL];
     }
 }
 
@@ -129,31 +277,24 @@
 - (void)performInContext:(void(^)(NSManagedObjectContext *ctx))block {
     MCTOSParamAssert(block);
     NSManagedObjectContext *ctx = self.context;
-    [ctx performBlockAndWait:^{
+    void(^work)(void) = ^{
         block(ctx);
-    }];
+    };
+    MCTObjectMetrics *metrics = self.metrics;
+    [ctx performBlockAndWait:(metrics ? MCTMeasuredBlock(metrics, work) : work)];
 }
 - (void)performAsyncInContext:(void(^)(NSManagedObjectContext *ctx))block {
     MCTOSParamAssert(block);
     NSManagedObjectContext *ctx = self.context;
-    [ctx performBlock:^{
+    void(^work)(void) = ^{
         block(ctx);
-    }];
+    };
+    MCTObjectMetrics *metrics = self.metrics;
+    [ctx performBlock:(metrics ? MCTMeasuredBlock(metrics, work) : work)];
 }
 - (void)performInDisposable:(void(^)(NSManagedObjectContext *ctx))block {
     MCTOSParamAssert(block);
-    NSManagedObjectContext *ctx = [[NSManagedObjectContext alloc] initWithConcurrencyType:NSPrivateQueueConcurrencyType];
-    ctx.persistentStoreCoordinator = self.context.persistentStoreCoordinator;
-    [ctx performBlockAndWait:^{
-        block(ctx);
-        NSError *error = nil;
-        if ([ctx hasChanges]) {
-            MCTOSLog(@"Saving disposable context");
-            if (![ctx save:&error]) {
-                [self.class handleSaveError:error inContext:ctx];
-            }
-        }
-    }];
+    [self.disposableContextPool performInContext:block];
 }
 
 + (BOOL)handleSaveError:(NSError *)error inContext:(NSManagedObjectContext *)ctx {
@@ -178,9 +319,11 @@
 
     id __block object = nil;
     NSManagedObjectContext *ctx = self.context;
-    [ctx performBlockAndWait:^{
+    void(^work)(void) = ^{
         object = block(ctx);
-    }];
+    };
+    MCTObjectMetrics *metrics = self.metrics;
+    [ctx performBlockAndWait:(metrics ? MCTMeasuredBlock(metrics, work) : work)];
 
     return object;
 }
@@ -204,25 +347,141 @@
 - (BOOL)save:(NSError *__autoreleasing*)error {
     BOOL __block success = YES;
     [self performInContext:^(NSManagedObjectContext *ctx) {
-        if ([ctx hasChanges]) {
-            MCTOSLog(@"Saving store %@",self);
-            if (![ctx save:error]) {
-                MCTOSLog(@"Failed to save store");
-                success = NO;
+        success = [self savePendingInContext:ctx error:error];
+    }];
+    return success;
+}
+
+- (void)saveWithCompletion:(void(^)(BOOL success, NSError *error))completion {
+    NSManagedObjectContext *ctx = self.context;
+
+    if (![self coalescesSaves]) {
+        [ctx performBlock:^{
+            NSError *error = nil;
+            BOOL success = [self savePendingInContext:ctx error:&error];
+            MCTOS_EXEC_BLOCK(completion, success, error);
+        }];
+        return;
+    }
+
+    pthread_mutex_lock(&_mutex);
+    if (completion) {
+        [_pendingSaveCompletions addObject:[completion copy]];
+    }
+    BOOL schedule = !_pendingSaveScheduled;
+    _pendingSaveScheduled = YES;
+    NSUInteger generation = _pendingSaveGeneration;
+    pthread_mutex_unlock(&_mutex);
+
+    if (schedule) {
+        dispatch_time_t when = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.saveCoalescingInterval * NSEC_PER_SEC));
+        dispatch_after(when, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+            [ctx performBlock:^{
+                [self savePendingInContext:ctx generation:generation];
+            }];
+        });
+    }
+
+    NSUInteger maximum = self.maximumPendingSaveChanges;
+    if (maximum > 0) {
+        [ctx performBlock:^{
+            NSUInteger changes = ctx.insertedObjects.count + ctx.updatedObjects.count + ctx.deletedObjects.count;
+            if (changes >= maximum) {
+                [self savePendingInContext:ctx generation:generation];
+            }
+        }];
+    }
+}
+
+- (void)savePendingInContext:(NSManagedObjectContext *)ctx generation:(NSUInteger)generation {
+    pthread_mutex_lock(&_mutex);
+    BOOL current = (generation == _pendingSaveGeneration);
+    pthread_mutex_unlock(&_mutex);
+    if (!current) {
+        // Already saved by a flush or an explicit save.
+        return;
+    }
+    [self savePendingInContext:ctx error:NULL];
+}
+
+/**
+ *  Must be called on the context's queue.  Saves the context and calls every pending completion with the result.
+ */
+- (BOOL)savePendingInContext:(NSManagedObjectContext *)ctx error:(NSError *__autoreleasing*)error {
+    pthread_mutex_lock(&_mutex);
+    NSArray *completions = [_pendingSaveCompletions copy];
+    [_pendingSaveCompletions removeAllObjects];
+    _pendingSaveGeneration++;
+    _pendingSaveScheduled = NO;
+    pthread_mutex_unlock(&_mutex);
+
+    BOOL success = YES;
+    BOOL saved = NO;
+    NSError *saveError = nil;
+    [MCTManagedObject revertNoOpUpdatesInContext:ctx];
+    if ([ctx hasChanges]) {
+        MCTOSLog(@"Saving store %@ (%lu coalesced)",self,(unsigned long)completions.count);
+        NSSet *inserted = ctx.insertedObjects;
+        if (ctx.parentContext && inserted.count > 0) {
+            // Temporary IDs stay temporary in the child after the parent writes, siblings & later fetches would see
+            // a different object.
+            if (![ctx obtainPermanentIDsForObjects:[inserted allObjects] error:&saveError]) {
+                MCTOSLog(@"Failed to obtain permanent IDs %@",saveError);
             }
         }
-    }];
+        MCTObjectMetrics *metrics = self.metrics;
+        uint64_t start = 0;
+        uint64_t signpost = 0;
+        NSUInteger size = 0;
+        if (metrics) {
+            size = ctx.insertedObjects.count + ctx.updatedObjects.count + ctx.deletedObjects.count;
+            signpost = [metrics beginSignpostForOperation:MCTObjectMetricsOperationSave];
+            start = MCTObjectMetricsAbsoluteTime();
+        }
+        if (![ctx save:&saveError]) {
+            MCTOSLog(@"Failed to save store");
+            success = NO;
+        }
+        saved = success;
+        if (metrics) {
+            [metrics endSignpostForOperation:MCTObjectMetricsOperationSave identifier:signpost];
+            [metrics recordOperation:MCTObjectMetricsOperationSave waitTime:0 duration:(MCTObjectMetricsAbsoluteTime() - start) size:size];
+        }
+    }
+
+    for (void(^completion)(BOOL, NSError *) in completions) {
+        completion(success, saveError);
+    }
+
+    if (saved) {
+        [self.parentObjectContext saveWithCompletion:nil];
+    }
+
+    if (!success && error != NULL) {
+        *error = saveError;
+    }
     return success;
 }
 
 // MARK: - Object Context Copy
 - (instancetype)newObjectContextWithType:(NSManagedObjectContextConcurrencyType)contextType error:(NSError **)error {
     typeof(self) obj = [[[self class] alloc] init];
+    obj.disposableContextPool = self.disposableContextPool;
+    obj.metrics = self.metrics;
     if (![obj prepareWithPersistentStoreCoordinator:self.context.persistentStoreCoordinator contextType:contextType error:error]) {
         return nil;
     }
     return obj;
 }
+- (instancetype)newChildObjectContextWithType:(NSManagedObjectContextConcurrencyType)contextType error:(NSError **)error {
+    typeof(self) obj = [[[self class] alloc] init];
+    obj.disposableContextPool = self.disposableContextPool;
+    obj.metrics = self.metrics;
+    if (![obj prepareWithParentObjectContext:self contextType:contextType error:error]) {
+        return nil;
+    }
+    return obj;
+}
 
 // MARK: - Prepare
 - (BOOL)prepareWithModelName:(NSString *)modelName bundle:(NSBundle *)bundle storeURL:(NSURL *)URL {
@@ -235,9 +494,24 @@
     return [self prepareWithModel:model storeURL:URL persistentStoreType:storeType contextType:NSMainQueueConcurrencyType error:NULL];
 }
 - (BOOL)prepareWithModel:(NSManagedObjectModel *)model storeURL:(NSURL *)URL persistentStoreType:(NSString *)storeType contextType:(NSManagedObjectContextConcurrencyType)contextType error:(NSError **)error {
+    return [self prepareWithModel:model storeURL:URL persistentStoreType:storeType configuration:nil contextType:contextType error:error];
+}
+- (BOOL)prepareWithModel:(NSManagedObjectModel *)model storeURL:(NSURL *)URL persistentStoreType:(NSString *)storeType configuration:(MCTStoreConfiguration *)configuration contextType:(NSManagedObjectContextConcurrencyType)contextType error:(NSError **)error {
     if (!model) {
         return NO;
     }
+    NSPersistentStoreCoordinator *psc = [self.class newPersistentStoreCoordinatorWithModel:model storeURL:URL persistentStoreType:storeType configuration:configuration progress:nil error:error];
+    if (!psc) {
+        return NO;
+    }
+
+    return [self prepareWithPersistentStoreCoordinator:psc contextType:contextType error:error];
+}
++ (NSPersistentStoreCoordinator *)newPersistentStoreCoordinatorWithModel:(NSManagedObjectModel *)model storeURL:(NSURL *)URL persistentStoreType:(NSString *)storeType progress:(NSProgress *)progress error:(NSError **)error {
+    return [self newPersistentStoreCoordinatorWithModel:model storeURL:URL persistentStoreType:storeType configuration:nil progress:progress error:error];
+}
++ (NSPersistentStoreCoordinator *)newPersistentStoreCoordinatorWithModel:(NSManagedObjectModel *)model storeURL:(NSURL *)URL persistentStoreType:(NSString *)storeType configuration:(MCTStoreConfiguration *)configuration progress:(NSProgress *)progress error:(NSError **)error {
+    MCTOSParamAssert(model);
     if (!storeType) {
         if (!URL) {
             storeType = NSInMemoryStoreType;
@@ -246,45 +520,98 @@
         }
     }
     NSPersistentStoreCoordinator *psc = [[NSPersistentStoreCoordinator alloc] initWithManagedObjectModel:model];
-    NSDictionary *options = [self.class defaultPersistentStoreOptions];
-
-    BOOL success = NO;
+    NSDictionary *options = (configuration) ? [configuration persistentStoreOptionsForStoreType:storeType] : [self defaultPersistentStoreOptions];
 
-    @try {
-        NSPersistentStore *store = [psc addPersistentStoreWithType:storeType configuration:nil URL:URL options:options error:error];
-        success = (store != nil);
-    }
-    @catch (NSException *exception) {
-        NSLog(@"Failed to add store.  Exception caught!");
-        NSLog(@"%@",exception);
+    // Migrating up front is the only way to get progress out of a migration.  Automatic migration still handles
+    // stores whose model version can't be found.
+    NSProgress *migration = nil;
+    if (progress) {
+        migration = [NSProgress progressWithTotalUnitCount:100 parent:progress pendingUnitCount:MAX(progress.totalUnitCount - 1, (int64_t)0)];
+        if (URL) {
+            NSArray *bundles = [[NSBundle allBundles] arrayByAddingObjectsFromArray:[NSBundle allFrameworks]];
+            MCTObjectMigrator *migrator = [[MCTObjectMigrator alloc] initWithModel:model bundles:bundles];
+            if ([migrator requiresMigrationOfStoreAtURL:URL type:storeType]) {
+                if ([migrator sourceModelForStoreAtURL:URL type:storeType]) {
+                    if (![migrator migrateStoreAtURL:URL type:storeType options:options progress:migration error:error]) {
+                        return nil;
+                    }
+                } else {
+                    MCTOSLog(@"No model version found for %@.  Falling back to automatic migration.",URL.path);
+                }
+            }
+        }
+        migration.completedUnitCount = migration.totalUnitCount;
     }
 
-    if (!success) {
-        return NO;
+    if (!MCTAddPersistentStore(psc, storeType, nil, URL, options, error)) {
+        return nil;
     }
+    progress.completedUnitCount = progress.totalUnitCount;
 
-    return [self prepareWithPersistentStoreCoordinator:psc contextType:contextType error:error];
+    return psc;
+}
++ (NSPersistentStoreCoordinator *)newPersistentStoreCoordinatorWithModel:(NSManagedObjectModel *)model shards:(NSArray<MCTStoreShard *> *)shards configuration:(MCTStoreConfiguration *)configuration error:(NSError **)error {
+    MCTOSParamAssert(model);
+    MCTOSParamAssert(shards.count > 0);
+    NSPersistentStoreCoordinator *psc = [[NSPersistentStoreCoordinator alloc] initWithManagedObjectModel:model];
+    for (MCTStoreShard *shard in shards) {
+        MCTOSParamAssert(!shard.configurationName || [model.configurations containsObject:shard.configurationName]);
+        MCTStoreConfiguration *storeConfiguration = shard.storeConfiguration ?: configuration;
+        NSDictionary *options = (storeConfiguration) ? [storeConfiguration persistentStoreOptionsForStoreType:shard.storeType] : [self defaultPersistentStoreOptions];
+        if (!MCTAddPersistentStore(psc, shard.storeType, shard.configurationName, shard.location, options, error)) {
+            MCTOSLog(@"Failed to add %@",shard);
+            return nil;
+        }
+    }
+    return psc;
 }
 - (BOOL)prepareWithPersistentStoreCoordinator:(NSPersistentStoreCoordinator *)coordinator contextType:(NSManagedObjectContextConcurrencyType)contextType error:(NSError **)error {
     MCTOSParamAssert(coordinator);
 
     NSManagedObjectContext *ctx = [[NSManagedObjectContext alloc] initWithConcurrencyType:contextType];
     ctx.persistentStoreCoordinator = coordinator;
+    self.parentObjectContext = nil;
+    return [self prepareWithManagedObjectContext:ctx contextType:contextType coordinator:coordinator];
+}
+- (BOOL)prepareWithParentObjectContext:(MCTObjectContext *)parent contextType:(NSManagedObjectContextConcurrencyType)contextType error:(NSError **)error {
+    NSManagedObjectContext *parentCtx = parent.context;
+    MCTOSParamAssert(parentCtx);
+
+    NSManagedObjectContext *ctx = [[NSManagedObjectContext alloc] initWithConcurrencyType:contextType];
+    ctx.parentContext = parentCtx;
+    self.parentObjectContext = parent;
+    return [self prepareWithManagedObjectContext:ctx contextType:contextType coordinator:parentCtx.persistentStoreCoordinator];
+}
+- (BOOL)prepareWithManagedObjectContext:(NSManagedObjectContext *)ctx contextType:(NSManagedObjectContextConcurrencyType)contextType coordinator:(NSPersistentStoreCoordinator *)coordinator {
     ctx.mergePolicy = NSMergeByPropertyObjectTrumpMergePolicy;
-    ctx.retainsRegisteredObjects = (contextType == NSMainQueueConcurrencyType);
+    ctx.retainsRegisteredObjects = (contextType == NSMainQueueConcurrencyType && self.workingSet == nil);
     if ([ctx respondsToSelector:@selector(setShouldDeleteInaccessibleFaults:)]) {
         [ctx setShouldDeleteInaccessibleFaults:YES];
     }
 
     self.context = ctx;
+    [_fetchResultCache removeAllObjects];
+    [self updateAttributeIndexesWithChanges:@{NSInvalidatedAllObjectsKey: @YES}];
+
+    if (self.disposableContextPool.persistentStoreCoordinator != coordinator) {
+        NSUInteger maximum = MAX((NSUInteger)2, [NSProcessInfo processInfo].activeProcessorCount);
+        self.disposableContextPool = [[MCTObjectContextPool alloc] initWithPersistentStoreCoordinator:coordinator maximumContexts:maximum];
+    }
 
     self.ready = YES;
 
+    [[MCTObjectContextRegistry sharedRegistry] registerContext:self coordinator:coordinator];
+
     [[NSNotificationCenter defaultCenter] addObserver:self
-                                             selector:@selector(contextDidSaveNotification:)
-                                                 name:NSManagedObjectContextDidSaveNotification
+                                             selector:@selector(contextDidExecuteBatchRequestNotification:)
+                                                 name:MCTObjectContextDidExecuteBatchRequestNotification
                                                object:nil];
 
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(contextObjectsDidChangeNotification:)
+                                                 name:NSManagedObjectContextObjectsDidChangeNotification
+                                               object:ctx];
+
     return YES;
 }
 
@@ -304,26 +631,263 @@
     if (!URL) {
         return nil;
     }
-    return [[NSManagedObjectModel alloc] initWithContentsOfURL:URL];
+
+    // Loaded models are kept for the life of the process.  Sharing one instance also shares its import plans.
+    static NSMutableDictionary<NSURL *, NSManagedObjectModel *> *models;
+    static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_lock(&mutex);
+    if (!models) {
+        models = [NSMutableDictionary dictionary];
+    }
+    NSManagedObjectModel *model = models[URL];
+    pthread_mutex_unlock(&mutex);
+    if (model) {
+        return model;
+    }
+
+    model = [[NSManagedObjectModel alloc] initWithContentsOfURL:URL];
+    if (!model) {
+        return nil;
+    }
+    pthread_mutex_lock(&mutex);
+    NSManagedObjectModel *loaded = models[URL];
+    if (loaded) {
+        model = loaded;
+    } else {
+        models[URL] = model;
+    }
+    pthread_mutex_unlock(&mutex);
+    return model;
 }
 
 // MARK: - Save Changes
+/**
+ *  Called by the MCTObjectContextRegistry for saves to the same NSPersistentStoreCoordinator, on the saving context's queue.
+ *
+ *  Saves that arrive before the context's queue gets to them are merged together with a single merge.
+ */
 - (void)contextDidSaveNotification:(NSNotification *)notification {
     NSManagedObjectContext *_ctx = [notification object];
     NSManagedObjectContext *lCtx = self.context;
     if (_ctx == lCtx) {
-        // We don't care about self
+        // Saving gave inserted objects permanent IDs.
+        [self updateAttributeIndexesWithChanges:@{NSInsertedObjectsKey: notification.userInfo[NSInsertedObjectsKey] ?: [NSSet set]}];
+        return;
+    }
+    if (_ctx == lCtx.parentContext) {
+        // The parent writing changes pushed by this context or its siblings, which were merged when they were pushed.
         return;
     }
     if (_ctx.persistentStoreCoordinator != lCtx.persistentStoreCoordinator) {
         // Different database
         return;
     }
+
+    if (self.cachesFetchResults) {
+        // Invalidate on the saving queue so a fetch started after the save returns can't see a stale result.
+        for (NSString *key in @[NSInsertedObjectsKey, NSUpdatedObjectsKey, NSDeletedObjectsKey]) {
+            [_fetchResultCache invalidateObjects:notification.userInfo[key]];
+        }
+    }
+
+    NSDictionary *changes = [self objectIDChangesFromSaveNotification:notification];
+    if (!changes) {
+        return;
+    }
+
+    pthread_mutex_lock(&_mutex);
+    [_pendingMerges addObject:@[notification, changes]];
+    BOOL schedule = !_pendingMergeScheduled;
+    _pendingMergeScheduled = YES;
+    if (schedule) {
+        _pendingMergeEnqueuedAt = MCTObjectMetricsAbsoluteTime();
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (schedule) {
+        void(^merge)(void) = ^{
+            [lCtx performBlock:^{
+                [self mergePendingChangesInContext:lCtx];
+            }];
+        };
+        NSManagedObjectContext *parentCtx = lCtx.parentContext;
+        if (parentCtx && !_ctx.parentContext) {
+            // Store saves are merged into the parent first.  Wait for it so refreshed objects aren't faulted from its
+            // stale copies.
+            [parentCtx performBlock:merge];
+        } else {
+            merge();
+        }
+    }
+}
+
+- (nullable NSDictionary<NSString *, NSSet<NSManagedObjectID *> *> *)objectIDChangesFromSaveNotification:(NSNotification *)notification {
+    NSSet *entityNames = self.mergeEntityNames;
+    NSMutableDictionary *changes = [NSMutableDictionary dictionaryWithCapacity:3];
+    for (NSString *key in @[NSInsertedObjectsKey, NSUpdatedObjectsKey, NSDeletedObjectsKey]) {
+        NSSet *objects = notification.userInfo[key];
+        NSMutableSet *objectIDs = [NSMutableSet setWithCapacity:objects.count];
+        for (NSManagedObject *object in objects) {
+            if (entityNames && !MCTEntityIsIncluded(object.entity, entityNames)) {
+                continue;
+            }
+            [objectIDs addObject:object.objectID];
+        }
+        changes[key] = objectIDs;
+    }
+    if ([changes[NSInsertedObjectsKey] count] + [changes[NSUpdatedObjectsKey] count] + [changes[NSDeletedObjectsKey] count] == 0) {
+        return nil;
+    }
+    return changes;
+}
+
+- (void)mergePendingChangesInContext:(NSManagedObjectContext *)ctx {
+    pthread_mutex_lock(&_mutex);
+    NSArray *pending = [_pendingMerges copy];
+    [_pendingMerges removeAllObjects];
+    _pendingMergeScheduled = NO;
+    uint64_t enqueuedAt = _pendingMergeEnqueuedAt;
+    pthread_mutex_unlock(&_mutex);
+
+    if (pending.count == 0) {
+        return;
+    }
+
+    if (![NSManagedObjectContext respondsToSelector:@selector(mergeChangesFromRemoteContextSave:intoContexts:)]) {
+        for (NSArray *entry in pending) {
+            [ctx mergeChangesFromContextDidSaveNotification:entry[0]];
+        }
+        return;
+    }
+
+    NSMutableSet *inserted = [NSMutableSet set];
+    NSMutableSet *updated = [NSMutableSet set];
+    NSMutableSet *deleted = [NSMutableSet set];
+    for (NSArray *entry in pending) {
+        NSDictionary *changes = entry[1];
+        [inserted unionSet:changes[NSInsertedObjectsKey]];
+        [updated unionSet:changes[NSUpdatedObjectsKey]];
+
+        NSSet *deletes = changes[NSDeletedObjectsKey];
+        [inserted minusSet:deletes];
+        [updated minusSet:deletes];
+        [deleted unionSet:deletes];
+    }
+
+    // Objects that aren't registered have nothing in memory to refresh.
+    NSMutableArray *registeredUpdates = [NSMutableArray arrayWithCapacity:updated.count];
+    for (NSManagedObjectID *objectID in updated) {
+        if ([ctx objectRegisteredForID:objectID]) {
+            [registeredUpdates addObject:objectID];
+        }
+    }
+    NSMutableArray *registeredDeletes = [NSMutableArray arrayWithCapacity:deleted.count];
+    for (NSManagedObjectID *objectID in deleted) {
+        if ([ctx objectRegisteredForID:objectID]) {
+            [registeredDeletes addObject:objectID];
+        }
+    }
+
+    if (inserted.count + registeredUpdates.count + registeredDeletes.count == 0) {
+        return;
+    }
+
+    MCTOSLog(@"Merging %lu saves into %@",(unsigned long)pending.count,self);
+    NSDictionary *changes = @{
+                              NSInsertedObjectsKey: [inserted allObjects],
+                              NSUpdatedObjectsKey: registeredUpdates,
+                              NSDeletedObjectsKey: registeredDeletes
+                              };
+    MCTObjectMetrics *metrics = self.metrics;
+    if (!metrics) {
+        [NSManagedObjectContext mergeChangesFromRemoteContextSave:changes intoContexts:@[ctx]];
+        return;
+    }
+    uint64_t start = MCTObjectMetricsAbsoluteTime();
+    uint64_t signpost = [metrics beginSignpostForOperation:MCTObjectMetricsOperationMerge];
+    [NSManagedObjectContext mergeChangesFromRemoteContextSave:changes intoContexts:@[ctx]];
+    [metrics endSignpostForOperation:MCTObjectMetricsOperationMerge identifier:signpost];
+    [metrics recordOperation:MCTObjectMetricsOperationMerge waitTime:(start - MIN(start, enqueuedAt)) duration:(MCTObjectMetricsAbsoluteTime() - start) size:(inserted.count + registeredUpdates.count + registeredDeletes.count)];
+}
+
+- (void)contextObjectsDidChangeNotification:(NSNotification *)notification {
+    if (notification.object != self.context) {
+        return;
+    }
+    NSDictionary *userInfo = notification.userInfo;
+    [self updateAttributeIndexesWithChanges:userInfo];
+    // Refreshed objects aren't used, trimming the working set refreshes them.
+    [self didUseObjects:userInfo[NSInsertedObjectsKey]];
+    [self didUseObjects:userInfo[NSUpdatedObjectsKey]];
+    if (!self.cachesFetchResults) {
+        return;
+    }
+    if (userInfo[NSInvalidatedAllObjectsKey]) {
+        [_fetchResultCache removeAllObjects];
+        return;
+    }
+    for (NSString *key in @[NSInsertedObjectsKey, NSUpdatedObjectsKey, NSDeletedObjectsKey, NSRefreshedObjectsKey, NSInvalidatedObjectsKey]) {
+        [_fetchResultCache invalidateObjects:userInfo[key]];
+    }
+}
+
+- (void)contextDidExecuteBatchRequestNotification:(NSNotification *)notification {
+    MCTObjectContext *_obj = [notification object];
+    if (_obj == self) {
+        // Already merged
+        return;
+    }
+    NSManagedObjectContext *lCtx = self.context;
+    if (_obj.context.persistentStoreCoordinator != lCtx.persistentStoreCoordinator) {
+        // Different database
+        return;
+    }
+    NSDictionary *changes = [notification userInfo];
+    if (self.cachesFetchResults) {
+        for (NSString *key in @[NSUpdatedObjectsKey, NSDeletedObjectsKey]) {
+            [_fetchResultCache invalidateObjects:changes[key]];
+        }
+    }
     [lCtx performBlock:^{
-        [lCtx mergeChangesFromContextDidSaveNotification:notification];
+        [self mergeBatchChanges:changes];
     }];
 }
 
+// MARK: - Attribute Indexes
+/**
+ *  Apply a NSManagedObjectContextObjectsDidChangeNotification style change set to the attribute indexes.
+ *
+ *  Must be called on the context's queue.
+ */
+- (void)updateAttributeIndexesWithChanges:(NSDictionary *)changes {
+    if (_attributeIndexes.count == 0) {
+        return;
+    }
+    if (changes[NSInvalidatedAllObjectsKey]) {
+        for (NSDictionary *indexes in _attributeIndexes.objectEnumerator) {
+            for (MCTAttributeIndex *index in indexes.objectEnumerator) {
+                [index removeAllObjects];
+            }
+        }
+        return;
+    }
+    for (NSString *key in @[NSInsertedObjectsKey, NSUpdatedObjectsKey, NSRefreshedObjectsKey, NSDeletedObjectsKey, NSInvalidatedObjectsKey]) {
+        BOOL removed = ([key isEqualToString:NSDeletedObjectsKey] || [key isEqualToString:NSInvalidatedObjectsKey]);
+        for (NSManagedObject *object in changes[key]) {
+            for (NSEntityDescription *entity = object.entity; entity != nil; entity = entity.superentity) {
+                NSDictionary *indexes = _attributeIndexes[entity.name];
+                for (MCTAttributeIndex *index in indexes.objectEnumerator) {
+                    if (removed) {
+                        [index removeObjectID:object.objectID];
+                    } else {
+                        [index addObject:object];
+                    }
+                }
+            }
+        }
+    }
+}
+
 // MARK: - Meta
 - (BOOL)isMainThreadContext {
     if (![self isReady]) {
@@ -356,34 +920,852 @@
     return [self all:type predicate:predicate sortDescriptors:sort error:NULL];
 }
 - (NSArray *)all:(Class)type predicate:(NSPredicate *)predicate sortDescriptors:(NSArray *)sort error:(NSError *__autoreleasing*)error {
+    return [self all:type predicate:predicate sortDescriptors:sort bypassCache:NO error:error];
+}
+- (NSArray *)all:(Class)type predicate:(NSPredicate *)predicate sortDescriptors:(NSArray *)sort bypassCache:(BOOL)bypassCache error:(NSError *__autoreleasing*)error {
     CHECK_TYPE_EXE(type);
+    MCTFetchResultCache *cache = (!bypassCache && self.cachesFetchResults) ? _fetchResultCache : nil;
     NSArray __block *arr = nil;
     [self performInContext:^(NSManagedObjectContext *ctx) {
         NSFetchRequest *fetchRequest = [NSFetchRequest fetchRequestWithEntityName:NSStringFromClass(type)];
         fetchRequest.predicate = predicate;
+        fetchRequest.affectedStores = [ctx.persistentStoreCoordinator mct_affectedStoresForEntityName:fetchRequest.entityName];
         fetchRequest.sortDescriptors = sort;
-        arr = [ctx executeFetchRequest:fetchRequest error:error];
+        if (!cache) {
+            arr = [self executeFetchRequest:fetchRequest inContext:ctx error:error];
+            return;
+        }
+
+        // Processing pending changes posts NSManagedObjectContextObjectsDidChangeNotification, which invalidates any
+        // result they affect before it's looked up.
+        [ctx processPendingChanges];
+
+        NSArray *objectIDs = [cache objectIDsForFetchRequest:fetchRequest];
+        if (objectIDs) {
+            NSMutableArray *objects = [NSMutableArray arrayWithCapacity:objectIDs.count];
+            for (NSManagedObjectID *objectID in objectIDs) {
+                [objects addObject:[ctx objectWithID:objectID]];
+            }
+            arr = [objects copy];
+            return;
+        }
+
+        NSUInteger generation = cache.generation;
+        arr = [self executeFetchRequest:fetchRequest inContext:ctx error:error];
+        NSEntityDescription *entity = [NSEntityDescription entityForName:fetchRequest.entityName inManagedObjectContext:ctx];
+        if (arr && entity) {
+            [cache setObjects:arr forFetchRequest:fetchRequest entity:entity generation:generation];
+        }
     }];
+    [self didUseObjects:arr];
     return arr;
 }
 
+/**
+ *  Mark the objects as recently used in the working set, if there is one.
+ */
+- (void)didUseObjects:(id<NSFastEnumeration>)objects {
+    MCTWorkingSet *workingSet = self.workingSet;
+    if (!workingSet || !objects) {
+        return;
+    }
+    [workingSet touchObjects:objects];
+    [workingSet setNeedsTrim];
+}
+
+/**
+ *  Must be called on the context's queue.
+ */
+- (NSArray *)executeFetchRequest:(NSFetchRequest *)fetchRequest inContext:(NSManagedObjectContext *)ctx error:(NSError *__autoreleasing*)error {
+    MCTObjectMetrics *metrics = self.metrics;
+    if (!metrics) {
+        return [ctx executeFetchRequest:fetchRequest error:error];
+    }
+    uint64_t start = MCTObjectMetricsAbsoluteTime();
+    uint64_t signpost = [metrics beginSignpostForOperation:MCTObjectMetricsOperationFetch];
+    NSArray *result = [ctx executeFetchRequest:fetchRequest error:error];
+    [metrics endSignpostForOperation:MCTObjectMetricsOperationFetch identifier:signpost];
+    [metrics recordOperation:MCTObjectMetricsOperationFetch waitTime:0 duration:(MCTObjectMetricsAbsoluteTime() - start) size:result.count];
+    return result;
+}
+
 - (NSArray *)all:(Class)type where:(NSString *)fmt, ... {
     va_list arguments;
     va_start(arguments, fmt);
-    NSPredicate *predicate = [NSPredicate predicateWithFormat:fmt arguments:arguments];
+    NSPredicate *predicate = [NSPredicate mct_cachedPredicateWithFormat:fmt arguments:arguments];
     va_end(arguments);
     return [self all:type predicate:predicate];
 }
 
 @end
 
+@implementation MCTObjectContext (Indexes)
 
-@implementation NSManagedObjectContext (MCTObjectStoreAdditions)
-
-- (BOOL)saveIfNeeded {
+- (void)indexAttribute:(NSString *)key ofClass:(Class)type {
+    CHECK_TYPE_EXE(type);
+    MCTOSParamAssert(key);
+    [self performInContext:^(NSManagedObjectContext *ctx) {
+        NSString *entityName = [type entityName];
+        NSMutableDictionary *indexes = _attributeIndexes[entityName];
+        if (!indexes) {
+            indexes = [NSMutableDictionary dictionary];
+            _attributeIndexes[entityName] = indexes;
+        }
+        if (indexes[key]) {
+            return;
+        }
+        MCTAttributeIndex *index = [[MCTAttributeIndex alloc] initWithKey:key];
+        indexes[key] = index;
+
+        NSEntityDescription *entity = [type entityInContext:ctx];
+        for (NSManagedObject *object in ctx.registeredObjects) {
+            if ([object.entity isKindOfEntity:entity]) {
+                [index addObject:object];
+            }
+        }
+    }];
+}
+
+- (id)objectOfClass:(Class)type withValue:(id)value forKey:(NSString *)key {
+    return [self objectOfClass:type withValue:value forKey:key error:NULL];
+}
+- (id)objectOfClass:(Class)type withValue:(id)value forKey:(NSString *)key error:(NSError *__autoreleasing*)error {
+    CHECK_TYPE_EXE(type);
+    MCTOSParamAssert(value);
+    MCTOSParamAssert(key);
+    id __block object = nil;
+    [self performInContext:^(NSManagedObjectContext *ctx) {
+        NSString *entityName = [type entityName];
+        MCTAttributeIndex *index = _attributeIndexes[entityName][key];
+        NSManagedObjectID *objectID = [index objectIDForValue:value];
+        if (objectID) {
+            NSManagedObject *candidate = [ctx existingObjectWithID:objectID error:NULL];
+            if (candidate && !candidate.isDeleted && [[candidate valueForKey:key] isEqual:value]) {
+                object = candidate;
+                return;
+            }
+            [index removeObjectID:objectID];
+        }
+
+        NSFetchRequest *fetchRequest = [NSFetchRequest fetchRequestWithEntityName:entityName];
+        fetchRequest.predicate = [NSPredicate predicateWithFormat:@"%K == %@",key,value];
+        fetchRequest.affectedStores = [ctx.persistentStoreCoordinator mct_affectedStoresForEntityName:entityName];
+        fetchRequest.fetchLimit = 1;
+        object = [[ctx executeFetchRequest:fetchRequest error:error] firstObject];
+        if (object) {
+            [index addObject:object];
+        }
+    }];
+    if (object) {
+        [self didUseObjects:@[object]];
+    }
+    return object;
+}
+
+@end
+
+static NSUInteger const MCTObjectContextDefaultImportBatchSize = 500;
+
+@implementation MCTObjectContext (Import)
+
+- (BOOL)import:(Class)type values:(NSArray<NSDictionary<NSString *, id> *> *)values uniqueKey:(NSString *)key error:(NSError *__autoreleasing*)error {
+    return [self import:type values:values uniqueKey:key batchSize:0 error:error];
+}
+- (BOOL)import:(Class)type values:(NSArray<NSDictionary<NSString *, id> *> *)values uniqueKey:(NSString *)key batchSize:(NSUInteger)batchSize error:(NSError *__autoreleasing*)error {
+    CHECK_TYPE_EXE(type);
+    MCTOSParamAssert(key);
+
+    if (values.count == 0) {
+        return YES;
+    }
+    if (batchSize == 0) {
+        batchSize = MCTObjectContextDefaultImportBatchSize;
+    }
+
+    BOOL __block success = YES;
+    NSError __block *importError = nil;
+    [self.disposableContextPool performInContext:^(NSManagedObjectContext *ctx) {
+        ctx.mergePolicy = NSMergeByPropertyObjectTrumpMergePolicy;
+
+        NSUInteger count = values.count;
+        for (NSUInteger offset = 0; offset < count && success; offset += batchSize) {
+            @autoreleasepool {
+                NSArray *batch = [values subarrayWithRange:NSMakeRange(offset, MIN(batchSize, count - offset))];
+                NSError *batchError = nil;
+                if (![self importBatch:batch type:type uniqueKey:key inContext:ctx error:&batchError]) {
+                    MCTOSLog(@"Failed to import batch at offset %lu: %@",(unsigned long)offset,batchError);
+                    importError = batchError;
+                    success = NO;
+                }
+                [ctx reset];
+            }
+        }
+    }];
+
+    if (!success && error != NULL) {
+        *error = importError;
+    }
+    return success;
+}
+
+- (BOOL)importBatch:(NSArray<NSDictionary<NSString *, id> *> *)batch type:(Class)type uniqueKey:(NSString *)key inContext:(NSManagedObjectContext *)ctx error:(NSError *__autoreleasing*)error {
+    MCTImportPlan *plan = [MCTImportPlan planForClass:type context:ctx];
+    // The unique key can be a remote key, values are matched after they're converted to the attribute's type.
+    NSString *attribute = [plan propertyNameForKey:key] ?: key;
+
+    NSMutableArray *keyValues = [NSMutableArray arrayWithCapacity:batch.count];
+    for (NSDictionary *value in batch) {
+        id keyValue = (plan) ? [plan coercedValue:value[key] forKey:key] : value[key];
+        if (keyValue && keyValue != [NSNull null]) {
+            [keyValues addObject:keyValue];
+        }
+    }
+
+    NSMutableDictionary *existing = [NSMutableDictionary dictionaryWithCapacity:batch.count];
+    if (keyValues.count > 0) {
+        NSFetchRequest *fetchRequest = [NSFetchRequest fetchRequestWithEntityName:[type entityName]];
+        fetchRequest.predicate = [NSPredicate predicateWithFormat:@"%K IN %@",attribute,keyValues];
+        fetchRequest.affectedStores = [ctx.persistentStoreCoordinator mct_affectedStoresForEntityName:fetchRequest.entityName];
+        fetchRequest.returnsObjectsAsFaults = NO;
+        NSArray *objects = [ctx executeFetchRequest:fetchRequest error:error];
+        if (!objects) {
+            return NO;
+        }
+        for (NSManagedObject *object in objects) {
+            id keyValue = [object valueForKey:attribute];
+            if (keyValue) {
+                existing[keyValue] = object;
+            }
+        }
+    }
+
+    for (NSDictionary *value in batch) {
+        id keyValue = (plan) ? [plan coercedValue:value[key] forKey:key] : value[key];
+        if (keyValue == [NSNull null]) {
+            keyValue = nil;
+        }
+        NSManagedObject *object = (keyValue) ? existing[keyValue] : nil;
+        if (!object) {
+            object = [type insertIntoContext:ctx];
+            if (keyValue) {
+                existing[keyValue] = object;
+            }
+        }
+        if (plan) {
+            [plan applyValues:value toObject:object];
+        } else {
+            [object setValuesForKeysWithDictionary:value];
+        }
+    }
+
+    [MCTManagedObject revertNoOpUpdatesInContext:ctx];
+    if (![ctx hasChanges]) {
+        return YES;
+    }
+    NSError *saveError = nil;
+    if ([ctx save:&saveError]) {
+        return YES;
+    }
+    if ([self.class handleSaveError:saveError inContext:ctx]) {
+        return YES;
+    }
+    if (error != NULL) {
+        *error = saveError;
+    }
+    return NO;
+}
+
+@end
+
+
+static NSUInteger const MCTObjectContextDefaultEnumerationBatchSize = 500;
+
+@implementation MCTObjectContext (Enumeration)
+
+- (BOOL)enumerate:(Class)type predicate:(NSPredicate *)predicate sortKey:(NSString *)sortKey ascending:(BOOL)ascending batchSize:(NSUInteger)batchSize error:(NSError *__autoreleasing*)error usingBlock:(void(^)(__kindof NSManagedObject *object, BOOL *stop))block {
+    CHECK_TYPE_EXE(type);
+    MCTOSParamAssert(sortKey);
+    MCTOSParamAssert(block);
+
+    if (batchSize == 0) {
+        batchSize = MCTObjectContextDefaultEnumerationBatchSize;
+    }
+
+    // Core Data can't order by object identity, so ties on the sort value are continued by excluding the objects
+    // already returned with the last value.
+    NSArray *sortDescriptors = @[[NSSortDescriptor sortDescriptorWithKey:sortKey ascending:ascending]];
+    NSString *cursorFormat = (ascending) ? @"%K > %@ OR (%K == %@ AND NOT (SELF IN %@))" : @"%K < %@ OR (%K == %@ AND NOT (SELF IN %@))";
+
+    BOOL __block success = YES;
+    NSError __block *enumerationError = nil;
+    [self.disposableContextPool performInContext:^(NSManagedObjectContext *ctx) {
+        id lastValue = nil;
+        NSMutableArray<NSManagedObjectID *> *tiedIDs = [NSMutableArray array];
+        // Objects with a nil sort value can't be compared, they're walked after everything else.
+        BOOL nilValues = NO;
+        BOOL stop = NO;
+        BOOL finished = NO;
+
+        while (!stop && !finished) {
+            @autoreleasepool {
+                NSPredicate *cursor = nil;
+                if (nilValues) {
+                    cursor = [NSPredicate predicateWithFormat:@"%K == nil AND NOT (SELF IN %@)",sortKey,tiedIDs];
+                } else if (lastValue) {
+                    cursor = [NSPredicate predicateWithFormat:cursorFormat,sortKey,lastValue,sortKey,lastValue,tiedIDs];
+                } else {
+                    cursor = [NSPredicate predicateWithFormat:@"%K != nil",sortKey];
+                }
+
+                NSFetchRequest *fetchRequest = [NSFetchRequest fetchRequestWithEntityName:[type entityName]];
+                fetchRequest.predicate = (predicate) ? [NSCompoundPredicate andPredicateWithSubpredicates:@[predicate, cursor]] : cursor;
+                fetchRequest.affectedStores = [ctx.persistentStoreCoordinator mct_affectedStoresForEntityName:fetchRequest.entityName];
+                fetchRequest.sortDescriptors = (nilValues) ? nil : sortDescriptors;
+                fetchRequest.fetchLimit = batchSize;
+                fetchRequest.returnsObjectsAsFaults = NO;
+
+                NSError *fetchError = nil;
+                NSArray *objects = [ctx executeFetchRequest:fetchRequest error:&fetchError];
+                if (!objects) {
+                    MCTOSLog(@"Failed to fetch batch: %@",fetchError);
+                    enumerationError = fetchError;
+                    success = NO;
+                    finished = YES;
+                } else {
+                    for (NSManagedObject *object in objects) {
+                        block(object, &stop);
+                        if (stop) {
+                            break;
+                        }
+                    }
+
+                    if (objects.count < batchSize) {
+                        finished = nilValues;
+                        nilValues = YES;
+                        [tiedIDs removeAllObjects];
+                    } else {
+                        for (NSManagedObject *object in objects) {
+                            id value = [object valueForKey:sortKey];
+                            if (!nilValues && ![value isEqual:lastValue]) {
+                                lastValue = value;
+                                [tiedIDs removeAllObjects];
+                            }
+                            [tiedIDs addObject:object.objectID];
+                        }
+                    }
+                }
+
+                [ctx reset];
+            }
+        }
+    }];
+
+    if (!success && error != NULL) {
+        *error = enumerationError;
+    }
+    return success;
+}
+
+@end
+
+@implementation MCTObjectContext (Queries)
+
+- (NSArray<NSDictionary<NSString *, id> *> *)values:(Class)type properties:(NSArray *)properties predicate:(NSPredicate *)predicate sortDescriptors:(NSArray<NSSortDescriptor *> *)sort distinct:(BOOL)distinct error:(NSError *__autoreleasing*)error {
+    return [self values:type properties:properties groupBy:nil predicate:predicate sortDescriptors:sort distinct:distinct error:error];
+}
+- (NSArray<NSDictionary<NSString *, id> *> *)values:(Class)type properties:(NSArray *)properties groupBy:(NSArray *)groupBy predicate:(NSPredicate *)predicate sortDescriptors:(NSArray<NSSortDescriptor *> *)sort distinct:(BOOL)distinct error:(NSError *__autoreleasing*)error {
+    CHECK_TYPE_EXE(type);
+    MCTOSParamAssert(properties.count > 0);
+
+    NSFetchRequest *fetchRequest = [NSFetchRequest fetchRequestWithEntityName:[type entityName]];
+    fetchRequest.resultType = NSDictionaryResultType;
+    fetchRequest.affectedStores = [self.context.persistentStoreCoordinator mct_affectedStoresForEntityName:fetchRequest.entityName];
+    fetchRequest.propertiesToFetch = properties;
+    fetchRequest.propertiesToGroupBy = groupBy;
+    fetchRequest.predicate = predicate;
+    fetchRequest.sortDescriptors = sort;
+    fetchRequest.returnsDistinctResults = distinct;
+    fetchRequest.includesPendingChanges = NO;
+
+    NSArray __block *rows = nil;
+    NSError __block *fetchError = nil;
+    [self performInContext:^(NSManagedObjectContext *ctx) {
+        NSError *err = nil;
+        rows = [ctx executeFetchRequest:fetchRequest error:&err];
+        fetchError = err;
+    }];
+    if (!rows) {
+        MCTOSLog(@"Failed to fetch values %@",fetchError);
+        if (error != NULL) {
+            *error = fetchError;
+        }
+    }
+    return rows;
+}
+
+- (NSArray<NSDictionary<NSString *, id> *> *)aggregate:(Class)type function:(MCTObjectAggregateFunction)function key:(NSString *)key groupBy:(NSArray<NSString *> *)groupBy predicate:(NSPredicate *)predicate error:(NSError *__autoreleasing*)error {
+    CHECK_TYPE_EXE(type);
+    MCTOSParamAssert(key);
+
+    NSEntityDescription *entity = self.context.persistentStoreCoordinator.managedObjectModel.entitiesByName[[type entityName]];
+    NSExpressionDescription *expression = [self.class expressionDescriptionForFunction:function key:key entity:entity];
+
+    NSMutableArray *properties = [NSMutableArray arrayWithArray:groupBy ?: @[]];
+    [properties addObject:expression];
+
+    return [self values:type properties:properties groupBy:groupBy predicate:predicate sortDescriptors:nil distinct:NO error:error];
+}
+- (id)aggregate:(Class)type function:(MCTObjectAggregateFunction)function key:(NSString *)key predicate:(NSPredicate *)predicate error:(NSError *__autoreleasing*)error {
+    NSArray *rows = [self aggregate:type function:function key:key groupBy:nil predicate:predicate error:error];
+    return [[rows firstObject] objectForKey:MCTObjectAggregateResultKey];
+}
+
++ (NSExpressionDescription *)expressionDescriptionForFunction:(MCTObjectAggregateFunction)function key:(NSString *)key entity:(NSEntityDescription *)entity {
+    NSAttributeType attributeType = [entity.attributesByName[key] attributeType];
+    if (attributeType == NSUndefinedAttributeType) {
+        attributeType = NSDoubleAttributeType;
+    }
+
+    NSString *name = nil;
+    switch (function) {
+        case MCTObjectAggregateFunctionCount:
+            name = @"count:";
+            attributeType = NSInteger64AttributeType;
+            break;
+        case MCTObjectAggregateFunctionSum:
+            name = @"sum:";
+            break;
+        case MCTObjectAggregateFunctionAverage:
+            name = @"average:";
+            attributeType = NSDoubleAttributeType;
+            break;
+        case MCTObjectAggregateFunctionMinimum:
+            name = @"min:";
+            break;
+        case MCTObjectAggregateFunctionMaximum:
+            name = @"max:";
+            break;
+    }
+
+    NSExpressionDescription *description = [[NSExpressionDescription alloc] init];
+    description.name = MCTObjectAggregateResultKey;
+    description.expression = [NSExpression expressionForFunction:name arguments:@[[NSExpression expressionForKeyPath:key]]];
+    description.expressionResultType = attributeType;
+    return description;
+}
+
+@end
+
+@implementation MCTObjectContext (BatchRequests)
+
+- (NSArray<NSManagedObjectID *> *)batchDelete:(Class)type predicate:(NSPredicate *)predicate error:(NSError *__autoreleasing*)error {
+    CHECK_TYPE_EXE(type);
+
+    NSFetchRequest *fetchRequest = [NSFetchRequest fetchRequestWithEntityName:[type entityName]];
+    fetchRequest.predicate = predicate;
+    fetchRequest.affectedStores = [self.context.persistentStoreCoordinator mct_affectedStoresForEntityName:fetchRequest.entityName];
+
+    NSBatchDeleteRequest *request = [[NSBatchDeleteRequest alloc] initWithFetchRequest:fetchRequest];
+    request.resultType = NSBatchDeleteResultTypeObjectIDs;
+
+    NSBatchDeleteResult *result = [self executeBatchRequest:request error:error];
+    if (!result) {
+        return nil;
+    }
+    NSArray *objectIDs = result.result ?: @[];
+    [self didExecuteBatchRequestWithChanges:@{NSDeletedObjectsKey: objectIDs}];
+    return objectIDs;
+}
+
+- (NSArray<NSManagedObjectID *> *)batchUpdate:(Class)type predicate:(NSPredicate *)predicate values:(NSDictionary<NSString *, id> *)values error:(NSError *__autoreleasing*)error {
+    CHECK_TYPE_EXE(type);
+    MCTOSParamAssert(values);
+
+    NSBatchUpdateRequest *request = [NSBatchUpdateRequest batchUpdateRequestWithEntityName:[type entityName]];
+    request.predicate = predicate;
+    request.affectedStores = [self.context.persistentStoreCoordinator mct_affectedStoresForEntityName:request.entityName];
+    request.propertiesToUpdate = values;
+    request.resultType = NSUpdatedObjectIDsResultType;
+
+    NSBatchUpdateResult *result = [self executeBatchRequest:request error:error];
+    if (!result) {
+        return nil;
+    }
+    NSArray *objectIDs = result.result ?: @[];
+    [self didExecuteBatchRequestWithChanges:@{NSUpdatedObjectsKey: objectIDs}];
+    return objectIDs;
+}
+
+- (nullable id)executeBatchRequest:(NSPersistentStoreRequest *)request error:(NSError *__autoreleasing*)error {
+    NSManagedObjectContext *ctx = self.context;
+    for (NSPersistentStore *store in ctx.persistentStoreCoordinator.persistentStores) {
+        if (![store.type isEqualToString:NSSQLiteStoreType]) {
+            if (error != NULL) {
+                *error = [NSError errorWithDomain:MCTObjectStoreErrorDomain
+                                             code:MCTObjectStoreErrorUnsupportedStoreType
+                                         userInfo:@{
+                                                    NSLocalizedDescriptionKey: [NSString stringWithFormat:NSLocalizedString(@"Batch requests are not supported by %@ stores", nil),store.type]
+                                                    }];
+            }
+            return nil;
+        }
+    }
+
+    id __block result = nil;
+    NSError __block *requestError = nil;
+    MCTObjectMetrics *metrics = self.metrics;
+    [ctx performBlockAndWait:^{
+        uint64_t start = (metrics ? MCTObjectMetricsAbsoluteTime() : 0);
+        uint64_t signpost = [metrics beginSignpostForOperation:MCTObjectMetricsOperationBatchRequest];
+        NSError *err = nil;
+        result = [ctx executeRequest:request error:&err];
+        requestError = err;
+        if (metrics) {
+            [metrics endSignpostForOperation:MCTObjectMetricsOperationBatchRequest identifier:signpost];
+            id objects = [result result];
+            NSUInteger size = [objects isKindOfClass:[NSArray class]] ? [objects count] : 0;
+            [metrics recordOperation:MCTObjectMetricsOperationBatchRequest waitTime:0 duration:(MCTObjectMetricsAbsoluteTime() - start) size:size];
+        }
+    }];
+    if (!result) {
+        MCTOSLog(@"Failed to execute batch request %@",requestError);
+        if (error != NULL) {
+            *error = requestError;
+        }
+    }
+    return result;
+}
+
+- (void)didExecuteBatchRequestWithChanges:(NSDictionary *)changes {
+    [self mergeBatchChanges:changes];
+    [[NSNotificationCenter defaultCenter] postNotificationName:MCTObjectContextDidExecuteBatchRequestNotification object:self userInfo:changes];
+}
+
+- (void)mergeBatchChanges:(NSDictionary<NSString *, NSArray<NSManagedObjectID *> *> *)changes {
+    NSManagedObjectContext *ctx = self.context;
+    if (!ctx) {
+        return;
+    }
+    if (self.cachesFetchResults) {
+        for (NSString *key in @[NSInsertedObjectsKey, NSUpdatedObjectsKey, NSDeletedObjectsKey]) {
+            [_fetchResultCache invalidateObjects:changes[key]];
+        }
+    }
+    if ([NSManagedObjectContext respondsToSelector:@selector(mergeChangesFromRemoteContextSave:intoContexts:)]) {
+        [NSManagedObjectContext mergeChangesFromRemoteContextSave:changes intoContexts:@[ctx]];
+        return;
+    }
+    [ctx performBlockAndWait:^{
+        // The row cache doesn't know about changes made directly in the store.
+        NSTimeInterval staleness = ctx.stalenessInterval;
+        ctx.stalenessInterval = 0.0;
+        for (NSManagedObjectID *objectID in changes[NSUpdatedObjectsKey]) {
+            NSManagedObject *object = [ctx objectRegisteredForID:objectID];
+            if (object) {
+                [ctx refreshObject:object mergeChanges:YES];
+            }
+        }
+        for (NSManagedObjectID *objectID in changes[NSDeletedObjectsKey]) {
+            NSManagedObject *object = [ctx objectRegisteredForID:objectID];
+            if (object) {
+                [ctx refreshObject:object mergeChanges:NO];
+            }
+        }
+        ctx.stalenessInterval = staleness;
+    }];
+}
+
+@end
+
+
+@implementation MCTObjectContext (Maintenance)
+
+- (BOOL)checkpointPersistentStores:(NSError **)error {
+    // Switching out of WAL checkpoints & removes the log.  Adding the store back with its own options switches back.
+    return [self reloadSQLiteStoresWithOptions:^NSDictionary *(NSDictionary *options) {
+        NSMutableDictionary *pragmas = [NSMutableDictionary dictionaryWithDictionary:options[NSSQLitePragmasOption] ?: @{}];
+        pragmas[@"journal_mode"] = @"DELETE";
+        NSMutableDictionary *maintenance = [NSMutableDictionary dictionaryWithDictionary:options ?: @{}];
+        maintenance[NSSQLitePragmasOption] = pragmas;
+        return maintenance;
+    } error:error];
+}
+- (BOOL)vacuumPersistentStores:(NSError **)error {
+    return [self reloadSQLiteStoresWithOptions:^NSDictionary *(NSDictionary *options) {
+        NSMutableDictionary *maintenance = [NSMutableDictionary dictionaryWithDictionary:options ?: @{}];
+        maintenance[NSSQLiteManualVacuumOption] = @YES;
+        maintenance[NSSQLiteAnalyzeOption] = @YES;
+        return maintenance;
+    } error:error];
+}
+
+- (BOOL)reloadSQLiteStoresWithOptions:(NSDictionary *(^)(NSDictionary *options))maintenanceOptions error:(NSError **)error {
+    NSPersistentStoreCoordinator *psc = self.context.persistentStoreCoordinator;
+    if (!psc) {
+        return NO;
+    }
+    if (![self resetContextsForCoordinator:psc discardingChanges:NO error:error]) {
+        return NO;
+    }
+
+    BOOL __block success = YES;
+    NSError __block *reloadError = nil;
+    [psc performBlockAndWait:^{
+        for (NSPersistentStore *store in [psc.persistentStores copy]) {
+            if (![store.type isEqualToString:NSSQLiteStoreType]) {
+                continue;
+            }
+            NSURL *URL = store.URL;
+            NSString *configuration = store.configurationName;
+            NSDictionary *options = store.options;
+            MCTOSLog(@"Reloading store at %@",URL.path);
+
+            // Each step needs the previous one, so stop at the first failure.
+            success = ([psc removePersistentStore:store error:&reloadError] &&
+                       [psc addPersistentStoreWithType:NSSQLiteStoreType configuration:configuration URL:URL options:maintenanceOptions(options) error:&reloadError] &&
+                       [psc removePersistentStore:[psc persistentStoreForURL:URL] error:&reloadError] &&
+                       [psc addPersistentStoreWithType:NSSQLiteStoreType configuration:configuration URL:URL options:options error:&reloadError]);
+            if (!success) {
+                break;
+            }
+        }
+    }];
+
+    if (!success && error != NULL) {
+        *error = reloadError;
+    }
+    return success;
+}
+
+- (BOOL)rebuildPersistentStoreAtURL:(NSURL *)URL error:(NSError **)error {
+    MCTOSParamAssert(URL);
+    NSPersistentStoreCoordinator *psc = self.context.persistentStoreCoordinator;
+    if (!psc) {
+        return NO;
+    }
+    [self resetContextsForCoordinator:psc discardingChanges:YES error:NULL];
+
+    BOOL __block success = NO;
+    NSError __block *rebuildError = nil;
+    [psc performBlockAndWait:^{
+        NSPersistentStore *store = [psc persistentStoreForURL:URL];
+        if (!store) {
+            rebuildError = [NSError errorWithDomain:MCTObjectStoreErrorDomain code:MCTObjectStoreErrorGeneric userInfo:@{NSLocalizedDescriptionKey: @"No store at the URL", NSURLErrorKey: URL}];
+            return;
+        }
+        NSString *type = store.type;
+        NSString *configuration = store.configurationName;
+        NSDictionary *options = store.options;
+        MCTOSLog(@"Rebuilding store at %@",URL.path);
+
+        success = ([psc removePersistentStore:store error:&rebuildError] &&
+                   [psc destroyPersistentStoreAtURL:URL withType:type options:options error:&rebuildError] &&
+                   MCTAddPersistentStore(psc, type, configuration, URL, options, &rebuildError));
+    }];
+
+    if (!success && error != NULL) {
+        *error = rebuildError;
+    }
+    return success;
+}
+
+/**
+ *  Reset every context using the coordinator & drain their pools so none of them hold objects from a store that's
+ *  about to be removed.
+ */
+- (BOOL)resetContextsForCoordinator:(NSPersistentStoreCoordinator *)psc discardingChanges:(BOOL)discardingChanges error:(NSError **)error {
+    NSArray<MCTObjectContext *> *contexts = [[MCTObjectContextRegistry sharedRegistry] contextsForCoordinator:psc];
+    if (!discardingChanges) {
+        for (MCTObjectContext *context in contexts) {
+            if ([[context performAndReturnInContext:^id(NSManagedObjectContext *ctx) {
+                return @([ctx hasChanges]);
+            }] boolValue]) {
+                if (error != NULL) {
+                    *error = [NSError errorWithDomain:MCTObjectStoreErrorDomain code:MCTObjectStoreErrorUnsavedChanges userInfo:nil];
+                }
+                return NO;
+            }
+        }
+    }
+    for (MCTObjectContext *context in contexts) {
+        [context performInContext:^(NSManagedObjectContext *ctx) {
+            [ctx reset];
+        }];
+        [context.disposableContextPool drain];
+    }
+    return YES;
+}
+
+@end
+
+
+@implementation MCTObjectContext (PersistentHistory)
+
+- (NSArray<NSPersistentHistoryTransaction *> *)historyTransactionsAfterToken:(NSPersistentHistoryToken *)token error:(NSError **)error {
+    return [self historyTransactionsForRequest:[NSPersistentHistoryChangeRequest fetchHistoryAfterToken:token] error:error];
+}
+- (NSArray<NSPersistentHistoryTransaction *> *)historyTransactionsAfterDate:(NSDate *)date error:(NSError **)error {
+    MCTOSParamAssert(date);
+    return [self historyTransactionsForRequest:[NSPersistentHistoryChangeRequest fetchHistoryAfterDate:date] error:error];
+}
+- (NSArray<NSPersistentHistoryTransaction *> *)historyTransactionsForRequest:(NSPersistentHistoryChangeRequest *)request error:(NSError **)error {
+    request.resultType = NSPersistentHistoryResultTypeTransactionsAndChanges;
+    NSPersistentHistoryResult *result = [self executeHistoryRequest:request error:error];
+    return (result) ? (result.result ?: @[]) : nil;
+}
+
+- (void)mergeHistoryTransactions:(NSArray<NSPersistentHistoryTransaction *> *)transactions {
+    if (transactions.count == 0) {
+        return;
+    }
+    NSMutableSet *inserted = [NSMutableSet set];
+    NSMutableSet *updated = [NSMutableSet set];
+    NSMutableSet *deleted = [NSMutableSet set];
+    for (NSPersistentHistoryTransaction *transaction in transactions) {
+        for (NSPersistentHistoryChange *change in transaction.changes) {
+            NSManagedObjectID *objectID = change.changedObjectID;
+            switch (change.changeType) {
+                case NSPersistentHistoryChangeTypeInsert:
+                    [inserted addObject:objectID];
+                    break;
+                case NSPersistentHistoryChangeTypeUpdate:
+                    [updated addObject:objectID];
+                    break;
+                case NSPersistentHistoryChangeTypeDelete:
+                    [inserted removeObject:objectID];
+                    [updated removeObject:objectID];
+                    [deleted addObject:objectID];
+                    break;
+            }
+        }
+    }
+    [self didExecuteBatchRequestWithChanges:@{
+                                              NSInsertedObjectsKey: [inserted allObjects],
+                                              NSUpdatedObjectsKey: [updated allObjects],
+                                              NSDeletedObjectsKey: [deleted allObjects]
+                                              }];
+}
+
+- (BOOL)deleteHistoryBeforeDate:(NSDate *)date error:(NSError **)error {
+    MCTOSParamAssert(date);
+    return ([self executeHistoryRequest:[NSPersistentHistoryChangeRequest deleteHistoryBeforeDate:date] error:error] != nil);
+}
+
+- (NSPersistentHistoryResult *)executeHistoryRequest:(NSPersistentHistoryChangeRequest *)request error:(NSError **)error {
+    NSManagedObjectContext *ctx = self.context;
+    if (!ctx) {
+        return nil;
+    }
+    NSPersistentHistoryResult __block *result = nil;
+    NSError __block *requestError = nil;
+    [ctx performBlockAndWait:^{
+        NSError *err = nil;
+        result = (NSPersistentHistoryResult *)[ctx executeRequest:request error:&err];
+        requestError = err;
+    }];
+    if (!result) {
+        MCTOSLog(@"Failed to execute history request %@",requestError);
+        if (error != NULL) {
+            *error = requestError;
+        }
+    }
+    return result;
+}
+
+@end
+
+
+static id MCTObjectIDsForResult(NSManagedObjectContext *ctx, id result) {
+    if ([result isKindOfClass:[NSManagedObject class]]) {
+        NSManagedObject *object = result;
+        if (object.objectID.isTemporaryID) {
+            [ctx obtainPermanentIDsForObjects:@[object] error:NULL];
+        }
+        return object.objectID;
+    }
+    if ([result isKindOfClass:[NSArray class]] || [result isKindOfClass:[NSSet class]]) {
+        NSMutableArray *temporary = [NSMutableArray array];
+        for (id object in result) {
+            if (![object isKindOfClass:[NSManagedObject class]]) {
+                return result;
+            }
+            if ([object objectID].isTemporaryID) {
+                [temporary addObject:object];
+            }
+        }
+        if (temporary.count > 0) {
+            [ctx obtainPermanentIDsForObjects:temporary error:NULL];
+        }
+        return [result valueForKey:@"objectID"];
+    }
+    return result;
+}
+
+@implementation MCTObjectContext (Futures)
+
+- (MCTObjectFuture *)futureAndReturnInContext:(id(^)(NSManagedObjectContext *ctx, NSError **error))block {
+    return [self futureAndReturnInContext:block queue:nil qualityOfService:NSQualityOfServiceDefault];
+}
+- (MCTObjectFuture *)futureAndReturnInContext:(id(^)(NSManagedObjectContext *ctx, NSError **error))block queue:(dispatch_queue_t)queue qualityOfService:(NSQualityOfService)qos {
+    MCTOSParamAssert(block);
+
+    MCTObjectFuture *future = [[MCTObjectFuture alloc] initWithQueue:queue qualityOfService:qos];
+    NSManagedObjectContext *ctx = self.context;
+    // The context's queue decides the work's quality of service, a QoS block passed to performBlock: has no effect.
+    [ctx performBlock:^{
+        if ([future isCancelled]) {
+            return;
+        }
+        NSError *error = nil;
+        id result = MCTObjectIDsForResult(ctx, block(ctx, &error));
+        [future finishWithResult:result error:error];
+    }];
+    return future;
+}
+- (MCTObjectFuture *)futureInContext:(void(^)(NSManagedObjectContext *ctx))block {
+    MCTOSParamAssert(block);
+    return [self futureAndReturnInContext:^id(NSManagedObjectContext *ctx, NSError **error) {
+        block(ctx);
+        return nil;
+    }];
+}
+
+- (MCTObjectFuture<NSArray<NSManagedObjectID *> *> *)futureAll:(Class)type predicate:(NSPredicate *)predicate sortDescriptors:(NSArray *)sort {
+    CHECK_TYPE_EXE(type);
+    return [self futureAndReturnInContext:^id(NSManagedObjectContext *ctx, NSError **error) {
+        NSFetchRequest *fetchRequest = [NSFetchRequest fetchRequestWithEntityName:NSStringFromClass(type)];
+        fetchRequest.predicate = predicate;
+        fetchRequest.affectedStores = [ctx.persistentStoreCoordinator mct_affectedStoresForEntityName:fetchRequest.entityName];
+        fetchRequest.sortDescriptors = sort;
+        fetchRequest.resultType = NSManagedObjectIDResultType;
+        return [ctx executeFetchRequest:fetchRequest error:error];
+    }];
+}
+- (MCTObjectFuture<NSManagedObjectID *> *)futureInsertNewObject:(Class)type {
+    CHECK_TYPE_EXE(type);
+    return [self futureAndReturnInContext:^id(NSManagedObjectContext *ctx, NSError **error) {
+        return [type insertIntoContext:ctx];
+    }];
+}
+- (MCTObjectFuture<NSNumber *> *)futureSave {
+    return [self futureAndReturnInContext:^id(NSManagedObjectContext *ctx, NSError **error) {
+        if (![self savePendingInContext:ctx error:error]) {
+            return nil;
+        }
+        return @YES;
+    }];
+}
+
+@end
+
+
+@implementation NSManagedObjectContext (MCTObjectStoreAdditions)
+
+- (BOOL)saveIfNeeded {
     return [self saveIfNeeded:NULL];
 }
 - (BOOL)saveIfNeeded:(NSError **)error {
+    [MCTManagedObject revertNoOpUpdatesInContext:self];
     if (![self hasChanges]) {
         return YES;
     }
@@ -398,8 +1780,66 @@
     return YES;
 }
 
+- (NSArray<__kindof NSManagedObject *> *)mct_existingObjectsWithIDs:(NSArray<NSManagedObjectID *> *)objectIDs error:(NSError **)error {
+    NSMutableArray *objects = [NSMutableArray arrayWithCapacity:objectIDs.count];
+    for (NSManagedObjectID *objectID in objectIDs) {
+        NSManagedObject *object = [self existingObjectWithID:objectID error:error];
+        if (!object) {
+            return nil;
+        }
+        [objects addObject:object];
+    }
+    return objects;
+}
+
+@end
+
+@implementation NSPersistentStoreCoordinator (MCTObjectStoreAdditions)
+
+- (NSArray<NSPersistentStore *> *)mct_affectedStoresForEntityName:(NSString *)entityName {
+    NSArray<NSPersistentStore *> *stores = self.persistentStores;
+    if (stores.count < 2) {
+        return nil;
+    }
+    NSManagedObjectModel *model = self.managedObjectModel;
+    NSArray<NSString *> *configurations = model.configurations;
+    // A fetch on a superentity also returns its subentities, which may live in other configurations.
+    NSMutableSet<NSString *> *entityNames = [NSMutableSet setWithObject:entityName];
+    NSMutableArray<NSEntityDescription *> *pending = [NSMutableArray array];
+    NSEntityDescription *requested = model.entitiesByName[entityName];
+    if (requested) {
+        [pending addObject:requested];
+    }
+    while (pending.count > 0) {
+        NSEntityDescription *entity = [pending lastObject];
+        [pending removeLastObject];
+        for (NSEntityDescription *subentity in entity.subentities) {
+            [entityNames addObject:subentity.name];
+            [pending addObject:subentity];
+        }
+    }
+    NSMutableArray<NSPersistentStore *> *affected = [NSMutableArray arrayWithCapacity:stores.count];
+    for (NSPersistentStore *store in stores) {
+        // Stores added without a configuration report Core Data's default name, which holds every entity.
+        NSString *configuration = store.configurationName;
+        if (!configuration || ![configurations containsObject:configuration]) {
+            [affected addObject:store];
+            continue;
+        }
+        for (NSEntityDescription *entity in [model entitiesForConfiguration:configuration]) {
+            if ([entityNames containsObject:entity.name]) {
+                [affected addObject:store];
+                break;
+            }
+        }
+    }
+    return (affected.count == stores.count) ? nil : [affected copy];
+}
+
 @end
 
 NSUInteger const MCTObjectStoreCurrentVersion = MCTObjectStoreVersion_1_0_0;
 NSString * const MCTObjectStoreErrorDomain = @"MCTObjectStoreErrorDomain";
 NSString * const MCTObjectStoreGenericException = @"MCTObjectStoreGenericException";
+NSString * const MCTObjectContextDidExecuteBatchRequestNotification = @"MCTObjectContextDidExecuteBatchRequestNotification";
+NSString * const MCTObjectAggregateResultKey = @"value";
@@ -0,0 +1,108 @@
+/*!
+ * MCTObjectContextPool.h
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+#ifndef MCTObjectStore_MCTObjectContextPool_h
+#define MCTObjectStore_MCTObjectContextPool_h
+
+@import Foundation;
+@import CoreData;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  A bounded pool of private queue contexts attached to a single NSPersistentStoreCoordinator.
+ *
+ *  Contexts are reset when they're returned to the pool.  When every context is in use callers wait until one is
+ *  returned.  A perform nested in another perform of the same pool on the same thread uses a new context instead of
+ *  waiting.
+ */
+@interface MCTObjectContextPool : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithPersistentStoreCoordinator:(NSPersistentStoreCoordinator *)coordinator maximumContexts:(NSUInteger)maximumContexts NS_DESIGNATED_INITIALIZER;
+
+@property (nonatomic, strong, readonly) NSPersistentStoreCoordinator *persistentStoreCoordinator;
+
+/**
+ *  The most contexts that can be in use at once.
+ */
+@property (nonatomic, assign, readonly) NSUInteger maximumContexts;
+
+/**
+ *  The `transactionAuthor` of the pooled contexts, so their saves are recognized in the persistent history.  Setting it
+ *  drains the idle contexts.  Only used on macOS 10.13 & iOS 11 and later.
+ */
+@property (atomic, copy, nullable) NSString *transactionAuthor;
+
+/**
+ *  Perform the block in a pooled context, waiting for one to become available.
+ *
+ *  After the block executes the context saves itself if it has changes.
+ *
+ *  @param block The block to perform.
+ */
+- (void)performInContext:(void(^)(NSManagedObjectContext *ctx))block;
+/**
+ *  Perform the block in a pooled context.
+ *
+ *  @param block   The block to perform.
+ *  @param timeout How long to wait for a context.  Pass a negative value to wait forever.
+ *
+ *  @return NO if no context became available before the timeout and the block wasn't performed.
+ */
+- (BOOL)performInContext:(void(^)(NSManagedObjectContext *ctx))block timeout:(NSTimeInterval)timeout;
+/**
+ *  @param saving Pass NO to leave the context's changes unsaved, they're discarded when it's returned.
+ */
+- (BOOL)performInContext:(void(^)(NSManagedObjectContext *ctx))block timeout:(NSTimeInterval)timeout saving:(BOOL)saving;
+
+/**
+ *  Take a context out of the pool.  Every context checked out must be checked back in.
+ *
+ *  @param timeout How long to wait for a context.  Pass a negative value to wait forever.
+ */
+- (nullable NSManagedObjectContext *)checkoutContextWithTimeout:(NSTimeInterval)timeout;
+- (void)checkinContext:(NSManagedObjectContext *)ctx;
+
+/**
+ *  Release every idle context.
+ */
+- (void)drain;
+
+/**
+ *  Create a context when none are idle.  Subclasses can override it to set the context up differently.
+ */
+- (NSManagedObjectContext *)newContext;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
@@ -0,0 +1,179 @@
+/*!
+ * MCTObjectContextPool.m
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+@import Darwin.POSIX.pthread;
+
+#import "MCTObjectContextPool.h"
+#import "MCTObjectContext.h"
+#import "MCTManagedObject.h"
+#import "MCTObjectStoreLog.h"
+#import "MCTObjectStoreHelpers.h"
+
+@interface MCTObjectContextPool () {
+    pthread_mutex_t _mutex;
+    // The number of this pool's blocks being performed on the current thread.
+    pthread_key_t _performDepthKey;
+}
+
+@property (nonatomic, strong, readonly) dispatch_semaphore_t semaphore;
+@property (nonatomic, strong, readonly) NSMutableArray<NSManagedObjectContext *> *idleContexts;
+
+@end
+
+@implementation MCTObjectContextPool
+
+- (instancetype)initWithPersistentStoreCoordinator:(NSPersistentStoreCoordinator *)coordinator maximumContexts:(NSUInteger)maximumContexts {
+    NSParameterAssert(coordinator);
+    self = [super init];
+    if (self) {
+        pthread_mutex_init(&_mutex, NULL);
+        pthread_key_create(&_performDepthKey, NULL);
+
+        _persistentStoreCoordinator = coordinator;
+        _maximumContexts = MAX(maximumContexts, (NSUInteger)1);
+        _semaphore = dispatch_semaphore_create((long)_maximumContexts);
+        _idleContexts = [[NSMutableArray alloc] initWithCapacity:_maximumContexts];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_mutex);
+    pthread_key_delete(_performDepthKey);
+}
+
+// MARK: - Perform
+- (void)performInContext:(void(^)(NSManagedObjectContext *ctx))block {
+    [self performInContext:block timeout:-1.0];
+}
+- (BOOL)performInContext:(void(^)(NSManagedObjectContext *ctx))block timeout:(NSTimeInterval)timeout {
+    return [self performInContext:block timeout:timeout saving:YES];
+}
+- (BOOL)performInContext:(void(^)(NSManagedObjectContext *ctx))block timeout:(NSTimeInterval)timeout saving:(BOOL)saving {
+    MCTOSParamAssert(block);
+    // Waiting for a pooled context while this thread holds one deadlocks once the pool is exhausted.  Nested calls get
+    // a context of their own that isn't returned to the pool.  Only nesting in this pool counts, other pools are
+    // bounded separately.
+    uintptr_t depth = (uintptr_t)pthread_getspecific(_performDepthKey);
+    BOOL nested = (depth > 0);
+    NSManagedObjectContext *ctx = (nested) ? [self newContext] : [self checkoutContextWithTimeout:timeout];
+    if (!ctx) {
+        return NO;
+    }
+    pthread_setspecific(_performDepthKey, (void *)(depth + 1));
+    [ctx performBlockAndWait:^{
+        block(ctx);
+        if (!saving) {
+            return;
+        }
+        NSError *error = nil;
+        [MCTManagedObject revertNoOpUpdatesInContext:ctx];
+        if ([ctx hasChanges]) {
+            MCTOSLog(@"Saving pooled context");
+            if (![ctx save:&error]) {
+                [MCTObjectContext handleSaveError:error inContext:ctx];
+            }
+        }
+    }];
+    pthread_setspecific(_performDepthKey, (void *)depth);
+    if (!nested) {
+        [self checkinContext:ctx];
+    }
+    return YES;
+}
+
+// MARK: - Checkout
+- (NSManagedObjectContext *)checkoutContextWithTimeout:(NSTimeInterval)timeout {
+    dispatch_time_t when = DISPATCH_TIME_FOREVER;
+    if (timeout >= 0.0) {
+        when = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC));
+    }
+    if (dispatch_semaphore_wait(self.semaphore, when) != 0) {
+        MCTOSLog(@"No pooled context available after %f seconds",timeout);
+        return nil;
+    }
+
+    pthread_mutex_lock(&_mutex);
+    NSManagedObjectContext *ctx = [self.idleContexts lastObject];
+    if (ctx) {
+        [self.idleContexts removeLastObject];
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (!ctx) {
+        ctx = [self newContext];
+    }
+    return ctx;
+}
+- (NSManagedObjectContext *)newContext {
+    NSManagedObjectContext *ctx = [[NSManagedObjectContext alloc] initWithConcurrencyType:NSPrivateQueueConcurrencyType];
+    ctx.persistentStoreCoordinator = self.persistentStoreCoordinator;
+    ctx.undoManager = nil;
+    if (@available(iOS 11.0, macOS 10.13, *)) {
+        ctx.transactionAuthor = self.transactionAuthor;
+    }
+    return ctx;
+}
+- (void)checkinContext:(NSManagedObjectContext *)ctx {
+    NSParameterAssert(ctx);
+    [ctx performBlockAndWait:^{
+        [ctx reset];
+        ctx.mergePolicy = NSErrorMergePolicy;
+    }];
+
+    pthread_mutex_lock(&_mutex);
+    [self.idleContexts addObject:ctx];
+    pthread_mutex_unlock(&_mutex);
+
+    dispatch_semaphore_signal(self.semaphore);
+}
+
+// MARK: - Properties
+- (void)setTransactionAuthor:(NSString *)transactionAuthor {
+    pthread_mutex_lock(&_mutex);
+    _transactionAuthor = [transactionAuthor copy];
+    pthread_mutex_unlock(&_mutex);
+    // Idle contexts were created with the old author.
+    [self drain];
+}
+- (NSString *)transactionAuthor {
+    pthread_mutex_lock(&_mutex);
+    NSString *transactionAuthor = _transactionAuthor;
+    pthread_mutex_unlock(&_mutex);
+    return transactionAuthor;
+}
+
+- (void)drain {
+    pthread_mutex_lock(&_mutex);
+    [self.idleContexts removeAllObjects];
+    pthread_mutex_unlock(&_mutex);
+}
+
+@end
@@ -0,0 +1,63 @@
+/*!
+ * MCTObjectContextRegistry.h
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+#ifndef MCTObjectStore_MCTObjectContextRegistry_h
+#define MCTObjectStore_MCTObjectContextRegistry_h
+
+@import Foundation;
+@import CoreData;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class MCTObjectContext;
+
+/**
+ *  Tracks the MCTObjectContexts attached to each NSPersistentStoreCoordinator.
+ *
+ *  The registry is the only observer of NSManagedObjectContextDidSaveNotification.  Saves are forwarded to the contexts
+ *  registered with the saving context's coordinator, so a context never hears about another database's saves.
+ */
+@interface MCTObjectContextRegistry : NSObject
+
++ (instancetype)sharedRegistry;
+
+/**
+ *  Contexts are held weakly and don't need to be unregistered before they're deallocated.
+ */
+- (void)registerContext:(MCTObjectContext *)context coordinator:(NSPersistentStoreCoordinator *)coordinator;
+- (void)unregisterContext:(MCTObjectContext *)context;
+
+- (NSArray<MCTObjectContext *> *)contextsForCoordinator:(NSPersistentStoreCoordinator *)coordinator;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
@@ -0,0 +1,146 @@
+/*!
+ * MCTObjectContextRegistry.m
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+@import Darwin.POSIX.pthread;
+
+#import "MCTObjectContextRegistry.h"
+#import "MCTObjectContext.h"
+#import "MCTObjectCountRegistry.h"
+
+@interface MCTObjectContext (MCTObjectContextRegistry)
+
+- (void)contextDidSaveNotification:(NSNotification *)notification;
+
+@end
+
+@interface MCTObjectContextRegistry () {
+    pthread_mutex_t _mutex;
+}
+
+@property (nonatomic, strong, readonly) NSMapTable<NSPersistentStoreCoordinator *, NSHashTable<MCTObjectContext *> *> *contexts;
+
+@end
+
+@implementation MCTObjectContextRegistry
+
++ (instancetype)sharedRegistry {
+    static MCTObjectContextRegistry *sharedInstance;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedInstance = [[[self class] alloc] init];
+    });
+    return sharedInstance;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        pthread_mutex_init(&_mutex, NULL);
+        _contexts = [NSMapTable weakToStrongObjectsMapTable];
+
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(contextDidSaveNotification:)
+                                                     name:NSManagedObjectContextDidSaveNotification
+                                                   object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_mutex);
+
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+// MARK: - Registration
+- (void)registerContext:(MCTObjectContext *)context coordinator:(NSPersistentStoreCoordinator *)coordinator {
+    NSParameterAssert(context);
+    NSParameterAssert(coordinator);
+
+    pthread_mutex_lock(&_mutex);
+    for (NSHashTable *contexts in self.contexts.objectEnumerator) {
+        [contexts removeObject:context];
+    }
+    NSHashTable *contexts = [self.contexts objectForKey:coordinator];
+    if (!contexts) {
+        contexts = [NSHashTable weakObjectsHashTable];
+        [self.contexts setObject:contexts forKey:coordinator];
+    }
+    [contexts addObject:context];
+    pthread_mutex_unlock(&_mutex);
+}
+- (void)unregisterContext:(MCTObjectContext *)context {
+    pthread_mutex_lock(&_mutex);
+    for (NSHashTable *contexts in self.contexts.objectEnumerator) {
+        [contexts removeObject:context];
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+- (NSArray<MCTObjectContext *> *)contextsForCoordinator:(NSPersistentStoreCoordinator *)coordinator {
+    pthread_mutex_lock(&_mutex);
+    NSArray *contexts = [[self.contexts objectForKey:coordinator] allObjects];
+    pthread_mutex_unlock(&_mutex);
+    return contexts ?: @[];
+}
+
+// MARK: - Notifications
+- (void)contextDidSaveNotification:(NSNotification *)notification {
+    NSManagedObjectContext *ctx = [notification object];
+    NSPersistentStoreCoordinator *psc = ctx.persistentStoreCoordinator;
+    if (!psc) {
+        return;
+    }
+    NSArray<MCTObjectContext *> *contexts = [self contextsForCoordinator:psc];
+    NSManagedObjectContext *parent = ctx.parentContext;
+    if (parent) {
+        // A child's save only reaches its parent, so only the child & its siblings see the changes.
+        for (MCTObjectContext *context in contexts) {
+            NSManagedObjectContext *lCtx = context.context;
+            if (lCtx == ctx || lCtx.parentContext == parent) {
+                [context contextDidSaveNotification:notification];
+            }
+        }
+        return;
+    }
+    // Children fault from their parents, so parents have to get the save first.
+    for (MCTObjectContext *context in contexts) {
+        if (!context.context.parentContext) {
+            [context contextDidSaveNotification:notification];
+        }
+    }
+    for (MCTObjectContext *context in contexts) {
+        if (context.context.parentContext) {
+            [context contextDidSaveNotification:notification];
+        }
+    }
+    [[MCTObjectCountRegistry existingRegistryForPersistentStoreCoordinator:psc] persistentStoreCoordinatorDidSave:notification];
+}
+
+@end
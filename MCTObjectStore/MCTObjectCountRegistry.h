@@ -0,0 +1,86 @@
+/*!
+ * MCTObjectCountRegistry.h
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+#ifndef MCTObjectStore_MCTObjectCountRegistry_h
+#define MCTObjectStore_MCTObjectCountRegistry_h
+
+@import Foundation;
+@import CoreData;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  Keeps counts of registered (entity, predicate) pairs for a persistent store coordinator up to date without querying
+ *  the store.
+ *
+ *  Each registered count is only a number.  Before a context saves, its updated and deleted objects are checked against
+ *  the predicate using their saved values, and after the save the inserted and updated objects are checked again, so
+ *  the count moves by the difference.  Both happen on the saving context's queue.  Counts are recounted
+ *  from the store the next time they're asked for after a batch request, a change to the coordinator's stores, a save
+ *  touching an entity the predicate reaches through a relationship, or `invalidateCounts`.
+ *
+ *  `+[NSManagedObject countInContext:predicate:error:]` uses the registry for root contexts without unsaved changes.
+ */
+@interface MCTObjectCountRegistry : NSObject
+
++ (instancetype)registryForPersistentStoreCoordinator:(NSPersistentStoreCoordinator *)coordinator;
++ (nullable instancetype)existingRegistryForPersistentStoreCoordinator:(NSPersistentStoreCoordinator *)coordinator;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@property (nonatomic, weak, readonly, nullable) NSPersistentStoreCoordinator *persistentStoreCoordinator;
+
+- (void)registerEntityName:(NSString *)entityName predicate:(nullable NSPredicate *)predicate;
+- (void)unregisterEntityName:(NSString *)entityName predicate:(nullable NSPredicate *)predicate;
+- (BOOL)isRegisteredEntityName:(NSString *)entityName predicate:(nullable NSPredicate *)predicate;
+
+/**
+ *  The count of objects in the store matching the predicate.
+ *
+ *  @param ctx A context on the registry's coordinator, used to recount stale counts.  Must be called on its queue.
+ *
+ *  @return NSNotFound if the pair isn't registered or the count failed.
+ */
+- (NSUInteger)countForEntityName:(NSString *)entityName predicate:(nullable NSPredicate *)predicate inContext:(NSManagedObjectContext *)ctx error:(NSError **)error;
+
+/**
+ *  Mark every count stale so it's recounted from the store.
+ */
+- (void)invalidateCounts;
+
+/**
+ *  Apply a save to the coordinator.  Called by the MCTObjectContextRegistry on the saving context's queue.
+ */
+- (void)persistentStoreCoordinatorDidSave:(NSNotification *)notification;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
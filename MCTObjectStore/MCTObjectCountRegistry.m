@@ -0,0 +1,425 @@
+/*!
+ * MCTObjectCountRegistry.m
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+@import Darwin.POSIX.pthread;
+@import ObjectiveC.runtime;
+
+#import "MCTObjectCountRegistry.h"
+#import "MCTObjectContext.h"
+#import "MCTObjectContextRegistry.h"
+#import "MCTObjectStoreLog.h"
+#import "MCTFetchResultCache.h"
+
+static const void *MCTObjectCountRegistryKey = &MCTObjectCountRegistryKey;
+
+// MARK: - Count
+@interface MCTObjectCount : NSObject
+
+- (instancetype)initWithEntityName:(NSString *)entityName predicate:(nullable NSPredicate *)predicate dependentEntityNames:(nullable NSSet<NSString *> *)dependentEntityNames NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly) NSString *entityName;
+@property (nonatomic, strong, readonly, nullable) NSPredicate *predicate;
+/**
+ *  Entities other than `entityName` whose changes can move objects in or out of the count.  nil when unknown.
+ */
+@property (nonatomic, copy, readonly, nullable) NSSet<NSString *> *dependentEntityNames;
+
+// Guarded by the registry's mutex.
+@property (nonatomic, assign) NSUInteger value;
+@property (nonatomic, assign, getter=isStale) BOOL stale;
+@property (nonatomic, assign) NSUInteger generation;
+
+@end
+
+@implementation MCTObjectCount
+
+- (instancetype)initWithEntityName:(NSString *)entityName predicate:(NSPredicate *)predicate dependentEntityNames:(NSSet<NSString *> *)dependentEntityNames {
+    self = [super init];
+    if (self) {
+        _entityName = [entityName copy];
+        _predicate = predicate;
+        _dependentEntityNames = [dependentEntityNames copy];
+        _stale = YES;
+    }
+    return self;
+}
+
+@end
+
+// MARK: - Pending Save
+// Which of a saving context's updated & deleted objects were in a count before the save.
+@interface MCTObjectCountPendingSave : NSObject
+
+@property (nonatomic, assign) NSUInteger generation;
+@property (nonatomic, strong) NSSet<NSManagedObject *> *previousMatches;
+
+@end
+
+@implementation MCTObjectCountPendingSave
+
+@end
+
+static BOOL MCTEntityIsKindOfEntityName(NSEntityDescription *entity, NSString *name) {
+    for (NSEntityDescription *current = entity; current != nil; current = current.superentity) {
+        if ([current.name isEqualToString:name]) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+/**
+ *  Evaluates the predicate against the object's saved values.  Only used for counts without dependent entities, so the
+ *  predicate only reaches the object's own attributes.
+ */
+static BOOL MCTCommittedValuesMatch(NSManagedObject *object, NSPredicate *predicate, BOOL *evaluated) {
+    if (!predicate) {
+        return YES;
+    }
+    NSMutableDictionary *values = [NSMutableDictionary dictionary];
+    [[object committedValuesForKeys:object.entity.attributesByName.allKeys] enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+        if (value != [NSNull null]) {
+            values[key] = value;
+        }
+    }];
+    @try {
+        return [predicate evaluateWithObject:values];
+    }
+    @catch (NSException *exception) {
+        MCTOSLog(@"Failed to evaluate count predicate %@: %@",predicate,exception);
+        *evaluated = NO;
+        return NO;
+    }
+}
+
+@interface MCTObjectCountRegistry () {
+    pthread_mutex_t _mutex;
+}
+
+@property (nonatomic, weak, readwrite) NSPersistentStoreCoordinator *persistentStoreCoordinator;
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSArray *, MCTObjectCount *> *counts;
+// Saving context -> count key -> pending save.  Guarded by the mutex.
+@property (nonatomic, strong, readonly) NSMapTable<NSManagedObjectContext *, NSDictionary<NSArray *, MCTObjectCountPendingSave *> *> *pendingSaves;
+
+- (instancetype)initWithPersistentStoreCoordinator:(NSPersistentStoreCoordinator *)coordinator NS_DESIGNATED_INITIALIZER;
+
+@end
+
+@implementation MCTObjectCountRegistry
+
++ (instancetype)registryForPersistentStoreCoordinator:(NSPersistentStoreCoordinator *)coordinator {
+    NSParameterAssert(coordinator);
+    // Saves reach the counts through the context registry.
+    [MCTObjectContextRegistry sharedRegistry];
+    @synchronized(coordinator) {
+        MCTObjectCountRegistry *registry = objc_getAssociatedObject(coordinator, MCTObjectCountRegistryKey);
+        if (!registry) {
+            registry = [[self alloc] initWithPersistentStoreCoordinator:coordinator];
+            objc_setAssociatedObject(coordinator, MCTObjectCountRegistryKey, registry, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+        }
+        return registry;
+    }
+}
++ (instancetype)existingRegistryForPersistentStoreCoordinator:(NSPersistentStoreCoordinator *)coordinator {
+    if (!coordinator) {
+        return nil;
+    }
+    return objc_getAssociatedObject(coordinator, MCTObjectCountRegistryKey);
+}
+
+- (instancetype)initWithPersistentStoreCoordinator:(NSPersistentStoreCoordinator *)coordinator {
+    self = [super init];
+    if (self) {
+        pthread_mutex_init(&_mutex, NULL);
+        _persistentStoreCoordinator = coordinator;
+        _counts = [[NSMutableDictionary alloc] init];
+        _pendingSaves = [NSMapTable weakToStrongObjectsMapTable];
+
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(contextWillSaveNotification:)
+                                                     name:NSManagedObjectContextWillSaveNotification
+                                                   object:nil];
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(contextDidExecuteBatchRequestNotification:)
+                                                     name:MCTObjectContextDidExecuteBatchRequestNotification
+                                                   object:nil];
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(storesDidChangeNotification:)
+                                                     name:NSPersistentStoreCoordinatorStoresDidChangeNotification
+                                                   object:coordinator];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_mutex);
+
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+// MARK: - Registration
++ (NSArray *)keyForEntityName:(NSString *)entityName predicate:(NSPredicate *)predicate {
+    return @[entityName, predicate ?: [NSNull null]];
+}
+- (void)registerEntityName:(NSString *)entityName predicate:(NSPredicate *)predicate {
+    NSParameterAssert(entityName);
+    NSArray *key = [self.class keyForEntityName:entityName predicate:predicate];
+
+    NSEntityDescription *entity = self.persistentStoreCoordinator.managedObjectModel.entitiesByName[entityName];
+    NSMutableSet *dependents = nil;
+    if (entity) {
+        dependents = [MCTDependentEntityNames(entity, predicate, nil) mutableCopy];
+        [dependents removeObject:entityName];
+    }
+
+    pthread_mutex_lock(&_mutex);
+    if (!self.counts[key]) {
+        self.counts[key] = [[MCTObjectCount alloc] initWithEntityName:entityName predicate:predicate dependentEntityNames:dependents];
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+- (void)unregisterEntityName:(NSString *)entityName predicate:(NSPredicate *)predicate {
+    NSArray *key = [self.class keyForEntityName:entityName predicate:predicate];
+    pthread_mutex_lock(&_mutex);
+    [self.counts removeObjectForKey:key];
+    pthread_mutex_unlock(&_mutex);
+}
+- (BOOL)isRegisteredEntityName:(NSString *)entityName predicate:(NSPredicate *)predicate {
+    NSArray *key = [self.class keyForEntityName:entityName predicate:predicate];
+    pthread_mutex_lock(&_mutex);
+    BOOL registered = (self.counts[key] != nil);
+    pthread_mutex_unlock(&_mutex);
+    return registered;
+}
+
+// MARK: - Counting
+- (NSUInteger)countForEntityName:(NSString *)entityName predicate:(NSPredicate *)predicate inContext:(NSManagedObjectContext *)ctx error:(NSError **)error {
+    NSArray *key = [self.class keyForEntityName:entityName predicate:predicate];
+
+    pthread_mutex_lock(&_mutex);
+    MCTObjectCount *count = self.counts[key];
+    BOOL stale = count.isStale;
+    NSUInteger generation = count.generation;
+    NSUInteger result = count.value;
+    pthread_mutex_unlock(&_mutex);
+
+    if (!count) {
+        return NSNotFound;
+    }
+    if (!stale) {
+        return result;
+    }
+
+    NSFetchRequest *fetchRequest = [NSFetchRequest fetchRequestWithEntityName:entityName];
+    fetchRequest.predicate = predicate;
+    fetchRequest.affectedStores = [ctx.persistentStoreCoordinator mct_affectedStoresForEntityName:entityName];
+    fetchRequest.includesPendingChanges = NO;
+    NSUInteger recount = [ctx countForFetchRequest:fetchRequest error:error];
+    if (recount == NSNotFound) {
+        return NSNotFound;
+    }
+
+    pthread_mutex_lock(&_mutex);
+    if (count.generation == generation) {
+        // Only keep the recount if no save started or landed while it ran.
+        count.value = recount;
+        count.stale = NO;
+        count.generation++;
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    MCTOSLog(@"Recounted %@ (%lu)",entityName,(unsigned long)recount);
+
+    return recount;
+}
+- (void)invalidateCounts {
+    pthread_mutex_lock(&_mutex);
+    for (MCTObjectCount *count in self.counts.objectEnumerator) {
+        count.stale = YES;
+        count.generation++;
+        count.value = 0;
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+// MARK: - Changes
+- (BOOL)observesContext:(NSManagedObjectContext *)ctx {
+    // Child saves don't reach the store.
+    return (ctx.persistentStoreCoordinator == self.persistentStoreCoordinator && !ctx.parentContext);
+}
+- (void)contextWillSaveNotification:(NSNotification *)notification {
+    NSManagedObjectContext *ctx = notification.object;
+    if (![self observesContext:ctx]) {
+        return;
+    }
+
+    pthread_mutex_lock(&_mutex);
+    NSDictionary<NSArray *, MCTObjectCount *> *counts = [self.counts copy];
+    [self.pendingSaves removeObjectForKey:ctx];
+    pthread_mutex_unlock(&_mutex);
+    if (counts.count == 0) {
+        return;
+    }
+
+    // Only the objects this save changes are evaluated, the counts themselves are just numbers.
+    NSSet *updated = ctx.updatedObjects;
+    NSSet *deleted = ctx.deletedObjects;
+    NSMutableDictionary *pending = [NSMutableDictionary dictionaryWithCapacity:counts.count];
+    [counts enumerateKeysAndObjectsUsingBlock:^(NSArray *key, MCTObjectCount *count, BOOL *stop) {
+        if (!count.dependentEntityNames || count.dependentEntityNames.count > 0) {
+            // Recounted after the save anyway.
+            return;
+        }
+        NSMutableSet *matches = [NSMutableSet set];
+        BOOL evaluated = YES;
+        for (NSSet *objects in @[updated, deleted]) {
+            for (NSManagedObject *object in objects) {
+                if (!MCTEntityIsKindOfEntityName(object.entity, count.entityName)) {
+                    continue;
+                }
+                if (MCTCommittedValuesMatch(object, count.predicate, &evaluated)) {
+                    [matches addObject:object];
+                }
+            }
+        }
+        if (!evaluated) {
+            return;
+        }
+        MCTObjectCountPendingSave *save = [[MCTObjectCountPendingSave alloc] init];
+        save.previousMatches = matches;
+        pending[key] = save;
+    }];
+
+    pthread_mutex_lock(&_mutex);
+    [pending enumerateKeysAndObjectsUsingBlock:^(NSArray *key, MCTObjectCountPendingSave *save, BOOL *stop) {
+        MCTObjectCount *count = self.counts[key];
+        // A recount that finishes from here on may or may not include this save, so it's thrown away.
+        count.generation++;
+        save.generation = count.generation;
+    }];
+    [self.pendingSaves setObject:pending forKey:ctx];
+    pthread_mutex_unlock(&_mutex);
+}
+- (void)persistentStoreCoordinatorDidSave:(NSNotification *)notification {
+    NSManagedObjectContext *ctx = notification.object;
+    if (ctx.parentContext) {
+        // Child saves don't reach the store.
+        return;
+    }
+
+    pthread_mutex_lock(&_mutex);
+    NSDictionary<NSArray *, MCTObjectCount *> *counts = [self.counts copy];
+    NSDictionary<NSArray *, MCTObjectCountPendingSave *> *pending = [self.pendingSaves objectForKey:ctx];
+    [self.pendingSaves removeObjectForKey:ctx];
+    pthread_mutex_unlock(&_mutex);
+    if (counts.count == 0) {
+        return;
+    }
+
+    NSSet *inserted = notification.userInfo[NSInsertedObjectsKey];
+    NSSet *updated = notification.userInfo[NSUpdatedObjectsKey];
+    NSSet *deleted = notification.userInfo[NSDeletedObjectsKey];
+
+    NSMutableSet *changedEntityNames = [NSMutableSet set];
+    for (NSSet *objects in @[inserted ?: [NSSet set], updated ?: [NSSet set], deleted ?: [NSSet set]]) {
+        for (NSManagedObject *object in objects) {
+            for (NSEntityDescription *entity = object.entity; entity != nil; entity = entity.superentity) {
+                if (entity.name) {
+                    [changedEntityNames addObject:entity.name];
+                }
+            }
+        }
+    }
+
+    [counts enumerateKeysAndObjectsUsingBlock:^(NSArray *key, MCTObjectCount *count, BOOL *stop) {
+        NSSet *dependents = count.dependentEntityNames;
+        MCTObjectCountPendingSave *save = pending[key];
+        if (!dependents || [dependents intersectsSet:changedEntityNames] || (!save && [changedEntityNames containsObject:count.entityName])) {
+            // A related object changed, or the save's starting point is unknown, so any object could have moved in or
+            // out of the count.
+            pthread_mutex_lock(&self->_mutex);
+            count.stale = YES;
+            count.generation++;
+            pthread_mutex_unlock(&self->_mutex);
+            return;
+        }
+        if (![changedEntityNames containsObject:count.entityName]) {
+            return;
+        }
+
+        NSInteger delta = 0;
+        BOOL evaluated = YES;
+        for (NSSet *objects in @[inserted ?: [NSSet set], updated ?: [NSSet set]]) {
+            for (NSManagedObject *object in objects) {
+                if (!MCTEntityIsKindOfEntityName(object.entity, count.entityName)) {
+                    continue;
+                }
+                BOOL match = YES;
+                if (count.predicate) {
+                    @try {
+                        match = [count.predicate evaluateWithObject:object];
+                    }
+                    @catch (NSException *exception) {
+                        MCTOSLog(@"Failed to evaluate count predicate %@: %@",count.predicate,exception);
+                        evaluated = NO;
+                    }
+                }
+                delta += (NSInteger)match - (NSInteger)[save.previousMatches containsObject:object];
+            }
+        }
+        for (NSManagedObject *object in deleted) {
+            delta -= (NSInteger)[save.previousMatches containsObject:object];
+        }
+
+        pthread_mutex_lock(&self->_mutex);
+        if (!evaluated || count.generation != save.generation) {
+            // Another save or a recount landed since this one started.
+            count.stale = YES;
+        } else if (!count.isStale) {
+            count.value = (NSUInteger)MAX((NSInteger)count.value + delta, 0);
+        }
+        count.generation++;
+        pthread_mutex_unlock(&self->_mutex);
+    }];
+}
+
+- (void)contextDidExecuteBatchRequestNotification:(NSNotification *)notification {
+    MCTObjectContext *context = notification.object;
+    if (context.context.persistentStoreCoordinator != self.persistentStoreCoordinator) {
+        return;
+    }
+    [self invalidateCounts];
+}
+
+- (void)storesDidChangeNotification:(NSNotification *)notification {
+    [self invalidateCounts];
+}
+
+@end
@@ -0,0 +1,103 @@
+/*!
+ * MCTObjectFuture.h
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+#ifndef MCTObjectStore_MCTObjectFuture_h
+#define MCTObjectStore_MCTObjectFuture_h
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  The eventual result of work performed on a context's queue.
+ *
+ *  Completion blocks are called on the future's queue with its quality of service.  Futures returned by MCTObjectContext
+ *  carry NSManagedObjectIDs instead of managed objects so results can be used safely from any queue.
+ */
+@interface MCTObjectFuture<__covariant ResultType> : NSObject
+
+/**
+ *  A future that completes on the main queue with the default quality of service.
+ */
+- (instancetype)init;
+/**
+ *  @param queue The queue completion blocks are called on.  If nil is passed the main queue is used.
+ *  @param qos   The quality of service completion blocks are called with.
+ */
+- (instancetype)initWithQueue:(nullable dispatch_queue_t)queue qualityOfService:(NSQualityOfService)qos NS_DESIGNATED_INITIALIZER;
+
+@property (nonatomic, strong, readonly) dispatch_queue_t queue;
+@property (nonatomic, assign, readonly) NSQualityOfService qualityOfService;
+
+@property (atomic, assign, readonly, getter=isFinished) BOOL finished;
+@property (atomic, assign, readonly, getter=isCancelled) BOOL cancelled;
+
+@property (atomic, strong, readonly, nullable) ResultType result;
+@property (atomic, strong, readonly, nullable) NSError *error;
+
+/**
+ *  Cancel the future.
+ *
+ *  Work that hasn't started won't run.  Completion blocks are called with a `MCTObjectStoreErrorCancelled` error.
+ */
+- (void)cancel;
+
+/**
+ *  Finish the future.  Only the first call has any effect.
+ *
+ *  @return NO if the future was already finished or cancelled.
+ */
+- (BOOL)finishWithResult:(nullable ResultType)result error:(nullable NSError *)error;
+
+/**
+ *  Add a completion block.  If the future is already finished the block is called right away.
+ */
+- (instancetype)onComplete:(void(^)(ResultType _Nullable result, NSError *_Nullable error))block;
+
+/**
+ *  Chain work that returns another future.  The block is only called if this future succeeds.
+ *
+ *  Cancelling the returned future cancels this future, and the future returned from the block once there is one.
+ *
+ *  @return A future that finishes with the result of the future returned from the block.
+ */
+- (MCTObjectFuture *)then:(MCTObjectFuture *_Nullable(^)(ResultType _Nullable result))block;
+
+/**
+ *  Transform the result.  The block is only called if this future succeeds.  Cancelling the returned future cancels
+ *  this future.
+ */
+- (MCTObjectFuture *)map:(id _Nullable(^)(ResultType _Nullable result))block;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
@@ -0,0 +1,182 @@
+/*!
+ * MCTObjectFuture.m
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+@import Darwin.POSIX.pthread;
+
+#import "MCTObjectFuture.h"
+#import "MCTObjectStoreError.h"
+#import "MCTObjectStoreHelpers.h"
+
+@interface MCTObjectFuture () {
+    pthread_mutex_t _mutex;
+    NSMutableArray *_callbacks;
+}
+
+@property (atomic, assign, readwrite, getter=isFinished) BOOL finished;
+@property (atomic, assign, readwrite, getter=isCancelled) BOOL cancelled;
+
+@property (atomic, strong, readwrite) id result;
+@property (atomic, strong, readwrite) NSError *error;
+
+// The future this one is waiting on, cancelled along with it.
+@property (atomic, strong) MCTObjectFuture *upstream;
+
+@end
+
+@implementation MCTObjectFuture
+
+- (instancetype)init {
+    return [self initWithQueue:nil qualityOfService:NSQualityOfServiceDefault];
+}
+- (instancetype)initWithQueue:(dispatch_queue_t)queue qualityOfService:(NSQualityOfService)qos {
+    self = [super init];
+    if (self) {
+        pthread_mutex_init(&_mutex, NULL);
+        _callbacks = [[NSMutableArray alloc] init];
+        _queue = queue ?: dispatch_get_main_queue();
+        _qualityOfService = qos;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_mutex);
+}
+
+// MARK: - Finishing
+- (BOOL)finishWithResult:(id)result error:(NSError *)error {
+    return [self finishWithResult:result error:error cancelled:NO];
+}
+- (void)cancel {
+    NSError *error = [NSError errorWithDomain:MCTObjectStoreErrorDomain
+                                         code:MCTObjectStoreErrorCancelled
+                                     userInfo:@{
+                                                NSLocalizedDescriptionKey: NSLocalizedString(@"The operation was cancelled", nil)
+                                                }];
+    if (![self finishWithResult:nil error:error cancelled:YES]) {
+        return;
+    }
+    [self.upstream cancel];
+    self.upstream = nil;
+}
+- (BOOL)finishWithResult:(id)result error:(NSError *)error cancelled:(BOOL)cancelled {
+    pthread_mutex_lock(&_mutex);
+    if (self.finished) {
+        pthread_mutex_unlock(&_mutex);
+        return NO;
+    }
+    self.result = result;
+    self.error = error;
+    self.cancelled = cancelled;
+    self.finished = YES;
+    if (!cancelled) {
+        self.upstream = nil;
+    }
+    NSArray *callbacks = [_callbacks copy];
+    [_callbacks removeAllObjects];
+    pthread_mutex_unlock(&_mutex);
+
+    for (void(^callback)(id, NSError *) in callbacks) {
+        [self dispatchCallback:callback result:result error:error];
+    }
+    return YES;
+}
+
+// MARK: - Callbacks
+- (instancetype)onComplete:(void(^)(id result, NSError *error))block {
+    MCTOSParamAssert(block);
+    pthread_mutex_lock(&_mutex);
+    BOOL finished = self.finished;
+    if (!finished) {
+        [_callbacks addObject:[block copy]];
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (finished) {
+        [self dispatchCallback:block result:self.result error:self.error];
+    }
+    return self;
+}
+
+- (void)dispatchCallback:(void(^)(id result, NSError *error))callback result:(id)result error:(NSError *)error {
+    dispatch_block_t block = dispatch_block_create_with_qos_class(DISPATCH_BLOCK_ENFORCE_QOS_CLASS, MCTOSQoSClass(self.qualityOfService), 0, ^{
+        callback(result, error);
+    });
+    dispatch_async(self.queue, block);
+}
+
+// MARK: - Chaining
+- (MCTObjectFuture *)then:(MCTObjectFuture *(^)(id result))block {
+    MCTOSParamAssert(block);
+    MCTObjectFuture *future = [[MCTObjectFuture alloc] initWithQueue:self.queue qualityOfService:self.qualityOfService];
+    future.upstream = self;
+    [self onComplete:^(id result, NSError *error) {
+        if (error) {
+            [future finishWithResult:nil error:error];
+            return;
+        }
+        if ([future isCancelled]) {
+            return;
+        }
+        MCTObjectFuture *next = block(result);
+        if (!next) {
+            [future finishWithResult:nil error:nil];
+            return;
+        }
+        future.upstream = next;
+        if ([future isCancelled]) {
+            // Cancelled while the block ran.
+            [next cancel];
+            return;
+        }
+        [next onComplete:^(id nextResult, NSError *nextError) {
+            [future finishWithResult:nextResult error:nextError];
+        }];
+    }];
+    return future;
+}
+- (MCTObjectFuture *)map:(id(^)(id result))block {
+    MCTOSParamAssert(block);
+    MCTObjectFuture *future = [[MCTObjectFuture alloc] initWithQueue:self.queue qualityOfService:self.qualityOfService];
+    future.upstream = self;
+    [self onComplete:^(id result, NSError *error) {
+        if (error) {
+            [future finishWithResult:nil error:error];
+            return;
+        }
+        if ([future isCancelled]) {
+            return;
+        }
+        [future finishWithResult:block(result) error:nil];
+    }];
+    return future;
+}
+
+@end
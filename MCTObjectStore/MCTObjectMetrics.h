@@ -0,0 +1,155 @@
+/*!
+ * MCTObjectMetrics.h
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+#ifndef MCTObjectStore_MCTObjectMetrics_h
+#define MCTObjectStore_MCTObjectMetrics_h
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, MCTObjectMetricsOperation) {
+    MCTObjectMetricsOperationPerform      = 0,
+    MCTObjectMetricsOperationFetch        = 1,
+    MCTObjectMetricsOperationSave         = 2,
+    MCTObjectMetricsOperationMerge        = 3,
+    MCTObjectMetricsOperationBatchRequest = 4
+};
+
+/**
+ *  The current time in nanoseconds, from a monotonic clock.
+ */
+FOUNDATION_EXTERN uint64_t MCTObjectMetricsAbsoluteTime(void);
+
+@class MCTObjectMetrics;
+
+/**
+ *  A log2 bucketed histogram of recorded values.
+ */
+@interface MCTObjectMetricsHistogram : NSObject
+
+@property (nonatomic, assign, readonly) uint64_t count;
+@property (nonatomic, assign, readonly) uint64_t total;
+@property (nonatomic, assign, readonly) uint64_t minimum;
+@property (nonatomic, assign, readonly) uint64_t maximum;
+@property (nonatomic, assign, readonly) double mean;
+
+/**
+ *  The upper bound of the bucket holding the value at `percentile`, from 0.0 to 1.0.
+ */
+- (uint64_t)valueAtPercentile:(double)percentile;
+
+@end
+
+@interface MCTObjectMetricsSnapshot : NSObject
+
+@property (nonatomic, strong, readonly) NSDate *startDate;
+@property (nonatomic, strong, readonly) NSDate *endDate;
+
+/**
+ *  The most blocks waiting to run in a context's queue at once.
+ */
+@property (nonatomic, assign, readonly) NSUInteger maximumQueueDepth;
+
+/**
+ *  How long the operations took to run, in nanoseconds.
+ */
+- (MCTObjectMetricsHistogram *)durationsForOperation:(MCTObjectMetricsOperation)operation;
+/**
+ *  How long the operations waited for the context's queue, in nanoseconds.  For merges this is the time from the first
+ *  save being queued to the merge starting.
+ */
+- (MCTObjectMetricsHistogram *)waitTimesForOperation:(MCTObjectMetricsOperation)operation;
+/**
+ *  The number of objects fetched, saved, merged or changed by a batch request.
+ */
+- (MCTObjectMetricsHistogram *)sizesForOperation:(MCTObjectMetricsOperation)operation;
+
+@end
+
+@protocol MCTObjectMetricsObserver <NSObject>
+
+/**
+ *  Called on a private queue each time the metrics capture a snapshot.
+ */
+- (void)metrics:(MCTObjectMetrics *)metrics didCaptureSnapshot:(MCTObjectMetricsSnapshot *)snapshot;
+
+@end
+
+/**
+ *  Collects timings for MCTObjectContext and MCTObjectStack.
+ *
+ *  Metrics are off until an instance is assigned to a context's or stack's `metrics` property.  Without one the only cost
+ *  is reading the property.
+ */
+@interface MCTObjectMetrics : NSObject
+
+/**
+ *  How often a snapshot is captured and sent to observers.  Pass 0 to only capture snapshots manually.  Defaults to 60.
+ */
+@property (atomic, assign) NSTimeInterval snapshotInterval;
+
+/**
+ *  Emit os_signpost intervals for each operation where they're available.  Defaults to YES.
+ */
+@property (atomic, assign) BOOL emitsSignposts;
+
+/**
+ *  Observers are held weakly.
+ */
+- (void)addObserver:(id<MCTObjectMetricsObserver>)observer;
+- (void)removeObserver:(id<MCTObjectMetricsObserver>)observer;
+
+/**
+ *  The metrics recorded since the last capture.
+ */
+- (MCTObjectMetricsSnapshot *)snapshot;
+
+/**
+ *  Take a snapshot, start a new collection period, and send the snapshot to the observers.
+ */
+- (MCTObjectMetricsSnapshot *)captureSnapshot;
+
+// MARK: - Recording
+- (void)operationWillEnqueue;
+- (void)operationDidDequeue;
+
+- (void)recordOperation:(MCTObjectMetricsOperation)operation waitTime:(uint64_t)waitTime duration:(uint64_t)duration size:(NSUInteger)size;
+
+/**
+ *  @return An identifier to pass to `endSignpostForOperation:identifier:`, or 0 if no signpost was emitted.
+ */
+- (uint64_t)beginSignpostForOperation:(MCTObjectMetricsOperation)operation;
+- (void)endSignpostForOperation:(MCTObjectMetricsOperation)operation identifier:(uint64_t)identifier;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
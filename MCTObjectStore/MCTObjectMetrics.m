@@ -0,0 +1,384 @@
+/*!
+ * MCTObjectMetrics.m
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+@import Darwin.POSIX.pthread;
+#import <mach/mach_time.h>
+#if __has_include(<os/signpost.h>)
+#import <os/signpost.h>
+#define MCT_HAS_SIGNPOST 1
+#else
+#define MCT_HAS_SIGNPOST 0
+#endif
+
+#import "MCTObjectMetrics.h"
+
+#define MCT_METRICS_OPERATIONS 5
+#define MCT_METRICS_BUCKETS 48
+
+typedef struct {
+    uint64_t count;
+    uint64_t total;
+    uint64_t minimum;
+    uint64_t maximum;
+    uint64_t buckets[MCT_METRICS_BUCKETS];
+} MCTObjectMetricsHistogramData;
+
+static void MCTObjectMetricsHistogramRecord(MCTObjectMetricsHistogramData *data, uint64_t value) {
+    NSUInteger bucket = (value == 0) ? 0 : MIN((NSUInteger)(64 - __builtin_clzll(value)), (NSUInteger)(MCT_METRICS_BUCKETS - 1));
+    data->buckets[bucket]++;
+    data->minimum = (data->count == 0) ? value : MIN(data->minimum, value);
+    data->maximum = MAX(data->maximum, value);
+    data->count++;
+    data->total += value;
+}
+
+uint64_t MCTObjectMetricsAbsoluteTime(void) {
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+}
+
+// MARK: - Histogram
+@interface MCTObjectMetricsHistogram () {
+    MCTObjectMetricsHistogramData _data;
+}
+
+- (instancetype)initWithData:(MCTObjectMetricsHistogramData)data;
+
+@end
+
+@implementation MCTObjectMetricsHistogram
+
+- (instancetype)initWithData:(MCTObjectMetricsHistogramData)data {
+    self = [super init];
+    if (self) {
+        _data = data;
+    }
+    return self;
+}
+- (uint64_t)count {
+    return _data.count;
+}
+- (uint64_t)total {
+    return _data.total;
+}
+- (uint64_t)minimum {
+    return _data.minimum;
+}
+- (uint64_t)maximum {
+    return _data.maximum;
+}
+- (double)mean {
+    return (_data.count == 0) ? 0.0 : ((double)_data.total / (double)_data.count);
+}
+- (uint64_t)valueAtPercentile:(double)percentile {
+    if (_data.count == 0) {
+        return 0;
+    }
+    uint64_t target = (uint64_t)ceil(MAX(0.0, MIN(1.0, percentile)) * (double)_data.count);
+    uint64_t seen = 0;
+    for (NSUInteger bucket = 0; bucket < MCT_METRICS_BUCKETS; bucket++) {
+        seen += _data.buckets[bucket];
+        if (seen >= MAX(target, (uint64_t)1)) {
+            uint64_t upper = (bucket == 0) ? 0 : ((1ULL << bucket) - 1);
+            return MIN(upper, _data.maximum);
+        }
+    }
+    return _data.maximum;
+}
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %p count=%llu mean=%.0f p50=%llu p99=%llu max=%llu>",NSStringFromClass(self.class),self,_data.count,self.mean,[self valueAtPercentile:0.5],[self valueAtPercentile:0.99],_data.maximum];
+}
+
+@end
+
+// MARK: - Snapshot
+@interface MCTObjectMetricsSnapshot () {
+@public
+    MCTObjectMetricsHistogramData _durations[MCT_METRICS_OPERATIONS];
+    MCTObjectMetricsHistogramData _waitTimes[MCT_METRICS_OPERATIONS];
+    MCTObjectMetricsHistogramData _sizes[MCT_METRICS_OPERATIONS];
+}
+
+@property (nonatomic, strong, readwrite) NSDate *startDate;
+@property (nonatomic, strong, readwrite) NSDate *endDate;
+@property (nonatomic, assign, readwrite) NSUInteger maximumQueueDepth;
+
+@end
+
+@implementation MCTObjectMetricsSnapshot
+
+- (MCTObjectMetricsHistogram *)durationsForOperation:(MCTObjectMetricsOperation)operation {
+    NSParameterAssert(operation >= 0 && operation < MCT_METRICS_OPERATIONS);
+    return [[MCTObjectMetricsHistogram alloc] initWithData:_durations[operation]];
+}
+- (MCTObjectMetricsHistogram *)waitTimesForOperation:(MCTObjectMetricsOperation)operation {
+    NSParameterAssert(operation >= 0 && operation < MCT_METRICS_OPERATIONS);
+    return [[MCTObjectMetricsHistogram alloc] initWithData:_waitTimes[operation]];
+}
+- (MCTObjectMetricsHistogram *)sizesForOperation:(MCTObjectMetricsOperation)operation {
+    NSParameterAssert(operation >= 0 && operation < MCT_METRICS_OPERATIONS);
+    return [[MCTObjectMetricsHistogram alloc] initWithData:_sizes[operation]];
+}
+
+@end
+
+// MARK: - Metrics
+@interface MCTObjectMetrics () {
+    pthread_mutex_t _mutex;
+    MCTObjectMetricsHistogramData _durations[MCT_METRICS_OPERATIONS];
+    MCTObjectMetricsHistogramData _waitTimes[MCT_METRICS_OPERATIONS];
+    MCTObjectMetricsHistogramData _sizes[MCT_METRICS_OPERATIONS];
+    NSUInteger _queueDepth;
+    NSUInteger _maximumQueueDepth;
+    NSDate *_startDate;
+    NSTimeInterval _snapshotInterval;
+}
+
+@property (nonatomic, strong, readonly) NSHashTable<id<MCTObjectMetricsObserver>> *observers;
+@property (nonatomic, strong, readonly) dispatch_queue_t queue;
+@property (nonatomic, strong) dispatch_source_t timer;
+#if MCT_HAS_SIGNPOST
+@property (nonatomic, strong) os_log_t signpostLog;
+#endif
+
+@end
+
+@implementation MCTObjectMetrics
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        pthread_mutex_init(&_mutex, NULL);
+        _observers = [NSHashTable weakObjectsHashTable];
+        _queue = dispatch_queue_create("com.ministrycentered.MCTObjectMetrics", DISPATCH_QUEUE_SERIAL);
+        _startDate = [NSDate date];
+        _snapshotInterval = 60.0;
+        _emitsSignposts = YES;
+#if MCT_HAS_SIGNPOST
+        if (@available(iOS 12.0, macOS 10.14, tvOS 12.0, watchOS 5.0, *)) {
+            _signpostLog = os_log_create("com.ministrycentered.MCTObjectStore", "Performance");
+        }
+#endif
+    }
+    return self;
+}
+- (void)dealloc {
+    if (_timer) {
+        dispatch_source_cancel(_timer);
+    }
+    pthread_mutex_destroy(&_mutex);
+}
+
+// MARK: - Observers
+- (void)addObserver:(id<MCTObjectMetricsObserver>)observer {
+    NSParameterAssert(observer);
+    pthread_mutex_lock(&_mutex);
+    [self.observers addObject:observer];
+    pthread_mutex_unlock(&_mutex);
+    [self updateTimer];
+}
+- (void)removeObserver:(id<MCTObjectMetricsObserver>)observer {
+    pthread_mutex_lock(&_mutex);
+    [self.observers removeObject:observer];
+    pthread_mutex_unlock(&_mutex);
+    [self updateTimer];
+}
+- (NSTimeInterval)snapshotInterval {
+    pthread_mutex_lock(&_mutex);
+    NSTimeInterval interval = _snapshotInterval;
+    pthread_mutex_unlock(&_mutex);
+    return interval;
+}
+- (void)setSnapshotInterval:(NSTimeInterval)snapshotInterval {
+    pthread_mutex_lock(&_mutex);
+    _snapshotInterval = snapshotInterval;
+    pthread_mutex_unlock(&_mutex);
+    [self updateTimer];
+}
+- (void)updateTimer {
+    pthread_mutex_lock(&_mutex);
+    NSTimeInterval interval = _snapshotInterval;
+    BOOL observed = (self.observers.count > 0);
+    pthread_mutex_unlock(&_mutex);
+
+    __weak typeof(self) welf = self;
+    dispatch_async(self.queue, ^{
+        typeof(self) sself = welf;
+        if (!sself) {
+            return;
+        }
+        if (sself.timer) {
+            dispatch_source_cancel(sself.timer);
+            sself.timer = nil;
+        }
+        if (!observed || interval <= 0.0) {
+            return;
+        }
+        dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, sself.queue);
+        uint64_t nanoseconds = (uint64_t)(interval * NSEC_PER_SEC);
+        dispatch_source_set_timer(timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)nanoseconds), nanoseconds, nanoseconds / 10);
+        dispatch_source_set_event_handler(timer, ^{
+            [welf captureSnapshot];
+        });
+        dispatch_resume(timer);
+        sself.timer = timer;
+    });
+}
+
+// MARK: - Snapshots
+- (MCTObjectMetricsSnapshot *)snapshotAndReset:(BOOL)reset {
+    MCTObjectMetricsSnapshot *snapshot = [[MCTObjectMetricsSnapshot alloc] init];
+    NSDate *now = [NSDate date];
+    pthread_mutex_lock(&_mutex);
+    memcpy(snapshot->_durations, _durations, sizeof(_durations));
+    memcpy(snapshot->_waitTimes, _waitTimes, sizeof(_waitTimes));
+    memcpy(snapshot->_sizes, _sizes, sizeof(_sizes));
+    snapshot.maximumQueueDepth = _maximumQueueDepth;
+    snapshot.startDate = _startDate;
+    snapshot.endDate = now;
+    if (reset) {
+        memset(_durations, 0, sizeof(_durations));
+        memset(_waitTimes, 0, sizeof(_waitTimes));
+        memset(_sizes, 0, sizeof(_sizes));
+        _maximumQueueDepth = _queueDepth;
+        _startDate = now;
+    }
+    pthread_mutex_unlock(&_mutex);
+    return snapshot;
+}
+- (MCTObjectMetricsSnapshot *)snapshot {
+    return [self snapshotAndReset:NO];
+}
+- (MCTObjectMetricsSnapshot *)captureSnapshot {
+    MCTObjectMetricsSnapshot *snapshot = [self snapshotAndReset:YES];
+
+    pthread_mutex_lock(&_mutex);
+    NSArray *observers = self.observers.allObjects;
+    pthread_mutex_unlock(&_mutex);
+
+    if (observers.count > 0) {
+        dispatch_async(self.queue, ^{
+            for (id<MCTObjectMetricsObserver> observer in observers) {
+                [observer metrics:self didCaptureSnapshot:snapshot];
+            }
+        });
+    }
+    return snapshot;
+}
+
+// MARK: - Recording
+- (void)operationWillEnqueue {
+    pthread_mutex_lock(&_mutex);
+    _queueDepth++;
+    _maximumQueueDepth = MAX(_maximumQueueDepth, _queueDepth);
+    pthread_mutex_unlock(&_mutex);
+}
+- (void)operationDidDequeue {
+    pthread_mutex_lock(&_mutex);
+    if (_queueDepth > 0) {
+        _queueDepth--;
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+- (void)recordOperation:(MCTObjectMetricsOperation)operation waitTime:(uint64_t)waitTime duration:(uint64_t)duration size:(NSUInteger)size {
+    NSParameterAssert(operation >= 0 && operation < MCT_METRICS_OPERATIONS);
+    pthread_mutex_lock(&_mutex);
+    MCTObjectMetricsHistogramRecord(&_durations[operation], duration);
+    MCTObjectMetricsHistogramRecord(&_waitTimes[operation], waitTime);
+    MCTObjectMetricsHistogramRecord(&_sizes[operation], size);
+    pthread_mutex_unlock(&_mutex);
+}
+
+// MARK: - Signposts
+- (uint64_t)beginSignpostForOperation:(MCTObjectMetricsOperation)operation {
+#if MCT_HAS_SIGNPOST
+    if (!self.emitsSignposts) {
+        return 0;
+    }
+    if (@available(iOS 12.0, macOS 10.14, tvOS 12.0, watchOS 5.0, *)) {
+        os_log_t log = self.signpostLog;
+        if (!os_signpost_enabled(log)) {
+            return 0;
+        }
+        os_signpost_id_t identifier = os_signpost_id_generate(log);
+        switch (operation) {
+            case MCTObjectMetricsOperationPerform:
+                os_signpost_interval_begin(log, identifier, "Perform");
+                break;
+            case MCTObjectMetricsOperationFetch:
+                os_signpost_interval_begin(log, identifier, "Fetch");
+                break;
+            case MCTObjectMetricsOperationSave:
+                os_signpost_interval_begin(log, identifier, "Save");
+                break;
+            case MCTObjectMetricsOperationMerge:
+                os_signpost_interval_begin(log, identifier, "Merge");
+                break;
+            case MCTObjectMetricsOperationBatchRequest:
+                os_signpost_interval_begin(log, identifier, "BatchRequest");
+                break;
+        }
+        return identifier;
+    }
+#endif
+    return 0;
+}
+- (void)endSignpostForOperation:(MCTObjectMetricsOperation)operation identifier:(uint64_t)identifier {
+#if MCT_HAS_SIGNPOST
+    if (identifier == 0) {
+        return;
+    }
+    if (@available(iOS 12.0, macOS 10.14, tvOS 12.0, watchOS 5.0, *)) {
+        os_log_t log = self.signpostLog;
+        switch (operation) {
+            case MCTObjectMetricsOperationPerform:
+                os_signpost_interval_end(log, identifier, "Perform");
+                break;
+            case MCTObjectMetricsOperationFetch:
+                os_signpost_interval_end(log, identifier, "Fetch");
+                break;
+            case MCTObjectMetricsOperationSave:
+                os_signpost_interval_end(log, identifier, "Save");
+                break;
+            case MCTObjectMetricsOperationMerge:
+                os_signpost_interval_end(log, identifier, "Merge");
+                break;
+            case MCTObjectMetricsOperationBatchRequest:
+                os_signpost_interval_end(log, identifier, "BatchRequest");
+                break;
+        }
+    }
+#endif
+}
+
+@end
@@ -0,0 +1,77 @@
+/*!
+ * MCTObjectMigrator.h
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+#ifndef MCTObjectStore_MCTObjectMigrator_h
+#define MCTObjectStore_MCTObjectMigrator_h
+
+@import Foundation;
+@import CoreData;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  Migrates an existing store to a model with an NSMigrationManager so the migration can report progress.
+ *
+ *  Source models are looked up in the bundles' momd versions.  Uses a mapping model from the bundles when there is
+ *  one, otherwise an inferred mapping.
+ */
+@interface MCTObjectMigrator : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithModel:(NSManagedObjectModel *)model bundles:(NSArray<NSBundle *> *)bundles NS_DESIGNATED_INITIALIZER;
+
+@property (nonatomic, strong, readonly) NSManagedObjectModel *model;
+@property (nonatomic, copy, readonly) NSArray<NSBundle *> *bundles;
+
+/**
+ *  NO when the store doesn't exist yet or already matches the model.
+ */
+- (BOOL)requiresMigrationOfStoreAtURL:(NSURL *)URL type:(NSString *)type;
+
+/**
+ *  The version of the model the store was created with, or nil when it can't be found in the bundles.
+ */
+- (nullable NSManagedObjectModel *)sourceModelForStoreAtURL:(NSURL *)URL type:(NSString *)type;
+
+/**
+ *  Migrate the store in place.
+ *
+ *  The store is migrated to a temporary location and only replaces the original once the migration succeeds.
+ *  Cancelling the progress cancels the migration.
+ *
+ *  @param progress Completed as the migration runs.  Its total unit count is left alone.
+ */
+- (BOOL)migrateStoreAtURL:(NSURL *)URL type:(NSString *)type options:(nullable NSDictionary *)options progress:(nullable NSProgress *)progress error:(NSError **)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
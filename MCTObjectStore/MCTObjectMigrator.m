@@ -0,0 +1,198 @@
+/*!
+ * MCTObjectMigrator.m
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+#import "MCTObjectMigrator.h"
+#import "MCTObjectStoreError.h"
+#import "MCTObjectStoreLog.h"
+
+static void *MCTObjectMigratorProgressContext = &MCTObjectMigratorProgressContext;
+
+@interface MCTObjectMigrator ()
+
+@property (nonatomic, strong) NSProgress *progress;
+
+@end
+
+@implementation MCTObjectMigrator
+
+- (instancetype)initWithModel:(NSManagedObjectModel *)model bundles:(NSArray<NSBundle *> *)bundles {
+    self = [super init];
+    if (self) {
+        _model = model;
+        _bundles = [bundles copy];
+    }
+    return self;
+}
+
+// MARK: - Metadata
+- (NSDictionary *)metadataForStoreAtURL:(NSURL *)URL type:(NSString *)type {
+    if (!URL.isFileURL || ![[NSFileManager defaultManager] fileExistsAtPath:URL.path]) {
+        return nil;
+    }
+    if (@available(iOS 9.0, macOS 10.11, *)) {
+        return [NSPersistentStoreCoordinator metadataForPersistentStoreOfType:type URL:URL options:nil error:NULL];
+    }
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+    return [NSPersistentStoreCoordinator metadataForPersistentStoreOfType:type URL:URL error:NULL];
+#pragma clang diagnostic pop
+}
+
+- (BOOL)requiresMigrationOfStoreAtURL:(NSURL *)URL type:(NSString *)type {
+    NSDictionary *metadata = [self metadataForStoreAtURL:URL type:type];
+    if (!metadata) {
+        return NO;
+    }
+    return ![self.model isConfiguration:nil compatibleWithStoreMetadata:metadata];
+}
+
+- (NSManagedObjectModel *)sourceModelForStoreAtURL:(NSURL *)URL type:(NSString *)type {
+    NSDictionary *metadata = [self metadataForStoreAtURL:URL type:type];
+    if (!metadata) {
+        return nil;
+    }
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    for (NSBundle *bundle in self.bundles) {
+        NSMutableArray<NSURL *> *URLs = [NSMutableArray array];
+        for (NSURL *momd in [bundle URLsForResourcesWithExtension:@"momd" subdirectory:nil]) {
+            for (NSURL *version in [fileManager contentsOfDirectoryAtURL:momd includingPropertiesForKeys:nil options:0 error:NULL]) {
+                if ([version.pathExtension isEqualToString:@"mom"]) {
+                    [URLs addObject:version];
+                }
+            }
+        }
+        [URLs addObjectsFromArray:[bundle URLsForResourcesWithExtension:@"mom" subdirectory:nil] ?: @[]];
+
+        for (NSURL *modelURL in URLs) {
+            NSManagedObjectModel *model = [[NSManagedObjectModel alloc] initWithContentsOfURL:modelURL];
+            if ([model isConfiguration:nil compatibleWithStoreMetadata:metadata]) {
+                return model;
+            }
+        }
+    }
+    return nil;
+}
+
+// MARK: - Migrate
+- (BOOL)migrateStoreAtURL:(NSURL *)URL type:(NSString *)type options:(NSDictionary *)options progress:(NSProgress *)progress error:(NSError **)error {
+    NSManagedObjectModel *source = [self sourceModelForStoreAtURL:URL type:type];
+    if (!source) {
+        if (error != NULL) {
+            *error = [NSError errorWithDomain:MCTObjectStoreErrorDomain code:MCTObjectStoreErrorModelNotFound userInfo:@{NSLocalizedDescriptionKey: @"No model matches the store's metadata"}];
+        }
+        return NO;
+    }
+
+    NSMappingModel *mapping = [NSMappingModel mappingModelFromBundles:self.bundles forSourceModel:source destinationModel:self.model];
+    if (!mapping) {
+        mapping = [NSMappingModel inferredMappingModelForSourceModel:source destinationModel:self.model error:error];
+        if (!mapping) {
+            return NO;
+        }
+    }
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSURL *directory = [[NSURL fileURLWithPath:NSTemporaryDirectory()] URLByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    if (![fileManager createDirectoryAtURL:directory withIntermediateDirectories:YES attributes:nil error:error]) {
+        return NO;
+    }
+    NSURL *destination = [directory URLByAppendingPathComponent:URL.lastPathComponent];
+
+    NSMigrationManager *manager = [[NSMigrationManager alloc] initWithSourceModel:source destinationModel:self.model];
+    self.progress = progress;
+    [manager addObserver:self forKeyPath:NSStringFromSelector(@selector(migrationProgress)) options:0 context:MCTObjectMigratorProgressContext];
+    NSMigrationManager *__weak weakManager = manager;
+    progress.cancellationHandler = ^{
+        [weakManager cancelMigrationWithError:[NSError errorWithDomain:MCTObjectStoreErrorDomain code:MCTObjectStoreErrorCancelled userInfo:nil]];
+    };
+
+    MCTOSLog(@"Migrating store at %@",URL.path);
+    BOOL success = NO;
+    if (!progress.isCancelled) {
+        success = [manager migrateStoreFromURL:URL
+                                          type:type
+                                       options:options
+                              withMappingModel:mapping
+                              toDestinationURL:destination
+                               destinationType:type
+                            destinationOptions:options
+                                         error:error];
+    } else if (error != NULL) {
+        *error = [NSError errorWithDomain:MCTObjectStoreErrorDomain code:MCTObjectStoreErrorCancelled userInfo:nil];
+    }
+
+    progress.cancellationHandler = nil;
+    [manager removeObserver:self forKeyPath:NSStringFromSelector(@selector(migrationProgress)) context:MCTObjectMigratorProgressContext];
+    self.progress = nil;
+
+    if (success) {
+        success = [self replaceStoreAtURL:URL withStoreAtURL:destination type:type options:options error:error];
+    }
+    [fileManager removeItemAtURL:directory error:NULL];
+
+    if (success) {
+        progress.completedUnitCount = progress.totalUnitCount;
+    }
+    return success;
+}
+
+- (BOOL)replaceStoreAtURL:(NSURL *)URL withStoreAtURL:(NSURL *)sourceURL type:(NSString *)type options:(NSDictionary *)options error:(NSError **)error {
+    if (@available(iOS 9.0, macOS 10.11, *)) {
+        NSPersistentStoreCoordinator *psc = [[NSPersistentStoreCoordinator alloc] initWithManagedObjectModel:self.model];
+        return [psc replacePersistentStoreAtURL:URL destinationOptions:options withPersistentStoreFromURL:sourceURL sourceOptions:options storeType:type error:error];
+    }
+
+    // SQLite stores keep their journal next to the store.  Remove the old one so it isn't replayed into the new file.
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    for (NSString *suffix in @[@"-wal", @"-shm"]) {
+        [fileManager removeItemAtURL:[NSURL fileURLWithPath:[URL.path stringByAppendingString:suffix]] error:NULL];
+        NSURL *journal = [NSURL fileURLWithPath:[sourceURL.path stringByAppendingString:suffix]];
+        if ([fileManager fileExistsAtPath:journal.path]) {
+            if (![fileManager moveItemAtURL:journal toURL:[NSURL fileURLWithPath:[URL.path stringByAppendingString:suffix]] error:error]) {
+                return NO;
+            }
+        }
+    }
+    return [fileManager replaceItemAtURL:URL withItemAtURL:sourceURL backupItemName:nil options:0 resultingItemURL:NULL error:error];
+}
+
+// MARK: - KVO
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSKeyValueChangeKey, id> *)change context:(void *)context {
+    if (context != MCTObjectMigratorProgressContext) {
+        [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
+        return;
+    }
+    NSProgress *progress = self.progress;
+    // Hold back the last unit until the migrated store has replaced the original.
+    int64_t completed = (int64_t)([(NSMigrationManager *)object migrationProgress] * progress.totalUnitCount);
+    progress.completedUnitCount = MIN(completed, MAX(progress.totalUnitCount - 1, (int64_t)0));
+}
+
+@end
@@ -0,0 +1,75 @@
+/*!
+ * MCTObjectReaderPool.h
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+#ifndef MCTObjectStore_MCTObjectReaderPool_h
+#define MCTObjectStore_MCTObjectReaderPool_h
+
+#import <MCTObjectStore/MCTObjectContextPool.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  A pool of read-only contexts, each with its own coordinator on the same SQLite files as the pool's coordinator.
+ *
+ *  Fetches in a shared coordinator take turns on its lock.  Readers don't share one, so with the store in WAL mode they
+ *  read in parallel with each other and with writes.  Readers only see changes once they're saved to the store.
+ *
+ *  When any of the coordinator's stores isn't SQLite the readers fall back to sharing the pool's coordinator.
+ */
+@interface MCTObjectReaderPool : MCTObjectContextPool
+
+/**
+ *  Perform the block in a reader.  Changes made in the block are discarded.
+ */
+- (BOOL)performInContext:(void(^)(NSManagedObjectContext *ctx))block timeout:(NSTimeInterval)timeout;
+
+/**
+ *  Take a reader pinned to a snapshot of the store.  Everything it fetches comes from the same store version until
+ *  it's checked back in, no matter what's saved in the meantime.
+ *
+ *  The snapshot is taken at the reader's first fetch.  Holding one keeps the WAL from being checkpointed past it, so
+ *  check it back in when the work is done.
+ *
+ *  @param timeout How long to wait for a context.  Pass a negative value to wait forever.
+ */
+- (nullable NSManagedObjectContext *)checkoutSnapshotContextWithTimeout:(NSTimeInterval)timeout error:(NSError **)error NS_AVAILABLE(10_12, 10_0);
+
+/**
+ *  Perform the block in a reader pinned to a snapshot of the store.
+ *
+ *  @see checkoutSnapshotContextWithTimeout:error:
+ */
+- (BOOL)performInSnapshot:(void(^)(NSManagedObjectContext *ctx))block error:(NSError **)error NS_AVAILABLE(10_12, 10_0);
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
@@ -0,0 +1,125 @@
+/*!
+ * MCTObjectReaderPool.m
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+#import "MCTObjectReaderPool.h"
+#import "MCTObjectStoreLog.h"
+#import "MCTObjectStoreHelpers.h"
+
+@implementation MCTObjectReaderPool
+
+// MARK: - Perform
+- (BOOL)performInContext:(void(^)(NSManagedObjectContext *ctx))block timeout:(NSTimeInterval)timeout {
+    return [self performInContext:block timeout:timeout saving:NO];
+}
+
+- (BOOL)performInSnapshot:(void(^)(NSManagedObjectContext *ctx))block error:(NSError **)error {
+    MCTOSParamAssert(block);
+    NSManagedObjectContext *ctx = [self checkoutSnapshotContextWithTimeout:-1.0 error:error];
+    if (!ctx) {
+        return NO;
+    }
+    [ctx performBlockAndWait:^{
+        block(ctx);
+    }];
+    [self checkinContext:ctx];
+    return YES;
+}
+
+// MARK: - Checkout
+- (NSManagedObjectContext *)checkoutSnapshotContextWithTimeout:(NSTimeInterval)timeout error:(NSError **)error {
+    NSManagedObjectContext *ctx = [self checkoutContextWithTimeout:timeout];
+    if (!ctx) {
+        return nil;
+    }
+    BOOL __block success = NO;
+    NSError __block *pinError = nil;
+    [ctx performBlockAndWait:^{
+        success = [ctx setQueryGenerationFromToken:[NSQueryGenerationToken currentQueryGenerationToken] error:&pinError];
+    }];
+    if (!success) {
+        [self checkinContext:ctx];
+        if (error != NULL) {
+            *error = pinError;
+        }
+        return nil;
+    }
+    return ctx;
+}
+- (void)checkinContext:(NSManagedObjectContext *)ctx {
+    if (@available(iOS 10.0, macOS 10.12, *)) {
+        [ctx performBlockAndWait:^{
+            if (ctx.queryGenerationToken) {
+                [ctx setQueryGenerationFromToken:nil error:NULL];
+            }
+        }];
+    }
+    [super checkinContext:ctx];
+}
+
+- (NSManagedObjectContext *)newContext {
+    NSPersistentStoreCoordinator *psc = [self newReaderCoordinator];
+    if (!psc) {
+        return [super newContext];
+    }
+    NSManagedObjectContext *ctx = [[NSManagedObjectContext alloc] initWithConcurrencyType:NSPrivateQueueConcurrencyType];
+    ctx.persistentStoreCoordinator = psc;
+    ctx.undoManager = nil;
+    // Nothing is merged into readers, always read from the store.
+    ctx.stalenessInterval = 0.0;
+    return ctx;
+}
+
+// MARK: - Coordinator
+- (NSPersistentStoreCoordinator *)newReaderCoordinator {
+    NSPersistentStoreCoordinator *source = self.persistentStoreCoordinator;
+    NSArray<NSPersistentStore *> *stores = source.persistentStores;
+    if (stores.count == 0) {
+        return nil;
+    }
+    for (NSPersistentStore *store in stores) {
+        if (![store.type isEqualToString:NSSQLiteStoreType]) {
+            return nil;
+        }
+    }
+
+    NSPersistentStoreCoordinator *psc = [[NSPersistentStoreCoordinator alloc] initWithManagedObjectModel:source.managedObjectModel];
+    for (NSPersistentStore *store in stores) {
+        NSMutableDictionary *options = [NSMutableDictionary dictionaryWithDictionary:store.options ?: @{}];
+        options[NSReadOnlyPersistentStoreOption] = @YES;
+        NSError *error = nil;
+        if (![psc addPersistentStoreWithType:NSSQLiteStoreType configuration:store.configurationName URL:store.URL options:options error:&error]) {
+            MCTOSLog(@"Failed to add reader store at %@: %@",store.URL.path,error);
+            return nil;
+        }
+    }
+    return psc;
+}
+
+@end
@@ -37,40 +37,261 @@
 NS_ASSUME_NONNULL_BEGIN
 
 @class MCTObjectContext;
+@class MCTObjectReaderPool;
 @class MCTManagedObject;
+@class MCTObjectFuture<__covariant ResultType>;
+@class MCTObjectMetrics;
+@class MCTStoreConfiguration;
+@class MCTStoreShard;
+
+typedef NS_ENUM(NSInteger, MCTObjectStackTopology) {
+    /**
+     *  The main & private contexts both save to the coordinator.  Saving the main context writes to the store on the
+     *  main thread.
+     */
+    MCTObjectStackTopologySiblings = 0,
+    /**
+     *  A private writer context saves to the coordinator, and the main & private contexts are its children.  Saving them
+     *  pushes their changes to the writer in memory, which then writes them to the store on its own queue.
+     */
+    MCTObjectStackTopologyWriter   = 1,
+};
 
 @interface MCTObjectStack : NSObject
 
 @property (atomic, strong, readonly, nullable) MCTObjectContext *mainObjectContext;
 @property (atomic, strong, readonly, nullable) MCTObjectContext *privateObjectContext;
+/**
+ *  The parent of the main & private contexts when the stack uses MCTObjectStackTopologyWriter, otherwise nil.
+ */
+@property (atomic, strong, readonly, nullable) MCTObjectContext *writerObjectContext;
+/**
+ *  Read-only contexts with their own coordinators, for fetches that shouldn't wait on the main & private contexts.
+ *  Created when the stack is prepared.
+ */
+@property (atomic, strong, readonly, nullable) MCTObjectReaderPool *readerPool;
 
 - (BOOL)isReady;
 
+/**
+ *  Shared by the main & private contexts.  Set it before preparing the stack to include the contexts created while
+ *  preparing.  Defaults to nil.
+ */
+@property (atomic, strong, nullable) MCTObjectMetrics *metrics;
+
+/**
+ *  Store options & SQLite pragmas used when preparing the stack.  Defaults to nil, which uses
+ *  +[MCTObjectContext defaultPersistentStoreOptions].
+ */
+@property (atomic, copy, nullable) MCTStoreConfiguration *configuration;
+
+/**
+ *  Split the store into one store per shard, each holding the entities in one of the model's configurations.  Set it
+ *  before preparing the stack, the location passed to prepare is ignored when there are shards.  Defaults to nil, a
+ *  single store at the location.
+ *
+ *  Fetches made through MCTObjectContext only query the shards that can hold the entity.
+ */
+@property (atomic, copy, nullable) NSArray<MCTStoreShard *> *shards;
+
+/**
+ *  How the contexts are connected to the store.  Set it before preparing the stack.  Defaults to
+ *  MCTObjectStackTopologySiblings.
+ */
+@property (atomic, assign) MCTObjectStackTopology topology;
+
 @property (class, readonly) MCTObjectStack *sharedStack;
 
 - (BOOL)prepareModelWithName:(NSString *)name bundle:(nullable NSBundle *)bundle location:(nullable NSURL *)location error:(NSError **)error;
 - (BOOL)prepareWithModel:(NSManagedObjectModel *)model location:(nullable NSURL *)location error:(NSError **)error;
 
+// MARK: - Async Prepare
+/**
+ *  Load the model & add the store on a background queue, migrating it first if it was created with an earlier model
+ *  version.
+ *
+ *  The completion is called on the main queue after the contexts are created, before
+ *  MCTObjectStackDidBecomeReadyNotification is posted.  Don't start another prepare until it's called.
+ *
+ *  @return Progress for the whole prepare, mostly made up of the migration when there is one.  Cancelling it cancels
+ *          the migration.
+ */
+- (NSProgress *)prepareModelWithName:(NSString *)name bundle:(nullable NSBundle *)bundle location:(nullable NSURL *)location completion:(nullable void(^)(BOOL success, NSError *_Nullable error))completion;
+- (NSProgress *)prepareWithModel:(NSManagedObjectModel *)model location:(nullable NSURL *)location completion:(nullable void(^)(BOOL success, NSError *_Nullable error))completion;
+
+/**
+ *  Perform the block on the main queue once the stack is ready.
+ *
+ *  If the stack is already ready the block is performed right away when called on the main thread.  Blocks added
+ *  before the stack is ready are performed in the order they were added.
+ */
+- (void)performWhenReady:(void(^)(MCTObjectStack *stack))block;
+
 - (void)performInDisposable:(void(^)(NSManagedObjectContext *ctx))block;
 - (void)performInMainContext:(void(^)(NSManagedObjectContext *ctx))block;
 - (void)performInPrivateContext:(void(^)(NSManagedObjectContext *ctx))block;
 
+/**
+ *  Perform the block in a context from the reader pool.  Changes made in the block are discarded.
+ */
+- (void)performInReader:(void(^)(NSManagedObjectContext *ctx))block;
+/**
+ *  Perform the block in a reader pinned to a snapshot of the store, for reports that make several fetches and need
+ *  them to agree with each other.
+ *
+ *  @see -[MCTObjectReaderPool checkoutSnapshotContextWithTimeout:error:]
+ */
+- (BOOL)performInSnapshot:(void(^)(NSManagedObjectContext *ctx))block error:(NSError **)error NS_AVAILABLE(10_12, 10_0);
+
+/**
+ *  Perform the block `iterations` times concurrently, each call in a context from the main context's disposable pool.
+ *
+ *  The number of calls running at once is limited by the pool size.  Returns after every call has finished.
+ *
+ *  @param iterations The number of times to call the block
+ *  @param block      The block to perform, passed the iteration index
+ */
+- (void)performInParallel:(NSUInteger)iterations block:(void(^)(NSManagedObjectContext *ctx, NSUInteger idx))block;
+
+/**
+ *  Import values split across `workers` pooled contexts.
+ *
+ *  Values are partitioned by their unique key so the same object is never imported by two workers.  `workers` is capped
+ *  at the size of the disposable context pool.
+ *
+ *  @see -[MCTObjectContext import:values:uniqueKey:batchSize:error:]
+ */
+- (BOOL)import:(Class)type values:(NSArray<NSDictionary<NSString *, id> *> *)values uniqueKey:(NSString *)key workers:(NSUInteger)workers error:(NSError **)error;
+
 - (nullable id)performAndReturnInMainContext:(id _Nullable(^)(NSManagedObjectContext *ctx))block;
 - (nullable id)performAndReturnInPrivateContext:(id _Nullable(^)(NSManagedObjectContext *ctx))block;
 
+/**
+ *  Saves the private context, then the main context.  With a writer the changes are only pushed to it, the write to the
+ *  store happens on the writer's queue after this returns.
+ */
 - (BOOL)save:(NSError **)error;
+/**
+ *  Saves the private context, then the main context, then the writer if there is one, without blocking the caller.
+ *
+ *  @param completion Called once the changes are in the store, on the queue of the last context saved.
+ */
+- (void)saveWithCompletion:(nullable void(^)(BOOL success, NSError *_Nullable error))completion;
+/**
+ *  Save like `save:`, then wait for the writer to write everything pushed to it.  The contexts flush themselves when the
+ *  app enters the background or terminates.
+ */
+- (BOOL)flush:(NSError **)error;
+
+// MARK: - Futures
+- (MCTObjectFuture *)futureInMainContext:(void(^)(NSManagedObjectContext *ctx))block;
+- (MCTObjectFuture *)futureInPrivateContext:(void(^)(NSManagedObjectContext *ctx))block;
+
+- (MCTObjectFuture *)futureAndReturnInMainContext:(id _Nullable(^)(NSManagedObjectContext *ctx, NSError **error))block;
+- (MCTObjectFuture *)futureAndReturnInPrivateContext:(id _Nullable(^)(NSManagedObjectContext *ctx, NSError **error))block;
+
+/**
+ *  Saves the private context, then the main context, then the writer if there is one, without blocking the caller.
+ */
+- (MCTObjectFuture<NSNumber *> *)futureSave;
+
+/**
+ *  Delete objects directly in the store from the private context, or the writer when there is one.  Every context has
+ *  the deletes merged before returning.
+ *
+ *  @see -[MCTObjectContext batchDelete:predicate:error:]
+ */
+- (nullable NSArray<NSManagedObjectID *> *)batchDelete:(Class)type predicate:(nullable NSPredicate *)predicate error:(NSError **)error NS_AVAILABLE(10_11, 9_0);
+/**
+ *  Update objects directly in the store from the private context, or the writer when there is one.  Every context has
+ *  the updates merged before returning.
+ *
+ *  @see -[MCTObjectContext batchUpdate:predicate:values:error:]
+ */
+- (nullable NSArray<NSManagedObjectID *> *)batchUpdate:(Class)type predicate:(nullable NSPredicate *)predicate values:(NSDictionary<NSString *, id> *)values error:(NSError **)error;
 
 /**
  *  Destroy the store and reset the stack.
+ *
+ *  When the location is one of the stack's shards only that shard is destroyed.  An empty store is added in its
+ *  place & the stack stays ready, the contexts are reset and unsaved changes are discarded.
  */
 - (BOOL)destroyStoreAtLocation:(NSURL *)location type:(NSString *)type error:(NSError **)error NS_AVAILABLE(10_11, 9_0);
 
+/**
+ *  Idle readers are released first, a reader that's checked out can keep the WAL from being checkpointed.  The writer's
+ *  pending changes are written first.
+ *
+ *  @see -[MCTObjectContext checkpointPersistentStores:]
+ */
+- (BOOL)checkpointPersistentStores:(NSError **)error;
+/**
+ *  @see -[MCTObjectContext vacuumPersistentStores:]
+ */
+- (BOOL)vacuumPersistentStores:(NSError **)error;
+
+/**
+ *  The stores that can hold the class's entity.  nil when every store can, or the stack isn't ready.
+ *
+ *  Set it as the `affectedStores` of your own requests.
+ */
+- (nullable NSArray<NSPersistentStore *> *)affectedStoresForClass:(Class)type;
+
 - (BOOL)hardResetCoreDataStack:(NSError **)error;
 
+// MARK: - Persistent History
+/**
+ *  Recorded on the transactions saved by the stack's contexts and their pools.  `mergeHistoryForConsumer:error:` skips this
+ *  author's transactions since they were merged when they were saved.  Defaults to the process name.
+ *
+ *  The store needs `tracksPersistentHistory` set in the stack's configuration for any of the history methods to work.
+ */
+@property (atomic, copy, nullable) NSString *historyAuthor;
+/**
+ *  How long history is kept for consumers that have fallen behind.  Once it's deleted they fail with
+ *  NSPersistentHistoryTokenExpiredError and need to start over.  Defaults to 7 days.
+ */
+@property (atomic, assign) NSTimeInterval historyRetentionInterval;
+/**
+ *  How often processing history also prunes it.  Defaults to 1 day, 0 only prunes when `pruneHistory:` is called.
+ */
+@property (atomic, assign) NSTimeInterval historyPruneInterval;
+
+/**
+ *  Fetch the transactions saved since the consumer last processed history and pass them to the block, oldest first.
+ *  The block isn't called when there aren't any.
+ *
+ *  Each consumer's token is saved next to the store, so it carries over launches.  Use a different consumer for each
+ *  part of the app, and each process, that needs to see every change.
+ *
+ *  @param consumer Names the token.
+ *  @param block    Called on the calling thread.  Return NO to leave the token where it was, the same transactions are
+ *                  passed again next time.
+ */
+- (BOOL)processHistoryForConsumer:(NSString *)consumer error:(NSError **)error usingBlock:(BOOL(^)(NSArray<NSPersistentHistoryTransaction *> *transactions))block NS_AVAILABLE(10_13, 11_0);
+
+/**
+ *  Merge the changes saved by other processes & coordinators since the consumer last merged into the main & private
+ *  contexts.
+ *
+ *  When the consumer's history has expired every object is refreshed instead, and the consumer continues from the
+ *  transactions saved after the refresh.
+ */
+- (BOOL)mergeHistoryForConsumer:(NSString *)consumer error:(NSError **)error NS_AVAILABLE(10_13, 11_0);
+
+/**
+ *  Delete the history every consumer has processed, and anything older than `historyRetentionInterval`.
+ */
+- (BOOL)pruneHistory:(NSError **)error NS_AVAILABLE(10_13, 11_0);
+
 @end
 
 FOUNDATION_EXTERN NSString *const MCTObjectStackDidBecomeReadyNotification;
 FOUNDATION_EXTERN NSString *const MCTObjectStackDidDestroyStoreNotification;
+/**
+ *  The NSURL of the destroyed store, in the MCTObjectStackDidDestroyStoreNotification's userInfo.
+ */
+FOUNDATION_EXTERN NSString *const MCTObjectStackDestroyedStoreURLKey;
 
 NS_ASSUME_NONNULL_END
 
@@ -30,20 +30,43 @@
 
 #import "MCTObjectStack.h"
 #import "MCTObjectContext.h"
+#import "MCTObjectContextPool.h"
+#import "MCTObjectReaderPool.h"
+#import "MCTHistoryTokenStore.h"
+#import "MCTObjectCountRegistry.h"
+#import "MCTObjectFuture.h"
+#import "MCTStoreConfiguration.h"
+#import "MCTStoreShard.h"
 #import "MCTManagedObject.h"
 #import "MCTObjectStoreError.h"
 #import "MCTObjectStoreLog.h"
+#import "MCTObjectStoreHelpers.h"
 
 @interface MCTObjectStack ()
 
 @property (atomic, strong, readwrite) MCTObjectContext *mainObjectContext;
 @property (atomic, strong, readwrite) MCTObjectContext *privateObjectContext;
+@property (atomic, strong, readwrite) MCTObjectContext *writerObjectContext;
+@property (atomic, strong, readwrite) MCTObjectReaderPool *readerPool;
 
 @property (atomic, strong, readonly) dispatch_queue_t queue;
 
+@property (nonatomic, strong, readonly) NSMutableArray<void(^)(MCTObjectStack *)> *readyBlocks;
+// YES from becoming ready until the queued ready blocks have run.  Guarded by @synchronized(self).
+@property (nonatomic, assign, getter=isDrainingReadyBlocks) BOOL drainingReadyBlocks;
+
+// MCTHistoryTokenStore, which can't be named before iOS 11.
+@property (atomic, strong) id historyTokenStore;
+@property (atomic, strong) NSDate *lastHistoryPrune;
+
+- (MCTHistoryTokenStore *)tokenStore NS_AVAILABLE(10_13, 11_0);
+- (void)pruneHistoryIfNeeded NS_AVAILABLE(10_13, 11_0);
+
 @end
 
 @implementation MCTObjectStack
+@synthesize metrics = _metrics;
+@synthesize historyAuthor = _historyAuthor;
 
 + (instancetype)sharedStack {
     static MCTObjectStack *sharedInstance;
@@ -57,6 +80,10 @@
     self = [super init];
     if (self) {
         _queue = dispatch_queue_create("com.ministrycentered.MCTObjectStack", DISPATCH_QUEUE_CONCURRENT);
+        _readyBlocks = [NSMutableArray array];
+        _historyAuthor = [[NSProcessInfo processInfo].processName copy];
+        _historyRetentionInterval = 7.0 * 24.0 * 60.0 * 60.0;
+        _historyPruneInterval = 24.0 * 60.0 * 60.0;
     }
     return self;
 }
@@ -65,6 +92,52 @@
 - (BOOL)isReady {
     return ([self.mainObjectContext isReady] && [self.privateObjectContext isReady]);
 }
+/**
+ *  The context whose saves reach the store.  Changes made directly in the store are merged there first, so the main
+ *  & private contexts fault them from it.
+ */
+- (MCTObjectContext *)storeObjectContext {
+    return self.writerObjectContext ?: self.privateObjectContext;
+}
+- (MCTObjectMetrics *)metrics {
+    @synchronized(self) {
+        return _metrics;
+    }
+}
+- (void)setMetrics:(MCTObjectMetrics *)metrics {
+    @synchronized(self) {
+        _metrics = metrics;
+    }
+    self.mainObjectContext.metrics = metrics;
+    self.privateObjectContext.metrics = metrics;
+    self.writerObjectContext.metrics = metrics;
+}
+- (NSString *)historyAuthor {
+    @synchronized(self) {
+        return _historyAuthor;
+    }
+}
+- (void)setHistoryAuthor:(NSString *)historyAuthor {
+    @synchronized(self) {
+        _historyAuthor = [historyAuthor copy];
+    }
+    [self updateTransactionAuthor];
+}
+- (void)updateTransactionAuthor {
+    if (@available(iOS 11.0, macOS 10.13, *)) {
+        NSString *author = self.historyAuthor;
+        void(^update)(NSManagedObjectContext *) = ^(NSManagedObjectContext *ctx) {
+            ctx.transactionAuthor = author;
+        };
+        [self.mainObjectContext performInContext:update];
+        [self.privateObjectContext performInContext:update];
+        [self.writerObjectContext performInContext:update];
+        // Saves from pooled contexts are the stack's own too, they mustn't be merged back in as someone else's.
+        self.mainObjectContext.disposableContextPool.transactionAuthor = author;
+        self.privateObjectContext.disposableContextPool.transactionAuthor = author;
+        self.writerObjectContext.disposableContextPool.transactionAuthor = author;
+    }
+}
 
 // MARK: - Context
 - (BOOL)prepareModelWithName:(NSString *)name bundle:(NSBundle *)bundle location:(NSURL *)location error:(NSError **)error {
@@ -79,26 +152,146 @@
     return [self prepareWithModel:model location:location error:error];
 }
 - (BOOL)prepareWithModel:(NSManagedObjectModel *)model location:(NSURL *)location error:(NSError **)error {
-    MCTObjectContext *main = [[MCTObjectContext alloc] init];
-    if (![main prepareWithModel:model storeURL:location persistentStoreType:nil contextType:NSMainQueueConcurrencyType error:error]) {
+    NSPersistentStoreCoordinator *psc = [self newPersistentStoreCoordinatorWithModel:model location:location progress:nil error:error];
+    if (!psc) {
         return NO;
     }
-
-    MCTObjectContext *private = [main newObjectContextWithType:NSPrivateQueueConcurrencyType error:error];
-    if (!private) {
+    return [self prepareWithPersistentStoreCoordinator:psc error:error];
+}
+- (NSPersistentStoreCoordinator *)newPersistentStoreCoordinatorWithModel:(NSManagedObjectModel *)model location:(NSURL *)location progress:(NSProgress *)progress error:(NSError **)error {
+    NSArray<MCTStoreShard *> *shards = self.shards;
+    if (shards.count == 0) {
+        return [MCTObjectContext newPersistentStoreCoordinatorWithModel:model storeURL:location persistentStoreType:nil configuration:self.configuration progress:progress error:error];
+    }
+    NSPersistentStoreCoordinator *psc = [MCTObjectContext newPersistentStoreCoordinatorWithModel:model shards:shards configuration:self.configuration error:error];
+    if (psc) {
+        progress.completedUnitCount = progress.totalUnitCount;
+    }
+    return psc;
+}
+- (BOOL)prepareWithPersistentStoreCoordinator:(NSPersistentStoreCoordinator *)psc error:(NSError **)error {
+    MCTObjectContext *writer = nil;
+    MCTObjectContext *main = nil;
+    MCTObjectContext *private = nil;
+    if (self.topology == MCTObjectStackTopologyWriter) {
+        writer = [[MCTObjectContext alloc] init];
+        writer.metrics = self.metrics;
+        if (![writer prepareWithPersistentStoreCoordinator:psc contextType:NSPrivateQueueConcurrencyType error:error]) {
+            return NO;
+        }
+        main = [writer newChildObjectContextWithType:NSMainQueueConcurrencyType error:error];
+        private = (main) ? [writer newChildObjectContextWithType:NSPrivateQueueConcurrencyType error:error] : nil;
+    } else {
+        main = [[MCTObjectContext alloc] init];
+        main.metrics = self.metrics;
+        if (![main prepareWithPersistentStoreCoordinator:psc contextType:NSMainQueueConcurrencyType error:error]) {
+            return NO;
+        }
+        private = [main newObjectContextWithType:NSPrivateQueueConcurrencyType error:error];
+    }
+    if (!main || !private) {
         return NO;
     }
 
+    // Set before the stack reports ready so nothing added from here on can run ahead of the waiting blocks.
+    @synchronized(self) {
+        self.drainingReadyBlocks = YES;
+    }
+    self.writerObjectContext = writer;
     self.mainObjectContext = main;
     self.privateObjectContext = private;
+    self.historyTokenStore = nil;
+    [self updateTransactionAuthor];
+    self.readerPool = [[MCTObjectReaderPool alloc] initWithPersistentStoreCoordinator:psc maximumContexts:MAX((NSUInteger)2, [NSProcessInfo processInfo].activeProcessorCount)];
 
     dispatch_async(dispatch_get_main_queue(), ^{
+        [self performReadyBlocks];
         [[NSNotificationCenter defaultCenter] postNotificationName:MCTObjectStackDidBecomeReadyNotification object:self];
     });
 
     return YES;
 }
 
+// MARK: - Async Prepare
+- (NSProgress *)prepareModelWithName:(NSString *)name bundle:(NSBundle *)bundle location:(NSURL *)location completion:(void(^)(BOOL success, NSError *error))completion {
+    NSProgress *progress = [NSProgress progressWithTotalUnitCount:100];
+    dispatch_async(self.queue, ^{
+        NSManagedObjectModel *model = [MCTObjectContext modelWithName:name bundle:(bundle) ?: [NSBundle mainBundle]];
+        if (!model) {
+            NSError *error = [NSError errorWithDomain:MCTObjectStoreErrorDomain code:MCTObjectStoreErrorModelNotFound userInfo:nil];
+            dispatch_async(dispatch_get_main_queue(), ^{
+                if (completion) {
+                    completion(NO, error);
+                }
+            });
+            return;
+        }
+        [self prepareWithModel:model location:location progress:progress completion:completion];
+    });
+    return progress;
+}
+- (NSProgress *)prepareWithModel:(NSManagedObjectModel *)model location:(NSURL *)location completion:(void(^)(BOOL success, NSError *error))completion {
+    NSProgress *progress = [NSProgress progressWithTotalUnitCount:100];
+    dispatch_async(self.queue, ^{
+        [self prepareWithModel:model location:location progress:progress completion:completion];
+    });
+    return progress;
+}
+- (void)prepareWithModel:(NSManagedObjectModel *)model location:(NSURL *)location progress:(NSProgress *)progress completion:(void(^)(BOOL success, NSError *error))completion {
+    NSError *error = nil;
+    NSPersistentStoreCoordinator *psc = [self newPersistentStoreCoordinatorWithModel:model location:location progress:progress error:&error];
+
+    // The contexts are created on the main queue, nothing left to do there touches the disk.
+    dispatch_async(dispatch_get_main_queue(), ^{
+        NSError *prepareError = error;
+        BOOL success = (psc != nil && [self prepareWithPersistentStoreCoordinator:psc error:&prepareError]);
+        if (!success) {
+            MCTOSLog(@"Failed to prepare %@: %@",self,prepareError);
+        }
+        if (completion) {
+            completion(success, (success) ? nil : prepareError);
+        }
+    });
+}
+
+- (void)performWhenReady:(void(^)(MCTObjectStack *stack))block {
+    MCTOSParamAssert(block);
+    @synchronized(self) {
+        if (![self isReady] || [self isDrainingReadyBlocks]) {
+            // Run after the blocks already waiting.
+            [self.readyBlocks addObject:[block copy]];
+            return;
+        }
+    }
+    if ([NSThread isMainThread]) {
+        block(self);
+    } else {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            block(self);
+        });
+    }
+}
+- (void)performReadyBlocks {
+    while (YES) {
+        NSArray *blocks = nil;
+        @synchronized(self) {
+            if (![self isReady]) {
+                return;
+            }
+            blocks = [self.readyBlocks copy];
+            [self.readyBlocks removeAllObjects];
+            if (blocks.count == 0) {
+                self.drainingReadyBlocks = NO;
+                return;
+            }
+        }
+        // Blocks added while these run are queued behind them and picked up by the next pass.
+        for (void(^block)(MCTObjectStack *) in blocks) {
+            block(self);
+        }
+    }
+}
+
 // MARK: - Helpers
 - (void)performInDisposable:(void(^)(NSManagedObjectContext *ctx))block {
 #if DEBUG
@@ -126,6 +319,76 @@
     [self.privateObjectContext performInContext:block];
 }
 
+- (void)performInReader:(void(^)(NSManagedObjectContext *ctx))block {
+#if DEBUG
+    if (![self isReady]) {
+        NSLog(@"Trying to call %@ before ready.  Call %@ first!",NSStringFromSelector(_cmd),NSStringFromSelector(@selector(prepareWithModel:location:error:)));
+    }
+#endif
+    [self.readerPool performInContext:block];
+}
+- (BOOL)performInSnapshot:(void(^)(NSManagedObjectContext *ctx))block error:(NSError **)error {
+#if DEBUG
+    if (![self isReady]) {
+        NSLog(@"Trying to call %@ before ready.  Call %@ first!",NSStringFromSelector(_cmd),NSStringFromSelector(@selector(prepareWithModel:location:error:)));
+    }
+#endif
+    MCTObjectReaderPool *pool = self.readerPool;
+    if (!pool) {
+        return NO;
+    }
+    return [pool performInSnapshot:block error:error];
+}
+
+- (void)performInParallel:(NSUInteger)iterations block:(void(^)(NSManagedObjectContext *ctx, NSUInteger idx))block {
+#if DEBUG
+    if (![self isReady]) {
+        NSLog(@"Trying to call %@ before ready.  Call %@ first!",NSStringFromSelector(_cmd),NSStringFromSelector(@selector(prepareWithModel:location:error:)));
+    }
+#endif
+    MCTObjectContextPool *pool = self.mainObjectContext.disposableContextPool;
+    dispatch_apply(iterations, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(size_t idx) {
+        [pool performInContext:^(NSManagedObjectContext *ctx) {
+            block(ctx, idx);
+        }];
+    });
+}
+
+- (BOOL)import:(Class)type values:(NSArray<NSDictionary<NSString *, id> *> *)values uniqueKey:(NSString *)key workers:(NSUInteger)workers error:(NSError **)error {
+    MCTObjectContext *context = self.privateObjectContext;
+    // Workers past the pool size would only wait for a context.
+    workers = MAX(MIN(MIN(workers, values.count), context.disposableContextPool.maximumContexts), (NSUInteger)1);
+
+    NSMutableArray<NSMutableArray *> *partitions = [NSMutableArray arrayWithCapacity:workers];
+    for (NSUInteger idx = 0; idx < workers; idx++) {
+        [partitions addObject:[NSMutableArray arrayWithCapacity:(values.count / workers) + 1]];
+    }
+    [values enumerateObjectsUsingBlock:^(NSDictionary *value, NSUInteger idx, BOOL *stop) {
+        id keyValue = value[key];
+        NSUInteger partition = (keyValue && keyValue != [NSNull null]) ? ([keyValue hash] % workers) : (idx % workers);
+        [partitions[partition] addObject:value];
+    }];
+
+    NSError __block *importError = nil;
+    NSObject *lock = [[NSObject alloc] init];
+    dispatch_apply(workers, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(size_t idx) {
+        NSError *err = nil;
+        if (![context import:type values:partitions[idx] uniqueKey:key error:&err]) {
+            @synchronized (lock) {
+                importError = importError ?: err;
+            }
+        }
+    });
+
+    if (importError) {
+        if (error != NULL) {
+            *error = importError;
+        }
+        return NO;
+    }
+    return YES;
+}
+
 - (nullable id)performAndReturnInMainContext:(id _Nullable(^)(NSManagedObjectContext *ctx))block {
 #if DEBUG
     if (![self isReady]) {
@@ -153,24 +416,139 @@
     }
     return [self.mainObjectContext save:error];
 }
+- (void)saveWithCompletion:(void(^)(BOOL success, NSError *error))completion {
+    MCTObjectContext *main = self.mainObjectContext;
+    MCTObjectContext *writer = self.writerObjectContext;
+    [self.privateObjectContext saveWithCompletion:^(BOOL privateSuccess, NSError *privateError) {
+        if (!privateSuccess) {
+            MCTOS_EXEC_BLOCK(completion, NO, privateError);
+            return;
+        }
+        [main saveWithCompletion:^(BOOL mainSuccess, NSError *mainError) {
+            if (!mainSuccess || !writer) {
+                MCTOS_EXEC_BLOCK(completion, mainSuccess, mainError);
+                return;
+            }
+            [writer saveWithCompletion:completion];
+        }];
+    }];
+}
+- (BOOL)flush:(NSError **)error {
+    if (![self save:error]) {
+        return NO;
+    }
+    MCTObjectContext *writer = self.writerObjectContext;
+    return (!writer || [writer save:error]);
+}
+
+// MARK: - Futures
+- (MCTObjectFuture *)futureInMainContext:(void(^)(NSManagedObjectContext *ctx))block {
+    return [self.mainObjectContext futureInContext:block];
+}
+- (MCTObjectFuture *)futureInPrivateContext:(void(^)(NSManagedObjectContext *ctx))block {
+    return [self.privateObjectContext futureInContext:block];
+}
+- (MCTObjectFuture *)futureAndReturnInMainContext:(id(^)(NSManagedObjectContext *ctx, NSError **error))block {
+    return [self.mainObjectContext futureAndReturnInContext:block];
+}
+- (MCTObjectFuture *)futureAndReturnInPrivateContext:(id(^)(NSManagedObjectContext *ctx, NSError **error))block {
+    return [self.privateObjectContext futureAndReturnInContext:block];
+}
+- (MCTObjectFuture<NSNumber *> *)futureSave {
+    MCTObjectContext *main = self.mainObjectContext;
+    MCTObjectContext *writer = self.writerObjectContext;
+    return [[self.privateObjectContext futureSave] then:^MCTObjectFuture *(NSNumber *result) {
+        MCTObjectFuture *save = [main futureSave];
+        if (!writer) {
+            return save;
+        }
+        return [save then:^MCTObjectFuture *(NSNumber *mainResult) {
+            return [writer futureSave];
+        }];
+    }];
+}
+
+// MARK: - Batch Requests
+- (NSArray<NSManagedObjectID *> *)batchDelete:(Class)type predicate:(NSPredicate *)predicate error:(NSError **)error {
+    NSArray *objectIDs = [[self storeObjectContext] batchDelete:type predicate:predicate error:error];
+    if (objectIDs) {
+        [self mergeBatchChanges:@{NSDeletedObjectsKey: objectIDs}];
+    }
+    return objectIDs;
+}
+- (NSArray<NSManagedObjectID *> *)batchUpdate:(Class)type predicate:(NSPredicate *)predicate values:(NSDictionary<NSString *, id> *)values error:(NSError **)error {
+    NSArray *objectIDs = [[self storeObjectContext] batchUpdate:type predicate:predicate values:values error:error];
+    if (objectIDs) {
+        [self mergeBatchChanges:@{NSUpdatedObjectsKey: objectIDs}];
+    }
+    return objectIDs;
+}
+/**
+ *  The context that executed the request has already merged the changes.
+ */
+- (void)mergeBatchChanges:(NSDictionary<NSString *, NSArray<NSManagedObjectID *> *> *)changes {
+    [self.mainObjectContext mergeBatchChanges:changes];
+    if (self.writerObjectContext) {
+        [self.privateObjectContext mergeBatchChanges:changes];
+    }
+}
 
 - (BOOL)destroyStoreAtLocation:(NSURL *)location type:(NSString *)type error:(NSError **)error {
     NSPersistentStoreCoordinator *psc = self.mainObjectContext.context.persistentStoreCoordinator;
     if (!psc) {
         return NO;
     }
+    if (psc.persistentStores.count > 1 && [psc persistentStoreForURL:location]) {
+        [self.readerPool drain];
+        if (![self.mainObjectContext rebuildPersistentStoreAtURL:location error:error]) {
+            return NO;
+        }
+        [[NSNotificationCenter defaultCenter] postNotificationName:MCTObjectStackDidDestroyStoreNotification object:self userInfo:@{MCTObjectStackDestroyedStoreURLKey: location}];
+        return YES;
+    }
     if (![self hardResetCoreDataStack:error]) {
         return NO;
     }
-    if (![psc destroyPersistentStoreAtURL:location withType:type options:[MCTObjectContext defaultPersistentStoreOptions] error:error]) {
+    MCTStoreConfiguration *configuration = self.configuration;
+    NSDictionary *options = (configuration) ? [configuration persistentStoreOptionsForStoreType:type] : [MCTObjectContext defaultPersistentStoreOptions];
+    if (![psc destroyPersistentStoreAtURL:location withType:type options:options error:error]) {
         return NO;
     }
+    if (@available(iOS 11.0, macOS 10.13, *)) {
+        // The consumers' tokens are for the destroyed store.
+        [[NSFileManager defaultManager] removeItemAtURL:[MCTHistoryTokenStore directoryURLForStoreURL:location] error:NULL];
+    }
 
-    [[NSNotificationCenter defaultCenter] postNotificationName:MCTObjectStackDidDestroyStoreNotification object:self];
+    [[NSNotificationCenter defaultCenter] postNotificationName:MCTObjectStackDidDestroyStoreNotification object:self userInfo:@{MCTObjectStackDestroyedStoreURLKey: location}];
 
     return YES;
 }
 
+- (BOOL)checkpointPersistentStores:(NSError **)error {
+    // Changes pushed to the writer would stop the stores from being reloaded.
+    if (![self flushWriter:error]) {
+        return NO;
+    }
+    // Idle readers keep their connections open, which would stop the journal mode from changing.
+    [self.readerPool drain];
+    return [self.mainObjectContext checkpointPersistentStores:error];
+}
+- (BOOL)vacuumPersistentStores:(NSError **)error {
+    if (![self flushWriter:error]) {
+        return NO;
+    }
+    [self.readerPool drain];
+    return [self.mainObjectContext vacuumPersistentStores:error];
+}
+- (BOOL)flushWriter:(NSError **)error {
+    MCTObjectContext *writer = self.writerObjectContext;
+    return (!writer || [writer save:error]);
+}
+
+- (NSArray<NSPersistentStore *> *)affectedStoresForClass:(Class)type {
+    return [self.mainObjectContext.context.persistentStoreCoordinator mct_affectedStoresForEntityName:[type entityName]];
+}
+
 - (BOOL)hardResetCoreDataStack:(NSError **)error {
     [self.mainObjectContext.context performBlockAndWait:^{
         [self.mainObjectContext.context reset];
@@ -178,12 +556,143 @@
     [self.privateObjectContext.context performBlockAndWait:^{
         [self.privateObjectContext.context reset];
     }];
+    [self.writerObjectContext.context performBlockAndWait:^{
+        [self.writerObjectContext.context reset];
+    }];
+    [self.readerPool drain];
     self.mainObjectContext = nil;
     self.privateObjectContext = nil;
+    self.writerObjectContext = nil;
+    self.readerPool = nil;
+    self.historyTokenStore = nil;
+    return YES;
+}
+
+// MARK: - Persistent History
+- (MCTHistoryTokenStore *)tokenStore {
+    @synchronized(self) {
+        MCTHistoryTokenStore *store = self.historyTokenStore;
+        if (!store) {
+            // Tokens cover every store in the coordinator, keep them next to the first one.
+            NSURL *URL = nil;
+            for (NSPersistentStore *persistentStore in self.mainObjectContext.context.persistentStoreCoordinator.persistentStores) {
+                if (persistentStore.URL.isFileURL) {
+                    URL = [MCTHistoryTokenStore directoryURLForStoreURL:persistentStore.URL];
+                    break;
+                }
+            }
+            store = [[MCTHistoryTokenStore alloc] initWithDirectoryURL:URL];
+            self.historyTokenStore = store;
+        }
+        return store;
+    }
+}
+
+- (BOOL)processHistoryForConsumer:(NSString *)consumer error:(NSError **)error usingBlock:(BOOL(^)(NSArray<NSPersistentHistoryTransaction *> *transactions))block {
+    MCTOSParamAssert(consumer);
+    MCTOSParamAssert(block);
+    MCTObjectContext *context = [self storeObjectContext];
+    if (!context) {
+        return NO;
+    }
+    MCTHistoryTokenStore *tokens = [self tokenStore];
+    NSPersistentHistoryToken *token = [tokens tokenForConsumer:consumer];
+    NSDate *timestamp = [tokens timestampForConsumer:consumer];
+    NSArray<NSPersistentHistoryTransaction *> *transactions = nil;
+    if (!token && timestamp) {
+        // Restarted after an expired token.
+        transactions = [context historyTransactionsAfterDate:timestamp error:error];
+    } else {
+        transactions = [context historyTransactionsAfterToken:token error:error];
+    }
+    if (!transactions) {
+        return NO;
+    }
+    if (transactions.count > 0 && block(transactions)) {
+        NSPersistentHistoryTransaction *last = [transactions lastObject];
+        if (![tokens setToken:last.token timestamp:last.timestamp forConsumer:consumer error:error]) {
+            return NO;
+        }
+    }
+    [self pruneHistoryIfNeeded];
     return YES;
 }
 
+- (BOOL)mergeHistoryForConsumer:(NSString *)consumer error:(NSError **)error {
+    MCTObjectContext *context = [self storeObjectContext];
+    NSString *author = self.historyAuthor;
+    NSError *processError = nil;
+    BOOL success = [self processHistoryForConsumer:consumer error:&processError usingBlock:^BOOL(NSArray<NSPersistentHistoryTransaction *> *transactions) {
+        NSMutableArray *merge = [NSMutableArray arrayWithCapacity:transactions.count];
+        for (NSPersistentHistoryTransaction *transaction in transactions) {
+            if (!author || ![transaction.author isEqualToString:author]) {
+                [merge addObject:transaction];
+            }
+        }
+        [context mergeHistoryTransactions:merge];
+        return YES;
+    }];
+    if (success) {
+        return YES;
+    }
+    if (!([processError.domain isEqualToString:NSCocoaErrorDomain] && processError.code == NSPersistentHistoryTokenExpiredError)) {
+        if (error != NULL) {
+            *error = processError;
+        }
+        return NO;
+    }
+
+    // The changes can't be known anymore, so assume everything changed.
+    MCTOSLog(@"History for %@ has expired.  Refreshing all objects.",consumer);
+    // Taken before refreshing, anything saved from here on is merged next time.
+    NSDate *now = [NSDate date];
+    // The writer goes first, its children fault from it.
+    NSMutableOrderedSet<MCTObjectContext *> *contexts = [NSMutableOrderedSet orderedSetWithObject:context];
+    [contexts addObjectsFromArray:[NSArray arrayWithObjects:self.privateObjectContext, self.mainObjectContext, nil]];
+    for (MCTObjectContext *objectContext in contexts) {
+        [objectContext performInContext:^(NSManagedObjectContext *ctx) {
+            [ctx refreshAllObjects];
+        }];
+        [objectContext clearFetchResultCache];
+    }
+    [[MCTObjectCountRegistry existingRegistryForPersistentStoreCoordinator:context.context.persistentStoreCoordinator] invalidateCounts];
+
+    // Continue from the refresh instead of walking the whole history for the newest token.
+    return [[self tokenStore] setToken:nil timestamp:now forConsumer:consumer error:error];
+}
+
+- (BOOL)pruneHistory:(NSError **)error {
+    MCTObjectContext *context = [self storeObjectContext];
+    if (!context) {
+        return NO;
+    }
+    NSDate *cutoff = [NSDate dateWithTimeIntervalSinceNow:-self.historyRetentionInterval];
+    NSDate *oldest = [[self tokenStore] oldestTimestamp];
+    NSDate *date = (oldest) ? [oldest laterDate:cutoff] : cutoff;
+    MCTOSLog(@"Pruning history before %@",date);
+    if (![context deleteHistoryBeforeDate:date error:error]) {
+        return NO;
+    }
+    self.lastHistoryPrune = [NSDate date];
+    return YES;
+}
+- (void)pruneHistoryIfNeeded {
+    NSTimeInterval interval = self.historyPruneInterval;
+    if (interval <= 0.0) {
+        return;
+    }
+    NSDate *last = self.lastHistoryPrune;
+    if (last && -[last timeIntervalSinceNow] < interval) {
+        return;
+    }
+    NSError *error = nil;
+    if (![self pruneHistory:&error]) {
+        MCTOSLog(@"Failed to prune history: %@",error);
+    }
+}
+
 @end
 
 NSString *const MCTObjectStackDidBecomeReadyNotification = @"MCTObjectStackDidBecomeReadyNotification";
 NSString *const MCTObjectStackDidDestroyStoreNotification = @"MCTObjectStackDidDestroyStoreNotification";
+NSString *const MCTObjectStackDestroyedStoreURLKey = @"MCTObjectStackDestroyedStoreURLKey";
@@ -31,6 +31,15 @@
 #import <MCTObjectStore/MCTObjectContext.h>
 #import <MCTObjectStore/MCTManagedObject.h>
 #import <MCTObjectStore/MCTObjectStack.h>
+#import <MCTObjectStore/MCTObjectContextPool.h>
+#import <MCTObjectStore/MCTObjectReaderPool.h>
+#import <MCTObjectStore/MCTObjectFuture.h>
+#import <MCTObjectStore/MCTOrderCache.h>
+#import <MCTObjectStore/MCTWorkingSet.h>
+#import <MCTObjectStore/MCTObjectCountRegistry.h>
+#import <MCTObjectStore/MCTObjectMetrics.h>
+#import <MCTObjectStore/MCTStoreConfiguration.h>
+#import <MCTObjectStore/MCTStoreShard.h>
 
 #import <MCTObjectStore/MCTObjectStoreVersion.h>
 #import <MCTObjectStore/MCTObjectStoreLog.h>
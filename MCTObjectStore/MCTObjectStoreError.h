@@ -38,9 +38,12 @@ NS_ASSUME_NONNULL_BEGIN
 FOUNDATION_EXTERN NSString * const MCTObjectStoreErrorDomain;
 
 typedef NS_ENUM(NSInteger, MCTObjectStoreError) {
-    MCTObjectStoreErrorGeneric       = 0,
-    MCTObjectStoreErrorModelNotFound = -404,
-    MCTObjectStoreErrorNoObjectID    = -1556
+    MCTObjectStoreErrorGeneric              = 0,
+    MCTObjectStoreErrorModelNotFound        = -404,
+    MCTObjectStoreErrorUnsavedChanges       = -409,
+    MCTObjectStoreErrorUnsupportedStoreType = -415,
+    MCTObjectStoreErrorCancelled            = -999,
+    MCTObjectStoreErrorNoObjectID           = -1556
 };
 
 FOUNDATION_EXTERN NSString * const MCTObjectStoreGenericException;
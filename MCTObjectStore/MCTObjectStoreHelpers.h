@@ -18,5 +18,21 @@
 
 #define MCTOS_EXEC_BLOCK(block, ...) do { if (block) { block(__VA_ARGS__); } } while(0);
 
+static inline qos_class_t MCTOSQoSClass(NSQualityOfService qos) {
+    switch (qos) {
+        case NSQualityOfServiceUserInteractive:
+            return QOS_CLASS_USER_INTERACTIVE;
+        case NSQualityOfServiceUserInitiated:
+            return QOS_CLASS_USER_INITIATED;
+        case NSQualityOfServiceUtility:
+            return QOS_CLASS_UTILITY;
+        case NSQualityOfServiceBackground:
+            return QOS_CLASS_BACKGROUND;
+        case NSQualityOfServiceDefault:
+            return QOS_CLASS_DEFAULT;
+    }
+    return QOS_CLASS_DEFAULT;
+}
+
 
 #endif
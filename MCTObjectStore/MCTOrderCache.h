@@ -0,0 +1,93 @@
+/*!
+ * MCTOrderCache.h
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+#ifndef MCTObjectStore_MCTOrderCache_h
+#define MCTObjectStore_MCTOrderCache_h
+
+@import Foundation;
+@import CoreData;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  A process wide cache for values keyed by a managed object and a name, used by MCTManagedObject to hold
+ *  ordered relationships.
+ *
+ *  Entries are keyed by the owner's object ID and the name, and are only returned for the instance that stored them.
+ *  The cache is split into lock striped segments and evicts the least recently used entries once the total cost goes
+ *  over the memory budget.
+ */
+@interface MCTOrderCache : NSObject
+
++ (instancetype)sharedCache;
+
+- (instancetype)initWithMemoryBudget:(NSUInteger)memoryBudget NS_DESIGNATED_INITIALIZER;
+
+/**
+ *  The approximate number of bytes the cache can hold before it starts evicting entries.
+ *
+ *  Defaults to 8MB for the shared cache.
+ */
+@property (atomic, assign) NSUInteger memoryBudget;
+
+@property (atomic, assign, readonly) NSUInteger totalCost;
+@property (atomic, assign, readonly) NSUInteger count;
+
+// MARK: - Statistics
+@property (atomic, assign, readonly) uint64_t hitCount;
+@property (atomic, assign, readonly) uint64_t missCount;
+@property (atomic, assign, readonly) uint64_t evictionCount;
+
+- (void)resetStatistics;
+
+// MARK: - Access
+- (nullable id)objectForName:(NSString *)name owner:(NSManagedObject *)owner;
+- (void)setObject:(id)object forName:(NSString *)name owner:(NSManagedObject *)owner cost:(NSUInteger)cost;
+
+- (void)removeObjectForName:(NSString *)name owner:(NSManagedObject *)owner;
+- (void)removeObjectsForNames:(id<NSFastEnumeration>)names owner:(NSManagedObject *)owner;
+
+/**
+ *  Move the owner's entries stored under `objectID` to its current object ID.
+ *
+ *  Call this after a save replaces the owner's temporary ID with a permanent one.
+ */
+- (void)moveObjectsForNames:(id<NSFastEnumeration>)names owner:(NSManagedObject *)owner fromObjectID:(NSManagedObjectID *)objectID;
+
+/**
+ *  Evict least recently used entries until the total cost is at or below `cost`.
+ */
+- (void)trimToCost:(NSUInteger)cost;
+- (void)removeAllObjects;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
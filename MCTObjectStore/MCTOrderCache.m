@@ -0,0 +1,350 @@
+/*!
+ * MCTOrderCache.m
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+@import Darwin.POSIX.pthread;
+#import <stdatomic.h>
+
+#import "MCTOrderCache.h"
+
+#define MCT_ORDER_CACHE_STRIPES 16
+
+// MARK: - Entry
+@interface MCTOrderCacheEntry : NSObject <NSCopying> {
+@public
+    NSManagedObjectID *_objectID;
+    NSString *_name;
+    NSUInteger _hash;
+    __unsafe_unretained id _ownerPointer;
+    __weak id _owner;
+    id _value;
+    NSUInteger _cost;
+    __unsafe_unretained MCTOrderCacheEntry *_prev;
+    __unsafe_unretained MCTOrderCacheEntry *_next;
+}
+
+- (instancetype)initWithObjectID:(NSManagedObjectID *)objectID name:(NSString *)name owner:(id)owner;
+
+@end
+
+@implementation MCTOrderCacheEntry
+
+- (instancetype)initWithObjectID:(NSManagedObjectID *)objectID name:(NSString *)name owner:(id)owner {
+    self = [super init];
+    if (self) {
+        _objectID = objectID;
+        _name = [name copy];
+        _hash = objectID.hash ^ name.hash;
+        _ownerPointer = owner;
+    }
+    return self;
+}
+- (NSUInteger)hash {
+    return _hash;
+}
+- (BOOL)isEqual:(id)object {
+    if (object == self) {
+        return YES;
+    }
+    if (![object isKindOfClass:[MCTOrderCacheEntry class]]) {
+        return NO;
+    }
+    MCTOrderCacheEntry *other = object;
+    return (_ownerPointer == other->_ownerPointer && [_name isEqualToString:other->_name] && [_objectID isEqual:other->_objectID]);
+}
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+@end
+
+// MARK: - Stripe
+typedef struct {
+    pthread_mutex_t mutex;
+    CFMutableDictionaryRef entries;
+    __unsafe_unretained MCTOrderCacheEntry *head;
+    __unsafe_unretained MCTOrderCacheEntry *tail;
+    NSUInteger cost;
+} MCTOrderCacheStripe;
+
+static void MCTOrderCacheStripeUnlink(MCTOrderCacheStripe *stripe, MCTOrderCacheEntry *entry) {
+    if (entry->_prev) {
+        entry->_prev->_next = entry->_next;
+    } else {
+        stripe->head = entry->_next;
+    }
+    if (entry->_next) {
+        entry->_next->_prev = entry->_prev;
+    } else {
+        stripe->tail = entry->_prev;
+    }
+    entry->_prev = nil;
+    entry->_next = nil;
+}
+
+static void MCTOrderCacheStripeLinkHead(MCTOrderCacheStripe *stripe, MCTOrderCacheEntry *entry) {
+    entry->_prev = nil;
+    entry->_next = stripe->head;
+    if (stripe->head) {
+        stripe->head->_prev = entry;
+    }
+    stripe->head = entry;
+    if (!stripe->tail) {
+        stripe->tail = entry;
+    }
+}
+
+@interface MCTOrderCache () {
+    MCTOrderCacheStripe _stripes[MCT_ORDER_CACHE_STRIPES];
+    _Atomic(NSUInteger) _memoryBudget;
+    _Atomic(uint64_t) _hitCount;
+    _Atomic(uint64_t) _missCount;
+    _Atomic(uint64_t) _evictionCount;
+}
+
+@end
+
+@implementation MCTOrderCache
+
++ (instancetype)sharedCache {
+    static MCTOrderCache *cache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        cache = [[MCTOrderCache alloc] initWithMemoryBudget:(8 * 1024 * 1024)];
+    });
+    return cache;
+}
+
+- (instancetype)init {
+    return [self initWithMemoryBudget:(8 * 1024 * 1024)];
+}
+- (instancetype)initWithMemoryBudget:(NSUInteger)memoryBudget {
+    self = [super init];
+    if (self) {
+        atomic_init(&_memoryBudget, memoryBudget);
+        atomic_init(&_hitCount, 0);
+        atomic_init(&_missCount, 0);
+        atomic_init(&_evictionCount, 0);
+        for (NSUInteger idx = 0; idx < MCT_ORDER_CACHE_STRIPES; idx++) {
+            MCTOrderCacheStripe *stripe = &_stripes[idx];
+            pthread_mutex_init(&stripe->mutex, NULL);
+            stripe->entries = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+            stripe->head = nil;
+            stripe->tail = nil;
+            stripe->cost = 0;
+        }
+    }
+    return self;
+}
+- (void)dealloc {
+    for (NSUInteger idx = 0; idx < MCT_ORDER_CACHE_STRIPES; idx++) {
+        MCTOrderCacheStripe *stripe = &_stripes[idx];
+        stripe->head = nil;
+        stripe->tail = nil;
+        CFRelease(stripe->entries);
+        pthread_mutex_destroy(&stripe->mutex);
+    }
+}
+
+// MARK: - Properties
+- (NSUInteger)memoryBudget {
+    return atomic_load(&_memoryBudget);
+}
+- (void)setMemoryBudget:(NSUInteger)memoryBudget {
+    atomic_store(&_memoryBudget, memoryBudget);
+    [self trimToCost:memoryBudget];
+}
+- (NSUInteger)totalCost {
+    NSUInteger cost = 0;
+    for (NSUInteger idx = 0; idx < MCT_ORDER_CACHE_STRIPES; idx++) {
+        MCTOrderCacheStripe *stripe = &_stripes[idx];
+        pthread_mutex_lock(&stripe->mutex);
+        cost += stripe->cost;
+        pthread_mutex_unlock(&stripe->mutex);
+    }
+    return cost;
+}
+- (NSUInteger)count {
+    NSUInteger count = 0;
+    for (NSUInteger idx = 0; idx < MCT_ORDER_CACHE_STRIPES; idx++) {
+        MCTOrderCacheStripe *stripe = &_stripes[idx];
+        pthread_mutex_lock(&stripe->mutex);
+        count += (NSUInteger)CFDictionaryGetCount(stripe->entries);
+        pthread_mutex_unlock(&stripe->mutex);
+    }
+    return count;
+}
+
+// MARK: - Statistics
+- (uint64_t)hitCount {
+    return atomic_load(&_hitCount);
+}
+- (uint64_t)missCount {
+    return atomic_load(&_missCount);
+}
+- (uint64_t)evictionCount {
+    return atomic_load(&_evictionCount);
+}
+- (void)resetStatistics {
+    atomic_store(&_hitCount, 0);
+    atomic_store(&_missCount, 0);
+    atomic_store(&_evictionCount, 0);
+}
+
+// MARK: - Access
+- (MCTOrderCacheStripe *)stripeForKey:(MCTOrderCacheEntry *)key {
+    return &_stripes[key->_hash % MCT_ORDER_CACHE_STRIPES];
+}
+- (id)objectForName:(NSString *)name owner:(NSManagedObject *)owner {
+    MCTOrderCacheEntry *key = [[MCTOrderCacheEntry alloc] initWithObjectID:owner.objectID name:name owner:owner];
+    MCTOrderCacheStripe *stripe = [self stripeForKey:key];
+
+    id value = nil;
+    pthread_mutex_lock(&stripe->mutex);
+    MCTOrderCacheEntry *entry = (__bridge MCTOrderCacheEntry *)CFDictionaryGetValue(stripe->entries, (__bridge void *)key);
+    if (entry) {
+        if (entry->_owner == owner) {
+            value = entry->_value;
+            if (stripe->head != entry) {
+                MCTOrderCacheStripeUnlink(stripe, entry);
+                MCTOrderCacheStripeLinkHead(stripe, entry);
+            }
+        } else {
+            // The owner was deallocated and another object ended up at the same address.
+            [self removeEntry:entry stripe:stripe];
+        }
+    }
+    pthread_mutex_unlock(&stripe->mutex);
+
+    atomic_fetch_add_explicit((value ? &_hitCount : &_missCount), 1, memory_order_relaxed);
+    return value;
+}
+- (void)setObject:(id)object forName:(NSString *)name owner:(NSManagedObject *)owner cost:(NSUInteger)cost {
+    NSParameterAssert(object);
+    MCTOrderCacheEntry *entry = [[MCTOrderCacheEntry alloc] initWithObjectID:owner.objectID name:name owner:owner];
+    entry->_owner = owner;
+    entry->_value = object;
+    entry->_cost = cost;
+    [self insertEntry:entry];
+}
+- (void)insertEntry:(MCTOrderCacheEntry *)entry {
+    MCTOrderCacheStripe *stripe = [self stripeForKey:entry];
+    NSUInteger limit = atomic_load(&_memoryBudget) / MCT_ORDER_CACHE_STRIPES;
+
+    pthread_mutex_lock(&stripe->mutex);
+    MCTOrderCacheEntry *existing = (__bridge MCTOrderCacheEntry *)CFDictionaryGetValue(stripe->entries, (__bridge void *)entry);
+    if (existing) {
+        [self removeEntry:existing stripe:stripe];
+    }
+    CFDictionarySetValue(stripe->entries, (__bridge void *)entry, (__bridge void *)entry);
+    MCTOrderCacheStripeLinkHead(stripe, entry);
+    stripe->cost += entry->_cost;
+    [self evictStripe:stripe toCost:limit];
+    pthread_mutex_unlock(&stripe->mutex);
+}
+- (void)removeObjectForName:(NSString *)name owner:(NSManagedObject *)owner {
+    MCTOrderCacheEntry *key = [[MCTOrderCacheEntry alloc] initWithObjectID:owner.objectID name:name owner:owner];
+    [self removeEntryForKey:key];
+}
+- (void)removeObjectsForNames:(id<NSFastEnumeration>)names owner:(NSManagedObject *)owner {
+    NSManagedObjectID *objectID = owner.objectID;
+    for (NSString *name in names) {
+        MCTOrderCacheEntry *key = [[MCTOrderCacheEntry alloc] initWithObjectID:objectID name:name owner:owner];
+        [self removeEntryForKey:key];
+    }
+}
+- (void)moveObjectsForNames:(id<NSFastEnumeration>)names owner:(NSManagedObject *)owner fromObjectID:(NSManagedObjectID *)objectID {
+    NSManagedObjectID *newID = owner.objectID;
+    if ([newID isEqual:objectID]) {
+        return;
+    }
+    for (NSString *name in names) {
+        MCTOrderCacheEntry *key = [[MCTOrderCacheEntry alloc] initWithObjectID:objectID name:name owner:owner];
+        MCTOrderCacheEntry *old = [self removeEntryForKey:key];
+        if (!old || old->_owner != owner) {
+            continue;
+        }
+        MCTOrderCacheEntry *entry = [[MCTOrderCacheEntry alloc] initWithObjectID:newID name:name owner:owner];
+        entry->_owner = owner;
+        entry->_value = old->_value;
+        entry->_cost = old->_cost;
+        [self insertEntry:entry];
+    }
+}
+- (MCTOrderCacheEntry *)removeEntryForKey:(MCTOrderCacheEntry *)key {
+    MCTOrderCacheStripe *stripe = [self stripeForKey:key];
+    pthread_mutex_lock(&stripe->mutex);
+    MCTOrderCacheEntry *entry = (__bridge MCTOrderCacheEntry *)CFDictionaryGetValue(stripe->entries, (__bridge void *)key);
+    if (entry) {
+        [self removeEntry:entry stripe:stripe];
+    }
+    pthread_mutex_unlock(&stripe->mutex);
+    return entry;
+}
+
+// MARK: - Eviction
+// Must be called with the stripe locked.
+- (void)removeEntry:(MCTOrderCacheEntry *)entry stripe:(MCTOrderCacheStripe *)stripe {
+    MCTOrderCacheEntry *retained = entry;
+    MCTOrderCacheStripeUnlink(stripe, retained);
+    stripe->cost -= MIN(stripe->cost, retained->_cost);
+    CFDictionaryRemoveValue(stripe->entries, (__bridge void *)retained);
+}
+// Must be called with the stripe locked.
+- (void)evictStripe:(MCTOrderCacheStripe *)stripe toCost:(NSUInteger)cost {
+    uint64_t evicted = 0;
+    while (stripe->cost > cost && stripe->tail) {
+        [self removeEntry:stripe->tail stripe:stripe];
+        evicted++;
+    }
+    if (evicted > 0) {
+        atomic_fetch_add_explicit(&_evictionCount, evicted, memory_order_relaxed);
+    }
+}
+- (void)trimToCost:(NSUInteger)cost {
+    NSUInteger limit = cost / MCT_ORDER_CACHE_STRIPES;
+    for (NSUInteger idx = 0; idx < MCT_ORDER_CACHE_STRIPES; idx++) {
+        MCTOrderCacheStripe *stripe = &_stripes[idx];
+        pthread_mutex_lock(&stripe->mutex);
+        [self evictStripe:stripe toCost:limit];
+        pthread_mutex_unlock(&stripe->mutex);
+    }
+}
+- (void)removeAllObjects {
+    for (NSUInteger idx = 0; idx < MCT_ORDER_CACHE_STRIPES; idx++) {
+        MCTOrderCacheStripe *stripe = &_stripes[idx];
+        pthread_mutex_lock(&stripe->mutex);
+        stripe->head = nil;
+        stripe->tail = nil;
+        stripe->cost = 0;
+        CFDictionaryRemoveAllValues(stripe->entries);
+        pthread_mutex_unlock(&stripe->mutex);
+    }
+}
+
+@end
@@ -0,0 +1,129 @@
+/*!
+ * MCTStoreConfiguration.h
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+#ifndef MCTObjectStore_MCTStoreConfiguration_h
+#define MCTObjectStore_MCTStoreConfiguration_h
+
+@import Foundation;
+@import CoreData;
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, MCTStoreSynchronous) {
+    MCTStoreSynchronousDefault = -1,
+    MCTStoreSynchronousOff     = 0,
+    MCTStoreSynchronousNormal  = 1,
+    MCTStoreSynchronousFull    = 2
+};
+
+typedef NS_ENUM(NSInteger, MCTStoreAutoVacuum) {
+    MCTStoreAutoVacuumDefault     = -1,
+    MCTStoreAutoVacuumNone        = 0,
+    MCTStoreAutoVacuumFull        = 1,
+    MCTStoreAutoVacuumIncremental = 2
+};
+
+/**
+ *  Leaves a numeric setting at SQLite's default.
+ */
+FOUNDATION_EXTERN int64_t const MCTStoreConfigurationDefaultValue;
+
+/**
+ *  Options for adding a persistent store.  SQLite settings are passed as pragmas and ignored by other store types.
+ *
+ *  Settings left at their defaults aren't passed, so the default configuration is the same as
+ *  +[MCTObjectContext defaultPersistentStoreOptions].
+ */
+@interface MCTStoreConfiguration : NSObject <NSCopying>
+
+/**
+ *  Migration flags only.
+ */
++ (instancetype)defaultConfiguration;
+/**
+ *  WAL with NORMAL syncing and a larger page cache.  Commits don't wait for the WAL to reach the disk, so the last
+ *  transactions can be lost, but not corrupted, on power loss.
+ */
++ (instancetype)writeHeavyConfiguration;
+/**
+ *  WAL with a large page cache & memory mapped reads.
+ */
++ (instancetype)readHeavyConfiguration;
+/**
+ *  WAL with a small page cache, no memory mapping, and incremental auto-vacuum for new stores.
+ */
++ (instancetype)lowMemoryConfiguration;
+
+@property (nonatomic, assign) BOOL migratesAutomatically;
+@property (nonatomic, assign) BOOL infersMappingModel;
+
+/**
+ *  e.g. WAL, DELETE or TRUNCATE.  nil leaves Core Data's default, WAL.
+ */
+@property (nonatomic, copy, nullable) NSString *journalMode;
+@property (nonatomic, assign) MCTStoreSynchronous synchronous;
+/**
+ *  Page cache size in kilobytes.
+ */
+@property (nonatomic, assign) int64_t cacheSize;
+/**
+ *  Bytes of the database to memory map.  0 turns memory mapping off.
+ */
+@property (nonatomic, assign) int64_t mmapSize;
+/**
+ *  Only takes effect for new stores, or after the store has been vacuumed.
+ */
+@property (nonatomic, assign) MCTStoreAutoVacuum autoVacuum;
+
+/**
+ *  Record every transaction in the store's persistent history, for processes that need to find out what changed
+ *  without refetching.  Ignored before iOS 11 & macOS 10.13.
+ *
+ *  Once a store has been opened with history tracking, opening it without makes it read-only.
+ */
+@property (nonatomic, assign) BOOL tracksPersistentHistory;
+
+/**
+ *  Any other pragmas, passed as is.  Overridden by the typed settings.
+ */
+@property (nonatomic, copy, nullable) NSDictionary<NSString *, NSString *> *additionalPragmas;
+
+/**
+ *  The pragmas passed for the settings that aren't left at their defaults.
+ */
+- (NSDictionary<NSString *, NSString *> *)pragmas;
+
+- (NSDictionary<NSString *, id> *)persistentStoreOptionsForStoreType:(NSString *)storeType;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
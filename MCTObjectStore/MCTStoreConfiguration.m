@@ -0,0 +1,156 @@
+/*!
+ * MCTStoreConfiguration.m
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+#import "MCTStoreConfiguration.h"
+
+int64_t const MCTStoreConfigurationDefaultValue = -1;
+
+@implementation MCTStoreConfiguration
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _migratesAutomatically = YES;
+        _infersMappingModel = YES;
+        _synchronous = MCTStoreSynchronousDefault;
+        _cacheSize = MCTStoreConfigurationDefaultValue;
+        _mmapSize = MCTStoreConfigurationDefaultValue;
+        _autoVacuum = MCTStoreAutoVacuumDefault;
+    }
+    return self;
+}
+
+// MARK: - Presets
++ (instancetype)defaultConfiguration {
+    return [[self alloc] init];
+}
++ (instancetype)writeHeavyConfiguration {
+    MCTStoreConfiguration *configuration = [[self alloc] init];
+    configuration.journalMode = @"WAL";
+    configuration.synchronous = MCTStoreSynchronousNormal;
+    configuration.cacheSize = 8 * 1024;
+    return configuration;
+}
++ (instancetype)readHeavyConfiguration {
+    MCTStoreConfiguration *configuration = [[self alloc] init];
+    configuration.journalMode = @"WAL";
+    configuration.cacheSize = 16 * 1024;
+    configuration.mmapSize = 64 * 1024 * 1024;
+    return configuration;
+}
++ (instancetype)lowMemoryConfiguration {
+    MCTStoreConfiguration *configuration = [[self alloc] init];
+    configuration.journalMode = @"WAL";
+    configuration.cacheSize = 512;
+    configuration.mmapSize = 0;
+    configuration.autoVacuum = MCTStoreAutoVacuumIncremental;
+    return configuration;
+}
+
+// MARK: - Options
+- (NSDictionary<NSString *, NSString *> *)pragmas {
+    NSMutableDictionary *pragmas = [NSMutableDictionary dictionaryWithDictionary:self.additionalPragmas ?: @{}];
+    if (self.journalMode.length > 0) {
+        pragmas[@"journal_mode"] = self.journalMode;
+    }
+    switch (self.synchronous) {
+        case MCTStoreSynchronousOff:
+            pragmas[@"synchronous"] = @"OFF";
+            break;
+        case MCTStoreSynchronousNormal:
+            pragmas[@"synchronous"] = @"NORMAL";
+            break;
+        case MCTStoreSynchronousFull:
+            pragmas[@"synchronous"] = @"FULL";
+            break;
+        case MCTStoreSynchronousDefault:
+            break;
+    }
+    if (self.cacheSize != MCTStoreConfigurationDefaultValue) {
+        // Negative sizes are in kilobytes rather than pages.
+        pragmas[@"cache_size"] = [NSString stringWithFormat:@"%lld",-self.cacheSize];
+    }
+    if (self.mmapSize != MCTStoreConfigurationDefaultValue) {
+        pragmas[@"mmap_size"] = [NSString stringWithFormat:@"%lld",self.mmapSize];
+    }
+    switch (self.autoVacuum) {
+        case MCTStoreAutoVacuumNone:
+            pragmas[@"auto_vacuum"] = @"NONE";
+            break;
+        case MCTStoreAutoVacuumFull:
+            pragmas[@"auto_vacuum"] = @"FULL";
+            break;
+        case MCTStoreAutoVacuumIncremental:
+            pragmas[@"auto_vacuum"] = @"INCREMENTAL";
+            break;
+        case MCTStoreAutoVacuumDefault:
+            break;
+    }
+    return [pragmas copy];
+}
+
+- (NSDictionary<NSString *, id> *)persistentStoreOptionsForStoreType:(NSString *)storeType {
+    NSMutableDictionary *options = [NSMutableDictionary dictionaryWithCapacity:3];
+    options[NSMigratePersistentStoresAutomaticallyOption] = @(self.migratesAutomatically);
+    options[NSInferMappingModelAutomaticallyOption] = @(self.infersMappingModel);
+    if (self.tracksPersistentHistory) {
+        if (@available(iOS 11.0, macOS 10.13, *)) {
+            options[NSPersistentHistoryTrackingKey] = @YES;
+        }
+    }
+    if ([storeType isEqualToString:NSSQLiteStoreType]) {
+        NSDictionary *pragmas = [self pragmas];
+        if (pragmas.count > 0) {
+            options[NSSQLitePragmasOption] = pragmas;
+        }
+    }
+    return [options copy];
+}
+
+// MARK: - Copying
+- (id)copyWithZone:(NSZone *)zone {
+    MCTStoreConfiguration *configuration = [[[self class] allocWithZone:zone] init];
+    configuration.migratesAutomatically = self.migratesAutomatically;
+    configuration.infersMappingModel = self.infersMappingModel;
+    configuration.journalMode = self.journalMode;
+    configuration.synchronous = self.synchronous;
+    configuration.cacheSize = self.cacheSize;
+    configuration.mmapSize = self.mmapSize;
+    configuration.autoVacuum = self.autoVacuum;
+    configuration.tracksPersistentHistory = self.tracksPersistentHistory;
+    configuration.additionalPragmas = self.additionalPragmas;
+    return configuration;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p %@>",NSStringFromClass(self.class),self,[self pragmas]];
+}
+
+@end
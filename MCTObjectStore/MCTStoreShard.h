@@ -0,0 +1,76 @@
+/*!
+ * MCTStoreShard.h
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+#ifndef MCTObjectStore_MCTStoreShard_h
+#define MCTObjectStore_MCTStoreShard_h
+
+@import Foundation;
+@import CoreData;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class MCTStoreConfiguration;
+
+/**
+ *  One of several persistent stores sharing a coordinator.  The store holds the entities in one of the model's
+ *  configurations, e.g. frequently changing data in one file and archived data in another, or one file per tenant.
+ *
+ *  Relationships can't cross shards.
+ */
+@interface MCTStoreShard : NSObject <NSCopying>
+
++ (instancetype)shardWithConfigurationName:(nullable NSString *)configurationName location:(nullable NSURL *)location;
+- (instancetype)initWithConfigurationName:(nullable NSString *)configurationName location:(nullable NSURL *)location NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  The model configuration whose entities are kept in this store.  nil keeps every entity.
+ */
+@property (nonatomic, copy, readonly, nullable) NSString *configurationName;
+/**
+ *  nil is an in-memory store.
+ */
+@property (nonatomic, copy, readonly, nullable) NSURL *location;
+
+/**
+ *  Defaults to NSSQLiteStoreType for shards with a location, NSInMemoryStoreType without one.
+ */
+@property (nonatomic, copy, null_resettable) NSString *storeType;
+
+/**
+ *  Options for this store only.  nil uses the coordinator's configuration.
+ */
+@property (nonatomic, copy, nullable) MCTStoreConfiguration *storeConfiguration;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
@@ -0,0 +1,68 @@
+/*!
+ * MCTStoreShard.m
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+#import "MCTStoreShard.h"
+#import "MCTStoreConfiguration.h"
+
+@implementation MCTStoreShard
+
++ (instancetype)shardWithConfigurationName:(NSString *)configurationName location:(NSURL *)location {
+    return [[self alloc] initWithConfigurationName:configurationName location:location];
+}
+- (instancetype)initWithConfigurationName:(NSString *)configurationName location:(NSURL *)location {
+    self = [super init];
+    if (self) {
+        _configurationName = [configurationName copy];
+        _location = [location copy];
+    }
+    return self;
+}
+
+// MARK: - Values
+- (NSString *)storeType {
+    if (_storeType) {
+        return _storeType;
+    }
+    return (self.location) ? NSSQLiteStoreType : NSInMemoryStoreType;
+}
+
+// MARK: - Copying
+- (id)copyWithZone:(NSZone *)zone {
+    MCTStoreShard *shard = [[[self class] allocWithZone:zone] initWithConfigurationName:self.configurationName location:self.location];
+    shard->_storeType = [_storeType copy];
+    shard.storeConfiguration = self.storeConfiguration;
+    return shard;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p %@ %@>",NSStringFromClass(self.class),self,self.configurationName ?: @"(default)",self.location.path ?: self.storeType];
+}
+
+@end
@@ -0,0 +1,134 @@
+/*!
+ * MCTWorkingSet.h
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+#ifndef MCTObjectStore_MCTWorkingSet_h
+#define MCTObjectStore_MCTWorkingSet_h
+
+@import Foundation;
+@import CoreData;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  What a trim reclaimed.
+ */
+typedef struct {
+    /**
+     *  Objects turned back into faults.
+     */
+    NSUInteger objectCount;
+    /**
+     *  The approximate bytes of those objects.
+     */
+    NSUInteger cost;
+    /**
+     *  Bytes evicted from `[MCTManagedObject orderCache]`.
+     */
+    NSUInteger orderCacheCost;
+} MCTWorkingSetReclaim;
+
+/**
+ *  Keeps the number of realized objects in a context within a budget.
+ *
+ *  Objects are used when they're fetched through MCTObjectContext, inserted or updated, or passed to `touchObjects:`.
+ *  Once the used objects that are still realized are more, or more approximate bytes, than the budget allows, the least
+ *  recently used objects without changes are turned back into faults until they're under `trimRatio` of the budget.
+ *  Objects fetched some other way, e.g. by a fetched results controller, aren't counted until they're touched.
+ *
+ *  Assign it to an MCTObjectContext's `workingSet`, which turns off the context's `retainsRegisteredObjects` so the
+ *  faults are released.  A working set can only be used by one context.
+ */
+@interface MCTWorkingSet : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+/**
+ *  @param maximumObjectCount Pass 0 for no limit on the number of objects.
+ *  @param maximumCost        Pass 0 for no limit on the approximate bytes.
+ */
+- (instancetype)initWithMaximumObjectCount:(NSUInteger)maximumObjectCount maximumCost:(NSUInteger)maximumCost NS_DESIGNATED_INITIALIZER;
+
+@property (atomic, assign) NSUInteger maximumObjectCount;
+@property (atomic, assign) NSUInteger maximumCost;
+/**
+ *  The fraction of the budget a trim goes down to, so the next few fetches don't trim again.  Defaults to 0.75.
+ */
+@property (atomic, assign) double trimRatio;
+
+/**
+ *  When YES every unchanged object is turned into a fault on memory pressure, and `[MCTManagedObject orderCache]` is halved,
+ *  or emptied when the pressure is critical.  Defaults to YES.
+ */
+@property (atomic, assign) BOOL respondsToMemoryPressure;
+
+/**
+ *  The context being managed.  Set by MCTObjectContext.
+ */
+@property (atomic, weak, nullable) NSManagedObjectContext *context;
+
+- (void)touchObject:(NSManagedObject *)object;
+- (void)touchObjects:(id<NSFastEnumeration>)objects;
+
+/**
+ *  Trim on the context's queue the next time it's free, if the context is over budget.
+ */
+- (void)setNeedsTrim;
+/**
+ *  Trim now if the context is over budget.  Waits for the context's queue.
+ */
+- (MCTWorkingSetReclaim)trim;
+/**
+ *  Turn every object without changes into a fault.  Waits for the context's queue.
+ */
+- (MCTWorkingSetReclaim)trimAll;
+
+// MARK: - Statistics
+@property (atomic, assign, readonly) uint64_t trimCount;
+@property (atomic, assign, readonly) uint64_t reclaimedObjectCount;
+@property (atomic, assign, readonly) uint64_t reclaimedCost;
+@property (atomic, assign, readonly) uint64_t reclaimedOrderCacheCost;
+
+- (void)resetStatistics;
+
+@end
+
+/**
+ *  Posted on the context's queue after a trim that reclaimed anything.  The object is the working set.
+ */
+FOUNDATION_EXTERN NSString *const MCTWorkingSetDidTrimNotification;
+/**
+ *  NSNumbers in the MCTWorkingSetDidTrimNotification's userInfo.
+ */
+FOUNDATION_EXTERN NSString *const MCTWorkingSetReclaimedObjectCountKey;
+FOUNDATION_EXTERN NSString *const MCTWorkingSetReclaimedCostKey;
+FOUNDATION_EXTERN NSString *const MCTWorkingSetReclaimedOrderCacheCostKey;
+
+NS_ASSUME_NONNULL_END
+
+#endif
@@ -0,0 +1,309 @@
+/*!
+ * MCTWorkingSet.m
+ * MCTObjectStore
+ *
+ * The MIT License (MIT)
+ * Copyright (c) 2015 Ministry Centered Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Skylar Schipper
+ *   @email skylar@pco.bz
+ *
+ */
+
+@import Darwin.POSIX.pthread;
+#import <stdatomic.h>
+
+#import "MCTWorkingSet.h"
+#import "MCTOrderCache.h"
+#import "MCTManagedObject.h"
+#import "MCTObjectStoreLog.h"
+#import "MCTObjectStoreHelpers.h"
+
+@interface MCTWorkingSet () {
+    pthread_mutex_t _mutex;
+    uint64_t _clock;
+    atomic_bool _trimScheduled;
+    dispatch_source_t _memoryPressureSource;
+
+    _Atomic(uint64_t) _trimCount;
+    _Atomic(uint64_t) _reclaimedObjectCount;
+    _Atomic(uint64_t) _reclaimedCost;
+    _Atomic(uint64_t) _reclaimedOrderCacheCost;
+}
+
+// Object -> the clock when it was last used.  Guarded by _mutex.
+@property (nonatomic, strong, readonly) NSMapTable<NSManagedObject *, NSNumber *> *lastUse;
+// Entity name -> estimated cost.  Only touched on the context's queue.
+@property (nonatomic, strong, readonly) NSMutableDictionary<NSString *, NSNumber *> *entityCosts;
+
+@end
+
+@implementation MCTWorkingSet
+
+- (instancetype)initWithMaximumObjectCount:(NSUInteger)maximumObjectCount maximumCost:(NSUInteger)maximumCost {
+    self = [super init];
+    if (self) {
+        pthread_mutex_init(&_mutex, NULL);
+
+        _maximumObjectCount = maximumObjectCount;
+        _maximumCost = maximumCost;
+        _trimRatio = 0.75;
+        _respondsToMemoryPressure = YES;
+        _lastUse = [NSMapTable mapTableWithKeyOptions:(NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality) valueOptions:NSPointerFunctionsStrongMemory];
+        _entityCosts = [NSMutableDictionary dictionary];
+
+        __weak MCTWorkingSet *weakSelf = self;
+        _memoryPressureSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0, (DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL), dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+        dispatch_source_set_event_handler(_memoryPressureSource, ^{
+            MCTWorkingSet *strongSelf = weakSelf;
+            if (!strongSelf || !strongSelf.respondsToMemoryPressure) {
+                return;
+            }
+            unsigned long pressure = dispatch_source_get_data(strongSelf->_memoryPressureSource);
+            [strongSelf didReceiveMemoryPressure:((pressure & DISPATCH_MEMORYPRESSURE_CRITICAL) != 0)];
+        });
+        dispatch_resume(_memoryPressureSource);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    dispatch_source_cancel(_memoryPressureSource);
+    pthread_mutex_destroy(&_mutex);
+}
+
+// MARK: - Statistics
+- (uint64_t)trimCount {
+    return atomic_load(&_trimCount);
+}
+- (uint64_t)reclaimedObjectCount {
+    return atomic_load(&_reclaimedObjectCount);
+}
+- (uint64_t)reclaimedCost {
+    return atomic_load(&_reclaimedCost);
+}
+- (uint64_t)reclaimedOrderCacheCost {
+    return atomic_load(&_reclaimedOrderCacheCost);
+}
+- (void)resetStatistics {
+    atomic_store(&_trimCount, 0);
+    atomic_store(&_reclaimedObjectCount, 0);
+    atomic_store(&_reclaimedCost, 0);
+    atomic_store(&_reclaimedOrderCacheCost, 0);
+}
+
+// MARK: - Use
+- (void)touchObject:(NSManagedObject *)object {
+    MCTOSParamAssert(object);
+    pthread_mutex_lock(&_mutex);
+    [self.lastUse setObject:@(++_clock) forKey:object];
+    pthread_mutex_unlock(&_mutex);
+}
+- (void)touchObjects:(id<NSFastEnumeration>)objects {
+    pthread_mutex_lock(&_mutex);
+    NSNumber *now = @(++_clock);
+    for (NSManagedObject *object in objects) {
+        [self.lastUse setObject:now forKey:object];
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+// MARK: - Trim
+- (void)setNeedsTrim {
+    if (self.maximumObjectCount == 0 && self.maximumCost == 0) {
+        return;
+    }
+    NSManagedObjectContext *ctx = self.context;
+    if (!ctx || atomic_exchange(&_trimScheduled, true)) {
+        return;
+    }
+    [ctx performBlock:^{
+        atomic_store(&_trimScheduled, false);
+        [self trimContext:ctx all:NO orderCacheCost:0];
+    }];
+}
+- (MCTWorkingSetReclaim)trim {
+    return [self trimAll:NO];
+}
+- (MCTWorkingSetReclaim)trimAll {
+    return [self trimAll:YES];
+}
+- (MCTWorkingSetReclaim)trimAll:(BOOL)all {
+    MCTWorkingSetReclaim __block reclaim = {0, 0, 0};
+    NSManagedObjectContext *ctx = self.context;
+    [ctx performBlockAndWait:^{
+        reclaim = [self trimContext:ctx all:all orderCacheCost:0];
+    }];
+    return reclaim;
+}
+
+- (void)didReceiveMemoryPressure:(BOOL)critical {
+    MCTOSLog(@"%@ memory pressure, trimming %@",(critical) ? @"Critical" : @"Warning",self);
+    MCTOrderCache *orderCache = [MCTManagedObject orderCache];
+    NSUInteger before = orderCache.totalCost;
+    [orderCache trimToCost:(critical) ? 0 : before / 2];
+    NSUInteger evicted = before - MIN(before, orderCache.totalCost);
+
+    NSManagedObjectContext *ctx = self.context;
+    if (!ctx) {
+        MCTWorkingSetReclaim reclaim = {0, 0, evicted};
+        [self didReclaim:reclaim];
+        return;
+    }
+    [ctx performBlock:^{
+        [self trimContext:ctx all:YES orderCacheCost:evicted];
+    }];
+}
+
+/**
+ *  Must be called on the context's queue.
+ */
+- (MCTWorkingSetReclaim)trimContext:(NSManagedObjectContext *)ctx all:(BOOL)all orderCacheCost:(NSUInteger)orderCacheCost {
+    MCTWorkingSetReclaim reclaim = {0, 0, orderCacheCost};
+    NSUInteger maximumCount = self.maximumObjectCount;
+    NSUInteger maximumCost = self.maximumCost;
+    if (!all && maximumCount == 0 && maximumCost == 0) {
+        return reclaim;
+    }
+
+    // Only the objects that have been used are counted, so a trim costs as much as the working set instead of the
+    // whole context.  A trim of everything is rare enough to walk the registered objects.
+    NSMutableDictionary<NSValue *, NSNumber *> *ticks = [NSMutableDictionary dictionary];
+    pthread_mutex_lock(&_mutex);
+    NSMapTable *lastUse = self.lastUse;
+    NSMutableArray *used = [NSMutableArray arrayWithCapacity:lastUse.count];
+    for (NSManagedObject *object in lastUse) {
+        [used addObject:object];
+        ticks[[NSValue valueWithNonretainedObject:object]] = [lastUse objectForKey:object];
+    }
+    pthread_mutex_unlock(&_mutex);
+    NSArray<NSManagedObject *> *objects = (all) ? ctx.registeredObjects.allObjects : used;
+
+    NSUInteger count = 0;
+    NSUInteger cost = 0;
+    NSMutableArray<NSManagedObject *> *candidates = [NSMutableArray array];
+    NSMutableArray<NSManagedObject *> *stale = [NSMutableArray array];
+    for (NSManagedObject *object in objects) {
+        if (object.isFault || object.managedObjectContext != ctx) {
+            // Faulted or reset some other way, it's no longer part of the working set.
+            [stale addObject:object];
+            continue;
+        }
+        count += 1;
+        cost += [self costForEntity:object.entity];
+        if (!object.hasChanges) {
+            [candidates addObject:object];
+        }
+    }
+    BOOL(^withinBudget)(NSUInteger, NSUInteger) = ^BOOL(NSUInteger countLimit, NSUInteger costLimit) {
+        return ((maximumCount == 0 || count <= countLimit) && (maximumCost == 0 || cost <= costLimit));
+    };
+    if (!all && withinBudget(maximumCount, maximumCost)) {
+        [self forgetObjects:stale];
+        return reclaim;
+    }
+
+    double ratio = MIN(MAX(self.trimRatio, 0.0), 1.0);
+    NSUInteger targetCount = (NSUInteger)(maximumCount * ratio);
+    NSUInteger targetCost = (NSUInteger)(maximumCost * ratio);
+
+    // Least recently used first, objects that were never touched before everything else.
+    [candidates sortUsingComparator:^NSComparisonResult(NSManagedObject *lhs, NSManagedObject *rhs) {
+        uint64_t left = [ticks[[NSValue valueWithNonretainedObject:lhs]] unsignedLongLongValue];
+        uint64_t right = [ticks[[NSValue valueWithNonretainedObject:rhs]] unsignedLongLongValue];
+        return (left < right) ? NSOrderedAscending : ((left > right) ? NSOrderedDescending : NSOrderedSame);
+    }];
+
+    MCTOrderCache *orderCache = [MCTManagedObject orderCache];
+    NSUInteger orderCacheBefore = orderCache.totalCost;
+    NSUInteger faulted = 0;
+    for (NSManagedObject *object in candidates) {
+        if (!all && withinBudget(targetCount, targetCost)) {
+            break;
+        }
+        NSUInteger objectCost = [self costForEntity:object.entity];
+        // MCTManagedObject drops its order cache entries when it turns into a fault.
+        [ctx refreshObject:object mergeChanges:NO];
+        faulted += 1;
+        count -= 1;
+        cost -= objectCost;
+        reclaim.objectCount += 1;
+        reclaim.cost += objectCost;
+    }
+    reclaim.orderCacheCost += orderCacheBefore - MIN(orderCacheBefore, orderCache.totalCost);
+
+    [stale addObjectsFromArray:[candidates subarrayWithRange:NSMakeRange(0, faulted)]];
+    [self forgetObjects:stale];
+
+    [self didReclaim:reclaim];
+    return reclaim;
+}
+
+- (void)forgetObjects:(NSArray<NSManagedObject *> *)objects {
+    if (objects.count == 0) {
+        return;
+    }
+    pthread_mutex_lock(&_mutex);
+    for (NSManagedObject *object in objects) {
+        [self.lastUse removeObjectForKey:object];
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+- (void)didReclaim:(MCTWorkingSetReclaim)reclaim {
+    atomic_fetch_add_explicit(&_trimCount, 1, memory_order_relaxed);
+    if (reclaim.objectCount == 0 && reclaim.orderCacheCost == 0) {
+        return;
+    }
+    atomic_fetch_add_explicit(&_reclaimedObjectCount, reclaim.objectCount, memory_order_relaxed);
+    atomic_fetch_add_explicit(&_reclaimedCost, reclaim.cost, memory_order_relaxed);
+    atomic_fetch_add_explicit(&_reclaimedOrderCacheCost, reclaim.orderCacheCost, memory_order_relaxed);
+    MCTOSLog(@"Reclaimed %lu objects (~%lu bytes) and %lu order cache bytes",(unsigned long)reclaim.objectCount,(unsigned long)reclaim.cost,(unsigned long)reclaim.orderCacheCost);
+
+    [[NSNotificationCenter defaultCenter] postNotificationName:MCTWorkingSetDidTrimNotification
+                                                        object:self
+                                                      userInfo:@{
+                                                                 MCTWorkingSetReclaimedObjectCountKey: @(reclaim.objectCount),
+                                                                 MCTWorkingSetReclaimedCostKey: @(reclaim.cost),
+                                                                 MCTWorkingSetReclaimedOrderCacheCostKey: @(reclaim.orderCacheCost)
+                                                                 }];
+}
+
+/**
+ *  A rough size for a realized object: the object & its row snapshot, plus a slot for each property.  Values that live
+ *  outside the object, like long strings & data, aren't counted.
+ */
+- (NSUInteger)costForEntity:(NSEntityDescription *)entity {
+    NSString *name = entity.name;
+    NSNumber *cost = self.entityCosts[name];
+    if (!cost) {
+        cost = @(128 + (entity.propertiesByName.count * 32));
+        self.entityCosts[name] = cost;
+    }
+    return cost.unsignedIntegerValue;
+}
+
+@end
+
+NSString *const MCTWorkingSetDidTrimNotification = @"MCTWorkingSetDidTrimNotification";
+NSString *const MCTWorkingSetReclaimedObjectCountKey = @"MCTWorkingSetReclaimedObjectCountKey";
+NSString *const MCTWorkingSetReclaimedCostKey = @"MCTWorkingSetReclaimedCostKey";
+NSString *const MCTWorkingSetReclaimedOrderCacheCostKey = @"MCTWorkingSetReclaimedOrderCacheCostKey";
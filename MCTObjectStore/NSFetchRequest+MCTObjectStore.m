@@ -8,13 +8,14 @@
  */
 
 #import "NSFetchRequest+MCTObjectStore.h"
+#import "NSPredicate+MCTObjectStore.h"
 
 @implementation NSFetchRequest (MCTObjectStore)
 
 - (void)appendAndPredicateWithFormat:(NSString *)fmt, ... {
     va_list args;
     va_start(args, fmt);
-    NSPredicate *predicate = [NSPredicate predicateWithFormat:fmt arguments:args];
+    NSPredicate *predicate = [NSPredicate mct_cachedPredicateWithFormat:fmt arguments:args];
     va_end(args);
     [self appendAndPredicate:predicate];
 }
@@ -23,14 +24,14 @@
     if (!self.predicate) {
         self.predicate = predicate;
     } else {
-        self.predicate = [NSCompoundPredicate andPredicateWithSubpredicates:@[[self.predicate copy],predicate]];
+        self.predicate = [self.predicate andPredicate:predicate];
     }
 }
 
 - (void)appendOrPredicateWithFormat:(NSString *)fmt, ... {
     va_list args;
     va_start(args, fmt);
-    NSPredicate *predicate = [NSPredicate predicateWithFormat:fmt arguments:args];
+    NSPredicate *predicate = [NSPredicate mct_cachedPredicateWithFormat:fmt arguments:args];
     va_end(args);
     [self appendOrPredicate:predicate];
 }
@@ -39,7 +40,7 @@
     if (!self.predicate) {
         self.predicate = predicate;
     } else {
-        self.predicate = [NSCompoundPredicate orPredicateWithSubpredicates:@[[self.predicate copy],predicate]];
+        self.predicate = [self.predicate orPredicate:predicate];
     }
 }
 
@@ -16,6 +16,19 @@ NS_ASSUME_NONNULL_BEGIN
 
 @interface NSPredicate (MCTObjectStore)
 
+/**
+ *  Same as `predicateWithFormat:`, but the parsed format is cached and reused with new arguments.
+ *
+ *  Supports `%@`, `%K`, `%d`, `%i`, `%u` and `%f` style specifiers.  Formats using anything else, their own `$`
+ *  variables, SUBQUERY, or passing a nil object are parsed every time.
+ */
++ (NSPredicate *)mct_cachedPredicateWithFormat:(NSString *)fmt, ...;
++ (NSPredicate *)mct_cachedPredicateWithFormat:(NSString *)fmt arguments:(va_list)args;
+
+/**
+ *  Compounds of the same type are flattened, so chaining builds a single n-ary predicate instead of a nested tree.
+ */
+
 - (__kindof NSPredicate *)andPredicateWithFormat:(NSString *)fmt, ...;
 - (__kindof NSPredicate *)andPredicate:(NSPredicate *)predicate;
 
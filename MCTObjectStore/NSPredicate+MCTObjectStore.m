@@ -9,30 +9,210 @@
 
 #import "NSPredicate+MCTObjectStore.h"
 
+// MARK: - Templates
+static NSCache *MCTPredicateTemplateCache(void) {
+    static NSCache *cache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        cache = [[NSCache alloc] init];
+        cache.name = @"com.ministrycentered.MCTObjectStore.predicate-templates";
+        cache.countLimit = 256;
+    });
+    return cache;
+}
+
+/**
+ *  Reads the arguments for `fmt` and returns the predicate built from a cached template.
+ *
+ *  Value specifiers are replaced by `$mct_N` substitution variables so one parsed template serves every set of values.
+ *  `%K` is kept in the template and its key becomes part of the cache key.  Returns nil if the format can't be turned
+ *  into a template, in which case the arguments have been consumed and the caller has to parse `fmt` itself.
+ */
+static NSPredicate *MCTTemplatePredicate(NSString *fmt, va_list args) {
+    if ([fmt rangeOfString:@"$"].location != NSNotFound || [fmt rangeOfString:@"SUBQUERY" options:NSCaseInsensitiveSearch].location != NSNotFound) {
+        // The format already uses variables of its own.
+        return nil;
+    }
+
+    NSUInteger length = fmt.length;
+    NSMutableString *template = nil;
+    NSMutableArray<NSString *> *keys = nil;
+    NSMutableDictionary<NSString *, id> *variables = nil;
+    NSUInteger copied = 0;
+    unichar quote = 0;
+
+    for (NSUInteger idx = 0; idx < length; idx++) {
+        unichar c = [fmt characterAtIndex:idx];
+        if (quote != 0) {
+            // Specifiers inside quotes are literals.
+            if (c == '\\') {
+                idx++;
+            } else if (c == quote) {
+                quote = 0;
+            }
+            continue;
+        }
+        if (c == '\'' || c == '"') {
+            quote = c;
+            continue;
+        }
+        if (c != '%' || idx + 1 >= length) {
+            continue;
+        }
+
+        NSUInteger start = idx;
+        NSUInteger longs = 0;
+        BOOL size = NO;
+        unichar conversion = [fmt characterAtIndex:++idx];
+        while ((conversion == 'l' || conversion == 'h' || conversion == 'q' || conversion == 'z') && idx + 1 < length) {
+            if (conversion == 'l') {
+                longs++;
+            } else if (conversion == 'q') {
+                longs = 2;
+            } else if (conversion == 'z') {
+                size = YES;
+            }
+            conversion = [fmt characterAtIndex:++idx];
+        }
+
+        id value = nil;
+        switch (conversion) {
+            case '%':
+                continue;
+            case 'K': {
+                id key = va_arg(args, id);
+                if (![key isKindOfClass:[NSString class]]) {
+                    return nil;
+                }
+                if (!keys) {
+                    keys = [NSMutableArray array];
+                }
+                [keys addObject:key];
+                continue;
+            }
+            case '@':
+                value = va_arg(args, id);
+                if (!value) {
+                    return nil;
+                }
+                break;
+            case 'd':
+            case 'i':
+                if (size) {
+                    value = @(va_arg(args, ssize_t));
+                } else if (longs >= 2) {
+                    value = @(va_arg(args, long long));
+                } else if (longs == 1) {
+                    value = @(va_arg(args, long));
+                } else {
+                    value = @(va_arg(args, int));
+                }
+                break;
+            case 'u':
+                if (size) {
+                    value = @(va_arg(args, size_t));
+                } else if (longs >= 2) {
+                    value = @(va_arg(args, unsigned long long));
+                } else if (longs == 1) {
+                    value = @(va_arg(args, unsigned long));
+                } else {
+                    value = @(va_arg(args, unsigned int));
+                }
+                break;
+            case 'f':
+            case 'e':
+            case 'g':
+                value = @(va_arg(args, double));
+                break;
+            default:
+                return nil;
+        }
+
+        if (!template) {
+            template = [NSMutableString stringWithCapacity:length + 16];
+            variables = [NSMutableDictionary dictionary];
+        }
+        NSString *name = [NSString stringWithFormat:@"mct_%lu",(unsigned long)variables.count];
+        [template appendString:[fmt substringWithRange:NSMakeRange(copied, start - copied)]];
+        [template appendFormat:@"$%@",name];
+        copied = idx + 1;
+        variables[name] = value;
+    }
+
+    if (template) {
+        [template appendString:[fmt substringFromIndex:copied]];
+    }
+    NSString *format = template ?: fmt;
+    NSString *cacheKey = (keys.count > 0) ? [@[format, [keys componentsJoinedByString:@"\x1f"]] componentsJoinedByString:@"\x1e"] : format;
+
+    NSCache *cache = MCTPredicateTemplateCache();
+    NSPredicate *predicate = [cache objectForKey:cacheKey];
+    if (!predicate) {
+        predicate = [NSPredicate predicateWithFormat:format argumentArray:keys];
+        [cache setObject:predicate forKey:cacheKey];
+    }
+    if (variables.count == 0) {
+        return predicate;
+    }
+    return [predicate predicateWithSubstitutionVariables:variables];
+}
+
+// MARK: - Compounds
+static NSPredicate *MCTFlattenedCompound(NSCompoundPredicateType type, NSPredicate *lhs, NSPredicate *rhs) {
+    NSMutableArray *subpredicates = [NSMutableArray array];
+    for (NSPredicate *predicate in @[lhs, rhs]) {
+        if ([predicate isKindOfClass:[NSCompoundPredicate class]] && [(NSCompoundPredicate *)predicate compoundPredicateType] == type) {
+            [subpredicates addObjectsFromArray:[(NSCompoundPredicate *)predicate subpredicates]];
+        } else {
+            [subpredicates addObject:predicate];
+        }
+    }
+    return [[NSCompoundPredicate alloc] initWithType:type subpredicates:subpredicates];
+}
+
 @implementation NSPredicate (MCTObjectStore)
 
++ (NSPredicate *)mct_cachedPredicateWithFormat:(NSString *)fmt, ... {
+    va_list args;
+    va_start(args, fmt);
+    NSPredicate *predicate = [self mct_cachedPredicateWithFormat:fmt arguments:args];
+    va_end(args);
+    return predicate;
+}
+
++ (NSPredicate *)mct_cachedPredicateWithFormat:(NSString *)fmt arguments:(va_list)args {
+    va_list fallback;
+    va_copy(fallback, args);
+    NSPredicate *predicate = MCTTemplatePredicate(fmt, args);
+    if (!predicate) {
+        predicate = [NSPredicate predicateWithFormat:fmt arguments:fallback];
+    }
+    va_end(fallback);
+    return predicate;
+}
+
 - (NSPredicate *)andPredicateWithFormat:(NSString *)fmt, ... {
     va_list args;
     va_start(args, fmt);
-    NSPredicate *predicate = [NSPredicate predicateWithFormat:fmt arguments:args];
+    NSPredicate *predicate = [NSPredicate mct_cachedPredicateWithFormat:fmt arguments:args];
     va_end(args);
     return [self andPredicate:predicate];
 }
 
 - (NSPredicate *)andPredicate:(NSPredicate *)predicate {
-    return [NSCompoundPredicate andPredicateWithSubpredicates:@[self, predicate]];
+    return MCTFlattenedCompound(NSAndPredicateType, self, predicate);
 }
 
 - (NSPredicate *)orPredicateWithFormat:(NSString *)fmt, ... {
     va_list args;
     va_start(args, fmt);
-    NSPredicate *predicate = [NSPredicate predicateWithFormat:fmt arguments:args];
+    NSPredicate *predicate = [NSPredicate mct_cachedPredicateWithFormat:fmt arguments:args];
     va_end(args);
     return [self orPredicate:predicate];
 }
 
 - (NSPredicate *)orPredicate:(NSPredicate *)predicate {
-    return [NSCompoundPredicate orPredicateWithSubpredicates:@[self, predicate]];
+    return MCTFlattenedCompound(NSOrPredicateType, self, predicate);
 }
 
 @end
@@ -0,0 +1,292 @@
+/*!
+ * MCTObjectStoreBenchmarks.m
+ * MCTObjectStore
+ *
+ * Created by Skylar Schipper on 10/17/26
+ */
+
+#import <XCTest/XCTest.h>
+#import <MCTObjectStore/MCTObjectStore.h>
+
+#import "Person.h"
+#import "PhoneNumber.h"
+
+/**
+ *  Environment
+ *
+ *  MCT_BENCHMARK_SCALES     Comma separated object counts.  Defaults to 10000,100000,1000000.
+ *  MCT_BENCHMARK_THRESHOLD  How far past the baseline a run can be before it fails.  Defaults to 0.25 (25%).
+ *  MCT_BENCHMARK_RECORD     Set to 1 to write the results as the new baselines instead of comparing.
+ *
+ *  A metric without a recorded baseline is logged & not compared, record them on the machine that runs the benchmarks
+ *  and commit Baselines.json.  Only runs slower than their baseline fail.
+ */
+static NSString *const MCTBenchmarkScalesKey = @"MCT_BENCHMARK_SCALES";
+static NSString *const MCTBenchmarkThresholdKey = @"MCT_BENCHMARK_THRESHOLD";
+static NSString *const MCTBenchmarkRecordKey = @"MCT_BENCHMARK_RECORD";
+
+static NSUInteger const MCTBenchmarkPhoneNumbersPerPerson = 10;
+static NSUInteger const MCTBenchmarkDisposableBatchSize = 100;
+
+@interface MCTObjectStoreBenchmarks : XCTestCase
+
+@property (nonatomic, strong) NSManagedObjectModel *model;
+@property (nonatomic, strong) NSURL *storeDirectory;
+
+@end
+
+@implementation MCTObjectStoreBenchmarks
+
++ (NSMutableDictionary<NSString *, NSNumber *> *)baselines {
+    static NSMutableDictionary *baselines;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSData *data = [NSData dataWithContentsOfURL:[self baselineURL]];
+        NSDictionary *values = (data) ? [NSJSONSerialization JSONObjectWithData:data options:0 error:NULL] : nil;
+        baselines = ([values isKindOfClass:[NSDictionary class]]) ? [values mutableCopy] : [NSMutableDictionary dictionary];
+    });
+    return baselines;
+}
++ (NSURL *)baselineURL {
+    // Points into the source tree so recorded baselines can be committed.  Falls back to the copy in the bundle when
+    // the source tree isn't reachable, e.g. on a device.
+    NSBundle *bundle = [NSBundle bundleForClass:self];
+    NSString *path = [bundle objectForInfoDictionaryKey:@"MCTBenchmarkBaselinePath"];
+    if (path.length > 0 && [[NSFileManager defaultManager] fileExistsAtPath:path]) {
+        return [NSURL fileURLWithPath:path];
+    }
+    return [bundle URLForResource:@"Baselines" withExtension:@"json"];
+}
++ (void)tearDown {
+    if ([[NSProcessInfo processInfo].environment[MCTBenchmarkRecordKey] boolValue]) {
+        NSError *error = nil;
+        NSData *data = [NSJSONSerialization dataWithJSONObject:[self baselines] options:NSJSONWritingPrettyPrinted error:&error];
+        if (![data writeToURL:[self baselineURL] options:NSDataWritingAtomic error:&error]) {
+            MCTOSLog(@"Failed to record benchmark baselines: %@",error);
+        } else {
+            MCTOSLog(@"Recorded benchmark baselines to %@",[self baselineURL].path);
+        }
+    }
+    [super tearDown];
+}
+
+- (void)setUp {
+    [super setUp];
+    self.continueAfterFailure = YES;
+
+    self.model = [MCTObjectContext modelWithName:@"TestModel" bundle:[NSBundle bundleForClass:self.class]];
+    self.storeDirectory = [[NSURL fileURLWithPath:NSTemporaryDirectory()] URLByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    [[NSFileManager defaultManager] createDirectoryAtURL:self.storeDirectory withIntermediateDirectories:YES attributes:nil error:NULL];
+}
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtURL:self.storeDirectory error:NULL];
+    [[MCTOrderCache sharedCache] removeAllObjects];
+    [super tearDown];
+}
+
+// MARK: - Benchmarks
+- (void)testBulkInsert {
+    [self measure:@"insert" setUp:nil block:^(MCTObjectContext *store, NSUInteger scale) {
+        [store performInContext:^(NSManagedObjectContext *ctx) {
+            [self insertPeople:scale phoneNumbers:0 inContext:ctx];
+        }];
+    }];
+}
+
+- (void)testSave {
+    [self measure:@"save" setUp:^(MCTObjectContext *store, NSUInteger scale) {
+        [store performInContext:^(NSManagedObjectContext *ctx) {
+            [self insertPeople:scale phoneNumbers:0 inContext:ctx];
+        }];
+    } block:^(MCTObjectContext *store, NSUInteger scale) {
+        XCTAssertTrue([store save:NULL]);
+    }];
+}
+
+- (void)testPredicateFetch {
+    [self measure:@"fetch" setUp:^(MCTObjectContext *store, NSUInteger scale) {
+        [self populate:store people:scale phoneNumbers:0];
+    } block:^(MCTObjectContext *store, NSUInteger scale) {
+        NSPredicate *predicate = [NSPredicate predicateWithFormat:@"remoteID < %lu AND lastName BEGINSWITH %@",(unsigned long)(scale / 2),@"Last 1"];
+        NSArray *people = [store all:[Person class] predicate:predicate sortDescriptors:@[[NSSortDescriptor sortDescriptorWithKey:@"remoteID" ascending:YES]] bypassCache:YES error:NULL];
+        XCTAssertGreaterThan(people.count, 0);
+    }];
+}
+
+- (void)testCachedOrderedRelations {
+    NSUInteger __block people = 0;
+    [self measure:@"ordered_relations" setUp:^(MCTObjectContext *store, NSUInteger scale) {
+        people = MAX(scale / MCTBenchmarkPhoneNumbersPerPerson, (NSUInteger)1);
+        [self populate:store people:people phoneNumbers:MCTBenchmarkPhoneNumbersPerPerson];
+    } block:^(MCTObjectContext *store, NSUInteger scale) {
+        [store performInContext:^(NSManagedObjectContext *ctx) {
+            NSArray *objects = [store all:[Person class]];
+            XCTAssertEqual(objects.count, people);
+            // The first pass builds the ordering, the second should be served from the cache.
+            for (NSUInteger pass = 0; pass < 2; pass++) {
+                for (Person *person in objects) {
+                    XCTAssertEqual(person.orderedPhoneNumbers.count, MCTBenchmarkPhoneNumbersPerPerson);
+                }
+            }
+        }];
+    }];
+}
+
+- (void)testCrossContextMerge {
+    MCTObjectContext *__block source = nil;
+    dispatch_semaphore_t __block semaphore = NULL;
+    [self measure:@"merge" setUp:^(MCTObjectContext *store, NSUInteger scale) {
+        [self populate:store people:scale phoneNumbers:0];
+        // Register every object so the merge has something to refresh.
+        [store performInContext:^(NSManagedObjectContext *ctx) {
+            XCTAssertEqual([store all:[Person class]].count, scale);
+        }];
+
+        source = [store newObjectContextWithType:NSPrivateQueueConcurrencyType error:NULL];
+        [source performInContext:^(NSManagedObjectContext *ctx) {
+            for (Person *person in [source all:[Person class]]) {
+                person.lastName = [person.lastName stringByAppendingString:@" Updated"];
+            }
+        }];
+
+        // Hold the destination queue so the merge queued by the save runs inside the measured block.
+        semaphore = dispatch_semaphore_create(0);
+        dispatch_semaphore_t wait = semaphore;
+        [store performAsyncInContext:^(NSManagedObjectContext *ctx) {
+            dispatch_semaphore_wait(wait, DISPATCH_TIME_FOREVER);
+        }];
+        XCTAssertTrue([source save:NULL]);
+    } block:^(MCTObjectContext *store, NSUInteger scale) {
+        dispatch_semaphore_signal(semaphore);
+        [store performInContext:^(NSManagedObjectContext *ctx) {}];
+    }];
+}
+
+- (void)testDisposableThroughput {
+    [self measure:@"disposable" setUp:nil block:^(MCTObjectContext *store, NSUInteger scale) {
+        NSUInteger batches = MAX(scale / MCTBenchmarkDisposableBatchSize, (NSUInteger)1);
+        dispatch_apply(batches, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t idx) {
+            [store performInDisposable:^(NSManagedObjectContext *ctx) {
+                [self insertPeople:MCTBenchmarkDisposableBatchSize phoneNumbers:0 offset:idx * MCTBenchmarkDisposableBatchSize inContext:ctx];
+            }];
+        });
+    }];
+}
+
+// MARK: - Runner
+- (NSArray<NSNumber *> *)scales {
+    NSString *value = [NSProcessInfo processInfo].environment[MCTBenchmarkScalesKey];
+    if (value.length == 0) {
+        return @[@10000, @100000, @1000000];
+    }
+    NSMutableArray *scales = [NSMutableArray array];
+    for (NSString *component in [value componentsSeparatedByString:@","]) {
+        NSInteger scale = [[component stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] integerValue];
+        if (scale > 0) {
+            [scales addObject:@(scale)];
+        }
+    }
+    return scales;
+}
+- (double)threshold {
+    NSString *value = [NSProcessInfo processInfo].environment[MCTBenchmarkThresholdKey];
+    return (value.length > 0) ? [value doubleValue] : 0.25;
+}
+- (NSDictionary<NSString *, NSString *> *)storeTypes {
+    return @{@"memory": NSInMemoryStoreType, @"sqlite": NSSQLiteStoreType};
+}
+
+- (MCTObjectContext *)newStoreWithType:(NSString *)type {
+    NSURL *URL = nil;
+    if ([type isEqualToString:NSSQLiteStoreType]) {
+        URL = [self.storeDirectory URLByAppendingPathComponent:[[[NSUUID UUID] UUIDString] stringByAppendingPathExtension:@"sqlite"]];
+    }
+    MCTObjectContext *store = [[MCTObjectContext alloc] init];
+    NSError *error = nil;
+    if (![store prepareWithModel:self.model storeURL:URL persistentStoreType:type contextType:NSPrivateQueueConcurrencyType error:&error]) {
+        XCTFail(@"Failed to prepare %@ store: %@",type,error);
+        return nil;
+    }
+    return store;
+}
+
+/**
+ *  Run the block once per store type & scale, each time against a new store.  Smaller scales take the fastest of a
+ *  few runs to keep noise from failing the comparison.
+ */
+- (void)measure:(NSString *)name setUp:(void(^)(MCTObjectContext *store, NSUInteger scale))setUp block:(void(^)(MCTObjectContext *store, NSUInteger scale))block {
+    BOOL record = [[NSProcessInfo processInfo].environment[MCTBenchmarkRecordKey] boolValue];
+    NSMutableDictionary *baselines = [[self class] baselines];
+    for (NSString *storeName in [self.storeTypes.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+        for (NSNumber *scaleValue in [self scales]) {
+            NSUInteger scale = scaleValue.unsignedIntegerValue;
+            NSUInteger runs = (scale <= 10000) ? 5 : (scale <= 100000) ? 3 : 1;
+            double best = DBL_MAX;
+            for (NSUInteger run = 0; run < runs; run++) {
+                @autoreleasepool {
+                    MCTObjectContext *store = [self newStoreWithType:self.storeTypes[storeName]];
+                    if (!store) {
+                        return;
+                    }
+                    [[MCTOrderCache sharedCache] removeAllObjects];
+                    if (setUp) {
+                        setUp(store, scale);
+                    }
+                    uint64_t start = MCTObjectMetricsAbsoluteTime();
+                    block(store, scale);
+                    best = MIN(best, (double)(MCTObjectMetricsAbsoluteTime() - start) / NSEC_PER_SEC);
+                }
+            }
+
+            NSString *key = [NSString stringWithFormat:@"%@.%@.%lu",name,storeName,(unsigned long)scale];
+            NSNumber *baseline = baselines[key];
+            if (record) {
+                baselines[key] = @(best);
+                MCTOSLog(@"%@: %.4fs (recorded)",key,best);
+            } else if (baseline) {
+                double limit = baseline.doubleValue * (1.0 + [self threshold]);
+                MCTOSLog(@"%@: %.4fs (baseline %.4fs)",key,best,baseline.doubleValue);
+                XCTAssertLessThanOrEqual(best, limit, @"%@ regressed: %.4fs against a baseline of %.4fs",key,best,baseline.doubleValue);
+            } else {
+                MCTOSLog(@"%@: %.4fs (no baseline, run with %@=1 to record one)",key,best,MCTBenchmarkRecordKey);
+            }
+        }
+    }
+}
+
+// MARK: - Data
+- (void)populate:(MCTObjectContext *)store people:(NSUInteger)people phoneNumbers:(NSUInteger)phoneNumbers {
+    [store performInContext:^(NSManagedObjectContext *ctx) {
+        [self insertPeople:people phoneNumbers:phoneNumbers inContext:ctx];
+    }];
+    XCTAssertTrue([store save:NULL]);
+    [store performInContext:^(NSManagedObjectContext *ctx) {
+        [ctx reset];
+    }];
+}
+- (void)insertPeople:(NSUInteger)count phoneNumbers:(NSUInteger)phoneNumbers inContext:(NSManagedObjectContext *)ctx {
+    [self insertPeople:count phoneNumbers:phoneNumbers offset:0 inContext:ctx];
+}
+- (void)insertPeople:(NSUInteger)count phoneNumbers:(NSUInteger)phoneNumbers offset:(NSUInteger)offset inContext:(NSManagedObjectContext *)ctx {
+    NSDate *now = [NSDate date];
+    for (NSUInteger idx = offset; idx < offset + count; idx++) {
+        @autoreleasepool {
+            Person *person = [NSEntityDescription insertNewObjectForEntityForName:@"Person" inManagedObjectContext:ctx];
+            person.remoteID = @(idx);
+            person.firstName = [NSString stringWithFormat:@"First %lu",(unsigned long)idx];
+            person.lastName = [NSString stringWithFormat:@"Last %lu",(unsigned long)(idx % 1000)];
+            person.email = [NSString stringWithFormat:@"person%lu@example.com",(unsigned long)idx];
+            person.createdAt = now;
+            person.updatedAt = now;
+            for (NSUInteger number = 0; number < phoneNumbers; number++) {
+                PhoneNumber *phoneNumber = [NSEntityDescription insertNewObjectForEntityForName:@"PhoneNumber" inManagedObjectContext:ctx];
+                phoneNumber.remoteID = @(idx * phoneNumbers + number);
+                phoneNumber.name = [NSString stringWithFormat:@"Phone %lu",(unsigned long)(phoneNumbers - number)];
+                phoneNumber.number = [NSString stringWithFormat:@"555-%04lu",(unsigned long)number];
+                phoneNumber.person = person;
+            }
+        }
+    }
+}
+
+@end
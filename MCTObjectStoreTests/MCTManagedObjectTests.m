@@ -10,6 +10,7 @@
 
 #import "Person.h"
 #import "PhoneNumber.h"
+#import "User.h"
 
 @interface MCTManagedObjectTests : XCTestCase
 
@@ -77,6 +78,86 @@
     }
 }
 
+- (void)testIncrementalOrderingCaches {
+    Person *person = [self.store insertNewObject:[Person class]];
+
+    NSMutableArray *numbers = [NSMutableArray array];
+    for (NSString *name in @[@"b", @"d", @"f"]) {
+        PhoneNumber *number = [self.store insertNewObject:[PhoneNumber class]];
+        number.name = name;
+        [numbers addObject:number];
+    }
+    [person addPhoneNumbers:[NSSet setWithArray:numbers]];
+
+    NSArray *ordered = [person sortedPhoneNumbers];
+    XCTAssertEqualObjects([ordered valueForKey:@"name"], (@[@"b", @"d", @"f"]));
+
+    PhoneNumber *first = [self.store insertNewObject:[PhoneNumber class]];
+    first.name = @"a";
+    PhoneNumber *middle = [self.store insertNewObject:[PhoneNumber class]];
+    middle.name = @"e";
+    [person addPhoneNumbers:[NSSet setWithObjects:first, middle, numbers[0], nil]];
+
+    XCTAssertEqualObjects([[person sortedPhoneNumbers] valueForKey:@"name"], (@[@"a", @"b", @"d", @"e", @"f"]));
+    XCTAssertEqual(ordered.count, 3, @"Returned arrays shouldn't change underneath the caller");
+
+    [person removePhoneNumbersObject:numbers[1]];
+
+    XCTAssertEqualObjects([[person sortedPhoneNumbers] valueForKey:@"name"], (@[@"a", @"b", @"e", @"f"]));
+
+    middle.name = @"c";
+
+    XCTAssertEqualObjects([[person sortedPhoneNumbers] valueForKey:@"name"], (@[@"a", @"b", @"c", @"f"]));
+}
+
+- (void)testOrderCacheEvictsLeastRecentlyUsed {
+    MCTOrderCache *cache = [[MCTOrderCache alloc] initWithMemoryBudget:(16 * 100)];
+
+    NSMutableArray *people = [NSMutableArray array];
+    for (NSUInteger idx = 0; idx < 40; idx++) {
+        Person *person = [self.store insertNewObject:[Person class]];
+        [people addObject:person];
+        [cache setObject:@[] forName:@"phoneNumbers" owner:person cost:50];
+    }
+
+    XCTAssertLessThanOrEqual(cache.totalCost, cache.memoryBudget);
+    XCTAssertGreaterThan(cache.evictionCount, 0);
+    XCTAssertEqual(cache.count + cache.evictionCount, 40);
+
+    Person *person = [people lastObject];
+    XCTAssertNotNil([cache objectForName:@"phoneNumbers" owner:person]);
+    XCTAssertNil([cache objectForName:@"other" owner:person]);
+    XCTAssertEqual(cache.hitCount, 1);
+    XCTAssertEqual(cache.missCount, 1);
+
+    XCTAssertTrue([self.store save:NULL]);
+    XCTAssertFalse(person.objectID.isTemporaryID);
+    XCTAssertNil([cache objectForName:@"phoneNumbers" owner:person]);
+
+    [cache trimToCost:0];
+    XCTAssertEqual(cache.count, 0);
+    XCTAssertEqual(cache.totalCost, 0);
+}
+
+- (void)testOrderCacheSurvivesSave {
+    Person *person = [self.store insertNewObject:[Person class]];
+    PhoneNumber *number = [self.store insertNewObject:[PhoneNumber class]];
+    number.name = @"a";
+    [person addPhoneNumbersObject:number];
+
+    MCTOrderCache *cache = [[MCTOrderCache alloc] initWithMemoryBudget:1024];
+    [MCTManagedObject setOrderCache:cache];
+
+    XCTAssertEqual([[person orderedPhoneNumbers] count], 1);
+    XCTAssertTrue([self.store save:NULL]);
+
+    XCTAssertEqual([[person orderedPhoneNumbers] count], 1);
+    XCTAssertEqual(cache.hitCount, 1);
+    XCTAssertEqual(cache.missCount, 1);
+
+    [MCTManagedObject setOrderCache:nil];
+}
+
 - (void)testCount {
     [self.store insertNewObject:[Person class]];
     [self.store insertNewObject:[Person class]];
@@ -89,6 +170,41 @@
     XCTAssertEqual([Person countInContext:self.store.context error:NULL], 4);
 }
 
+- (void)testRegisteredCounts {
+    NSManagedObjectContext *ctx = self.store.context;
+    NSPredicate *predicate = [NSPredicate predicateWithFormat:@"lastName == %@", @"Smith"];
+    [Person registerCountInContext:ctx predicate:predicate];
+
+    MCTObjectCountRegistry *registry = [MCTObjectCountRegistry existingRegistryForPersistentStoreCoordinator:ctx.persistentStoreCoordinator];
+    XCTAssertTrue([registry isRegisteredEntityName:[Person entityName] predicate:predicate]);
+
+    Person *first = [self.store insertNewObject:[Person class]];
+    first.lastName = @"Smith";
+    Person *second = [self.store insertNewObject:[Person class]];
+    second.lastName = @"Smith";
+    Person *third = [self.store insertNewObject:[Person class]];
+    third.lastName = @"Jones";
+    XCTAssertTrue([self.store save:NULL]);
+
+    XCTAssertEqual([Person countInContext:ctx predicate:predicate error:NULL], 2);
+
+    NSManagedObjectID *secondID = second.objectID;
+    [self.store performInDisposable:^(NSManagedObjectContext *disposable) {
+        [Person insertIntoContext:disposable values:@{@"lastName": @"Smith"}];
+        Person *person = [disposable existingObjectWithID:secondID error:NULL];
+        person.lastName = @"Jones";
+    }];
+    XCTAssertEqual([registry countForEntityName:[Person entityName] predicate:predicate inContext:ctx error:NULL], 2);
+
+    [first destroy];
+    XCTAssertTrue([self.store save:NULL]);
+    XCTAssertEqual([registry countForEntityName:[Person entityName] predicate:predicate inContext:ctx error:NULL], 1);
+    XCTAssertEqual([Person countInContext:ctx predicate:predicate error:NULL], 1);
+
+    [registry invalidateCounts];
+    XCTAssertEqual([Person countInContext:ctx predicate:predicate error:NULL], 1);
+}
+
 - (void)testDeletingObject {
     Person *person = [self.store insertNewObject:[Person class]];
     XCTAssertTrue([self.store save:NULL]);
@@ -98,4 +214,51 @@
     XCTAssertTrue([self.store save:NULL]);
 }
 
+- (void)testNoOpWriteSuppression {
+    MCTObjectContext *context = [[MCTObjectContext alloc] init];
+    XCTAssertTrue([context prepareWithModelName:@"TestModel_2" bundle:[NSBundle bundleForClass:self.class] storeURL:nil]);
+    NSManagedObjectContext *ctx = context.context;
+
+    User *user = [context insertNewObject:[User class]];
+    user.firstName = @"First";
+    XCTAssertTrue([context save:NULL]);
+    [MCTManagedObject resetNoOpWriteStatistics];
+
+    [user setValue:@"First" forKey:@"firstName"];
+    [user setValuesForKeysWithDictionary:@{@"firstName": @"First", @"lastName": [NSNull null]}];
+    XCTAssertFalse([ctx hasChanges]);
+    XCTAssertEqual(MCTManagedObject.suppressedWriteCount, 3);
+
+    user.firstName = @"Second";
+    user.firstName = @"First";
+    XCTAssertTrue([ctx hasChanges]);
+    XCTAssertEqual([MCTManagedObject revertNoOpUpdatesInContext:ctx], 1);
+    XCTAssertFalse([ctx hasChanges]);
+    XCTAssertEqualObjects(user.firstName, @"First");
+    XCTAssertEqual(MCTManagedObject.revertedUpdateCount, 1);
+
+    [user setValue:@"Changed" forKey:@"firstName"];
+    XCTAssertEqual([MCTManagedObject revertNoOpUpdatesInContext:ctx], 0);
+    XCTAssertTrue([ctx hasChanges]);
+    XCTAssertTrue([context save:NULL]);
+
+    [user importValues:@{@"firstName": @"Changed", @"lastName": [NSNull null]}];
+    XCTAssertFalse([ctx hasChanges]);
+    XCTAssertEqual(MCTManagedObject.suppressedWriteCount, 5);
+
+    // The pool reverts the no-op update before deciding whether to save.
+    NSManagedObjectID *objectID = user.objectID;
+    [context performInDisposable:^(NSManagedObjectContext *pooled) {
+        User *pooledUser = (User *)[pooled existingObjectWithID:objectID error:NULL];
+        [pooledUser importValues:@{@"firstName": @"Changed"}];
+        pooledUser.lastName = @"Last";
+        pooledUser.lastName = nil;
+        XCTAssertTrue([pooled hasChanges]);
+    }];
+    XCTAssertEqual(MCTManagedObject.suppressedWriteCount, 6);
+    XCTAssertEqual(MCTManagedObject.revertedUpdateCount, 2);
+    XCTAssertEqualObjects(user.firstName, @"Changed");
+    XCTAssertNil(user.lastName);
+}
+
 @end
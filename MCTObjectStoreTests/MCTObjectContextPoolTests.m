@@ -0,0 +1,129 @@
+/*!
+ * MCTObjectContextPoolTests.m
+ * MCTObjectStore
+ *
+ * Created by Skylar Schipper on 10/17/26
+ */
+
+#import <XCTest/XCTest.h>
+#import <MCTObjectStore/MCTObjectStore.h>
+
+#import "Person.h"
+
+@interface MCTObjectContextPoolTests : XCTestCase
+
+@property (nonatomic, strong) MCTObjectContext *store;
+
+@end
+
+@implementation MCTObjectContextPoolTests
+
+- (void)setUp {
+    [super setUp];
+    self.store = [[MCTObjectContext alloc] init];
+
+    XCTAssertTrue([self.store prepareWithModelName:@"TestModel" bundle:[NSBundle bundleForClass:self.class] storeURL:nil]);
+}
+
+// MARK: - Tests
+- (void)testContextsAreReused {
+    MCTObjectContextPool *pool = [[MCTObjectContextPool alloc] initWithPersistentStoreCoordinator:self.store.context.persistentStoreCoordinator maximumContexts:1];
+
+    NSManagedObjectContext *ctx = [pool checkoutContextWithTimeout:0.0];
+    XCTAssertNotNil(ctx);
+    [ctx performBlockAndWait:^{
+        [Person insertIntoContext:ctx];
+    }];
+    [pool checkinContext:ctx];
+
+    NSManagedObjectContext *reused = [pool checkoutContextWithTimeout:0.0];
+    XCTAssertEqual(ctx, reused);
+    XCTAssertFalse([reused hasChanges]);
+    [pool checkinContext:reused];
+}
+
+- (void)testExhaustedPoolTimesOut {
+    MCTObjectContextPool *pool = [[MCTObjectContextPool alloc] initWithPersistentStoreCoordinator:self.store.context.persistentStoreCoordinator maximumContexts:1];
+
+    NSManagedObjectContext *ctx = [pool checkoutContextWithTimeout:0.0];
+    XCTAssertNotNil(ctx);
+
+    BOOL __block performed = NO;
+    XCTAssertFalse([pool performInContext:^(NSManagedObjectContext *_ctx) {
+        performed = YES;
+    } timeout:0.05]);
+    XCTAssertFalse(performed);
+
+    [pool checkinContext:ctx];
+
+    XCTAssertTrue([pool performInContext:^(NSManagedObjectContext *_ctx) {
+        performed = YES;
+    } timeout:0.05]);
+    XCTAssertTrue(performed);
+}
+
+- (void)testNestedPerformDoesNotWait {
+    MCTObjectContextPool *pool = [[MCTObjectContextPool alloc] initWithPersistentStoreCoordinator:self.store.context.persistentStoreCoordinator maximumContexts:1];
+
+    BOOL __block performed = NO;
+    XCTAssertTrue([pool performInContext:^(NSManagedObjectContext *outer) {
+        XCTAssertTrue([pool performInContext:^(NSManagedObjectContext *inner) {
+            XCTAssertNotEqual(outer, inner);
+            [Person insertIntoContext:inner];
+            performed = YES;
+        } timeout:0.05]);
+    } timeout:0.05]);
+    XCTAssertTrue(performed);
+    XCTAssertEqual([[self.store all:[Person class]] count], 1);
+
+    NSManagedObjectContext *ctx = [pool checkoutContextWithTimeout:0.0];
+    XCTAssertNotNil(ctx);
+    [pool checkinContext:ctx];
+}
+
+- (void)testNestingInAnotherPoolStillWaits {
+    NSPersistentStoreCoordinator *coordinator = self.store.context.persistentStoreCoordinator;
+    MCTObjectContextPool *outerPool = [[MCTObjectContextPool alloc] initWithPersistentStoreCoordinator:coordinator maximumContexts:1];
+    MCTObjectContextPool *innerPool = [[MCTObjectContextPool alloc] initWithPersistentStoreCoordinator:coordinator maximumContexts:1];
+
+    NSManagedObjectContext *ctx = [innerPool checkoutContextWithTimeout:0.0];
+    XCTAssertNotNil(ctx);
+
+    BOOL __block performed = NO;
+    XCTAssertTrue([outerPool performInContext:^(NSManagedObjectContext *outer) {
+        XCTAssertFalse([innerPool performInContext:^(NSManagedObjectContext *inner) {
+            performed = YES;
+        } timeout:0.05]);
+    } timeout:0.05]);
+    XCTAssertFalse(performed);
+
+    [innerPool checkinContext:ctx];
+}
+
+- (void)testDisposableSavesAreVisible {
+    [self.store performInDisposable:^(NSManagedObjectContext *ctx) {
+        Person *person = [Person insertIntoContext:ctx];
+        person.firstName = @"Pooled";
+    }];
+
+    XCTAssertEqual([Person countInContext:self.store.context predicate:[NSPredicate predicateWithFormat:@"firstName == %@",@"Pooled"] error:NULL], 1);
+}
+
+- (void)testParallelImport {
+    MCTObjectStack *stack = [[MCTObjectStack alloc] init];
+    NSManagedObjectModel *model = [MCTObjectContext modelWithName:@"TestModel" bundle:[NSBundle bundleForClass:self.class]];
+    XCTAssertTrue([stack prepareWithModel:model location:nil error:NULL]);
+
+    NSMutableArray *values = [NSMutableArray array];
+    for (NSInteger idx = 0; idx < 2000; idx++) {
+        [values addObject:@{@"remoteID": @(idx % 1000), @"firstName": @"Parallel"}];
+    }
+
+    NSError *error = nil;
+    XCTAssertTrue([stack import:[Person class] values:values uniqueKey:@"remoteID" workers:4 error:&error]);
+    XCTAssertNil(error);
+
+    XCTAssertEqual([Person countInContext:stack.mainObjectContext.context error:NULL], 1000);
+}
+
+@end
@@ -8,6 +8,7 @@
 #import <XCTest/XCTest.h>
 
 #import "Person.h"
+#import "PhoneNumber.h"
 #import "User.h"
 
 @interface MCTObjectContextTests : XCTestCase
@@ -151,4 +152,372 @@
     XCTAssertEqualObjects(person_2.firstName, @"Test 2");
 }
 
+- (void)testImportUpsertsByUniqueKey {
+    Person *existing = [self.store insertNewObject:[Person class]];
+    existing.remoteID = @(2);
+    existing.firstName = @"Old";
+    XCTAssertTrue([self.store save:NULL]);
+
+    NSMutableArray *values = [NSMutableArray array];
+    for (NSInteger idx = 1; idx <= 1200; idx++) {
+        [values addObject:@{@"remoteID": @(idx), @"firstName": [NSString stringWithFormat:@"Person %li",(long)idx]}];
+    }
+    [values addObject:@{@"remoteID": @(3), @"firstName": @"Duplicate"}];
+
+    NSError *error = nil;
+    XCTAssertTrue([self.store import:[Person class] values:values uniqueKey:@"remoteID" batchSize:500 error:&error]);
+    XCTAssertNil(error);
+
+    XCTAssertEqual([Person countInContext:self.store.context error:NULL], 1200);
+
+    NSPredicate *updated = [NSPredicate predicateWithFormat:@"remoteID == %@ AND firstName == %@",@(2),@"Person 2"];
+    XCTAssertEqual([Person countInContext:self.store.context predicate:updated error:NULL], 1);
+
+    NSPredicate *duplicate = [NSPredicate predicateWithFormat:@"remoteID == %@ AND firstName == %@",@(3),@"Duplicate"];
+    XCTAssertEqual([Person countInContext:self.store.context predicate:duplicate error:NULL], 1);
+}
+
+- (void)testImportPlanConvertsAndMapsValues {
+    XCTAssertEqual([MCTObjectContext modelWithName:@"TestModel" bundle:[NSBundle bundleForClass:self.class]], [MCTObjectContext modelWithName:@"TestModel" bundle:[NSBundle bundleForClass:self.class]]);
+
+    [self.store performInContext:^(NSManagedObjectContext *ctx) {
+        Person *person = [Person insertIntoContext:ctx values:@{@"remoteID": @"42", @"firstName": @(7), @"createdAt": @"2015-02-15T12:00:00Z", @"lastName": [NSNull null]}];
+        XCTAssertEqualObjects(person.remoteID, @42);
+        XCTAssertEqualObjects(person.firstName, @"7");
+        XCTAssertEqualObjects(person.createdAt, [NSDate dateWithTimeIntervalSince1970:1424001600]);
+        XCTAssertNil(person.lastName);
+
+        // Values that can't be converted leave the attribute alone.
+        [person importValues:@{@"remoteID": @"forty-two", @"createdAt": @"February 15th"}];
+        XCTAssertEqualObjects(person.remoteID, @42);
+        XCTAssertEqualObjects(person.createdAt, [NSDate dateWithTimeIntervalSince1970:1424001600]);
+
+        XCTAssertThrows([person importValues:@{@"unknown": @"value"}]);
+    }];
+
+    NSArray *values = @[
+                        @{@"id": @"1", @"label": @"Home", @"phone": @"555-0100", @"extra": @YES},
+                        @{@"id": @"2", @"label": @"Work", @"phone": @"555-0101"},
+                        @{@"id": @(1), @"label": @"Mobile"}
+                        ];
+    NSError *error = nil;
+    XCTAssertTrue([self.store import:[PhoneNumber class] values:values uniqueKey:@"id" error:&error], @"%@",error);
+
+    XCTAssertEqual([PhoneNumber countInContext:self.store.context error:NULL], 2);
+    NSPredicate *updated = [NSPredicate predicateWithFormat:@"remoteID == 1 AND name == %@ AND number == %@",@"Mobile",@"555-0100"];
+    XCTAssertEqual([PhoneNumber countInContext:self.store.context predicate:updated error:NULL], 1);
+}
+
+- (void)testBatchUpdateAndDelete {
+    NSString *name = [[[NSUUID UUID] UUIDString] stringByAppendingPathExtension:@"sqlite"];
+    NSURL *URL = [[NSURL fileURLWithPath:NSTemporaryDirectory()] URLByAppendingPathComponent:name];
+
+    MCTObjectContext *store = [[MCTObjectContext alloc] init];
+    XCTAssertTrue([store prepareWithModelName:@"TestModel" bundle:[NSBundle bundleForClass:self.class] storeURL:URL]);
+
+    NSMutableArray *people = [NSMutableArray array];
+    for (NSInteger idx = 0; idx < 10; idx++) {
+        Person *person = [store insertNewObject:[Person class]];
+        person.remoteID = @(idx);
+        person.firstName = @"Person";
+        [people addObject:person];
+    }
+    XCTAssertTrue([store save:NULL]);
+
+    NSError *error = nil;
+    NSArray *updated = [store batchUpdate:[Person class] predicate:[NSPredicate predicateWithFormat:@"remoteID < 5"] values:@{@"firstName": @"Updated"} error:&error];
+    XCTAssertNil(error);
+    XCTAssertEqual(updated.count, 5);
+    XCTAssertEqualObjects([people[0] firstName], @"Updated");
+    XCTAssertEqualObjects([people[9] firstName], @"Person");
+
+    NSArray *deleted = [store batchDelete:[Person class] predicate:[NSPredicate predicateWithFormat:@"remoteID >= 5"] error:&error];
+    XCTAssertNil(error);
+    XCTAssertEqual(deleted.count, 5);
+    XCTAssertEqual([Person countInContext:store.context error:NULL], 5);
+}
+
+- (void)testBatchRequestsRequireSQLite {
+    NSError *error = nil;
+    XCTAssertNil([self.store batchDelete:[Person class] predicate:nil error:&error]);
+    XCTAssertEqual(error.code, MCTObjectStoreErrorUnsupportedStoreType);
+}
+
+- (void)testCoalescedSaves {
+    self.store.coalescesSaves = YES;
+    self.store.saveCoalescingInterval = 0.1;
+
+    NSInteger __block saveCount = 0;
+    id observer = [[NSNotificationCenter defaultCenter] addObserverForName:NSManagedObjectContextDidSaveNotification object:self.store.context queue:nil usingBlock:^(NSNotification *note) {
+        saveCount++;
+    }];
+
+    XCTestExpectation *first = [self expectationWithDescription:@"First save"];
+    XCTestExpectation *second = [self expectationWithDescription:@"Second save"];
+
+    [self.store insertNewObject:[Person class]];
+    [self.store saveWithCompletion:^(BOOL success, NSError *error) {
+        XCTAssertTrue(success);
+        [first fulfill];
+    }];
+
+    [self.store insertNewObject:[Person class]];
+    [self.store saveWithCompletion:^(BOOL success, NSError *error) {
+        XCTAssertTrue(success);
+        [second fulfill];
+    }];
+
+    [self waitForExpectationsWithTimeout:2.0 handler:nil];
+
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+
+    XCTAssertEqual(saveCount, 1);
+    XCTAssertFalse([self.store.context hasChanges]);
+}
+
+- (void)testMergeLimitedToEntityNames {
+    Person *person = [self.store insertNewObject:[Person class]];
+    person.firstName = @"Before";
+    XCTAssertTrue([self.store save:NULL]);
+
+    MCTObjectContext *reader = [self.store newObjectContextWithType:NSPrivateQueueConcurrencyType error:NULL];
+    reader.mergeEntityNames = [NSSet setWithObject:[PhoneNumber entityName]];
+
+    NSManagedObjectID *personID = person.objectID;
+    NSManagedObject __block *readerPerson = nil;
+    [reader performInContext:^(NSManagedObjectContext *ctx) {
+        readerPerson = [ctx existingObjectWithID:personID error:NULL];
+        XCTAssertEqualObjects([readerPerson valueForKey:@"firstName"], @"Before");
+    }];
+
+    person.firstName = @"After";
+    XCTAssertTrue([self.store save:NULL]);
+
+    [reader performInContext:^(NSManagedObjectContext *ctx) {
+        XCTAssertEqualObjects([readerPerson valueForKey:@"firstName"], @"Before");
+    }];
+
+    reader.mergeEntityNames = nil;
+
+    person.firstName = @"Again";
+    XCTAssertTrue([self.store save:NULL]);
+
+    [reader performInContext:^(NSManagedObjectContext *ctx) {
+        XCTAssertEqualObjects([readerPerson valueForKey:@"firstName"], @"Again");
+    }];
+}
+
+- (void)testFetchResultCache {
+    self.store.cachesFetchResults = YES;
+
+    for (NSString *name in @[@"Ann", @"Bob"]) {
+        Person *person = [self.store insertNewObject:[Person class]];
+        person.firstName = name;
+    }
+    XCTAssertTrue([self.store save:NULL]);
+
+    NSPredicate *predicate = [NSPredicate predicateWithFormat:@"firstName != nil"];
+    NSArray *sort = @[[NSSortDescriptor sortDescriptorWithKey:@"firstName" ascending:YES]];
+
+    XCTAssertEqual([[self.store all:[Person class] predicate:predicate sortDescriptors:sort] count], 2);
+    XCTAssertEqualObjects([[self.store all:[Person class] predicate:predicate sortDescriptors:sort] valueForKey:@"firstName"], (@[@"Ann", @"Bob"]));
+    XCTAssertEqual(self.store.fetchResultCacheMissCount, 1);
+    XCTAssertEqual(self.store.fetchResultCacheHitCount, 1);
+
+    // Unrelated entities don't invalidate the result.
+    [self.store performInDisposable:^(NSManagedObjectContext *ctx) {
+        [PhoneNumber insertIntoContext:ctx values:@{@"name": @"Home"}];
+    }];
+    XCTAssertEqual([[self.store all:[Person class] predicate:predicate sortDescriptors:sort] count], 2);
+    XCTAssertEqual(self.store.fetchResultCacheHitCount, 2);
+
+    // Saves from other contexts do.
+    [self.store performInDisposable:^(NSManagedObjectContext *ctx) {
+        [Person insertIntoContext:ctx values:@{@"firstName": @"Cat"}];
+    }];
+    XCTAssertEqual([[self.store all:[Person class] predicate:predicate sortDescriptors:sort] count], 3);
+    XCTAssertEqual(self.store.fetchResultCacheMissCount, 2);
+
+    // So do unsaved changes in the context.
+    Person *person = [self.store insertNewObject:[Person class]];
+    person.firstName = @"Dan";
+    XCTAssertEqual([[self.store all:[Person class] predicate:predicate sortDescriptors:sort] count], 4);
+    XCTAssertEqual(self.store.fetchResultCacheMissCount, 3);
+
+    XCTAssertTrue([self.store save:NULL]);
+    [self.store all:[Person class] predicate:predicate sortDescriptors:sort bypassCache:YES error:NULL];
+    XCTAssertEqual(self.store.fetchResultCacheHitCount + self.store.fetchResultCacheMissCount, 5);
+}
+
+- (void)testCachedPredicateTemplates {
+    NSArray *names = @[@"Ann", @"Bob"];
+    NSPredicate *expected = [NSPredicate predicateWithFormat:@"%K == %@ AND remoteID > %d AND firstName IN %@ AND email != 'a%@b'", @"lastName", @"Smith", 4, names];
+    for (NSUInteger idx = 0; idx < 2; idx++) {
+        NSPredicate *predicate = [NSPredicate mct_cachedPredicateWithFormat:@"%K == %@ AND remoteID > %d AND firstName IN %@ AND email != 'a%@b'", @"lastName", @"Smith", 4, names];
+        XCTAssertEqualObjects(predicate.predicateFormat, expected.predicateFormat);
+    }
+
+    NSPredicate *other = [NSPredicate mct_cachedPredicateWithFormat:@"%K == %@ AND remoteID > %d AND firstName IN %@ AND email != 'a%@b'", @"firstName", @"Jones", 7, names];
+    XCTAssertEqualObjects(other.predicateFormat, ([NSPredicate predicateWithFormat:@"%K == %@ AND remoteID > %d AND firstName IN %@ AND email != 'a%@b'", @"firstName", @"Jones", 7, names].predicateFormat));
+
+    NSPredicate *nilValue = [NSPredicate mct_cachedPredicateWithFormat:@"email == %@", nil];
+    XCTAssertEqualObjects(nilValue.predicateFormat, [NSPredicate predicateWithFormat:@"email == nil"].predicateFormat);
+
+    NSFetchRequest *fetchRequest = [NSFetchRequest fetchRequestWithEntityName:[Person entityName]];
+    [fetchRequest appendAndPredicateWithFormat:@"firstName == %@", @"A"];
+    [fetchRequest appendAndPredicateWithFormat:@"lastName == %@", @"B"];
+    [fetchRequest appendAndPredicateWithFormat:@"remoteID == %d", 3];
+    [fetchRequest appendOrPredicateWithFormat:@"email == %@", @"C"];
+
+    NSCompoundPredicate *predicate = (NSCompoundPredicate *)fetchRequest.predicate;
+    XCTAssertEqual(predicate.compoundPredicateType, NSOrPredicateType);
+    XCTAssertEqual(predicate.subpredicates.count, 2);
+    NSCompoundPredicate *conjunction = predicate.subpredicates.firstObject;
+    XCTAssertEqual(conjunction.compoundPredicateType, NSAndPredicateType);
+    XCTAssertEqual(conjunction.subpredicates.count, 3);
+}
+
+- (void)testAttributeIndex {
+    [self.store indexAttribute:@"remoteID" ofClass:[Person class]];
+
+    Person *person = [self.store insertNewObject:[Person class]];
+    person.remoteID = @1;
+    [self.store.context processPendingChanges];
+
+    XCTAssertEqual([self.store objectOfClass:[Person class] withValue:@1 forKey:@"remoteID"], person);
+    XCTAssertTrue([self.store save:NULL]);
+    XCTAssertEqual([self.store objectOfClass:[Person class] withValue:@1 forKey:@"remoteID"], person);
+
+    person.remoteID = @2;
+    [self.store.context processPendingChanges];
+    XCTAssertNil([self.store objectOfClass:[Person class] withValue:@1 forKey:@"remoteID"]);
+    XCTAssertEqual([self.store objectOfClass:[Person class] withValue:@2 forKey:@"remoteID"], person);
+    XCTAssertTrue([self.store save:NULL]);
+
+    // Objects inserted elsewhere are found with a fetch.
+    [self.store performInDisposable:^(NSManagedObjectContext *ctx) {
+        [Person insertIntoContext:ctx values:@{@"remoteID": @3, @"firstName": @"Elsewhere"}];
+    }];
+    Person *other = [self.store objectOfClass:[Person class] withValue:@3 forKey:@"remoteID"];
+    XCTAssertEqualObjects(other.firstName, @"Elsewhere");
+
+    [person destroy];
+    [self.store.context processPendingChanges];
+    XCTAssertNil([self.store objectOfClass:[Person class] withValue:@2 forKey:@"remoteID"]);
+
+    [self.store.context reset];
+    XCTAssertEqualObjects([[self.store objectOfClass:[Person class] withValue:@3 forKey:@"remoteID"] firstName], @"Elsewhere");
+}
+
+- (void)testEnumerationWalksEveryObjectOnce {
+    for (NSInteger idx = 0; idx < 25; idx++) {
+        Person *person = [self.store insertNewObject:[Person class]];
+        person.remoteID = (idx < 20) ? @(idx % 10) : nil;
+        person.firstName = [NSString stringWithFormat:@"%li",(long)idx];
+    }
+    XCTAssertTrue([self.store save:NULL]);
+
+    NSMutableSet *names = [NSMutableSet set];
+    NSNumber __block *previous = nil;
+    NSError *error = nil;
+    BOOL success = [self.store enumerate:[Person class] predicate:nil sortKey:@"remoteID" ascending:YES batchSize:4 error:&error usingBlock:^(Person *person, BOOL *stop) {
+        XCTAssertFalse([names containsObject:person.firstName]);
+        [names addObject:person.firstName];
+        if (previous && person.remoteID) {
+            XCTAssertTrue([previous compare:person.remoteID] != NSOrderedDescending);
+        }
+        if (!person.remoteID) {
+            XCTAssertGreaterThan(names.count, 20);
+        }
+        previous = person.remoteID;
+    }];
+    XCTAssertTrue(success);
+    XCTAssertNil(error);
+    XCTAssertEqual(names.count, 25);
+
+    NSInteger __block count = 0;
+    XCTAssertTrue([self.store enumerate:[Person class] predicate:nil sortKey:@"remoteID" ascending:NO batchSize:4 error:NULL usingBlock:^(Person *person, BOOL *stop) {
+        count++;
+        *stop = (count == 6);
+    }]);
+    XCTAssertEqual(count, 6);
+}
+
+- (void)testProjectionAndAggregates {
+    NSString *name = [[[NSUUID UUID] UUIDString] stringByAppendingPathExtension:@"sqlite"];
+    NSURL *URL = [[NSURL fileURLWithPath:NSTemporaryDirectory()] URLByAppendingPathComponent:name];
+
+    MCTObjectContext *store = [[MCTObjectContext alloc] init];
+    XCTAssertTrue([store prepareWithModelName:@"TestModel" bundle:[NSBundle bundleForClass:self.class] storeURL:URL]);
+
+    for (NSInteger idx = 1; idx <= 6; idx++) {
+        Person *person = [store insertNewObject:[Person class]];
+        person.remoteID = @(idx);
+        person.lastName = (idx % 2 == 0) ? @"Even" : @"Odd";
+    }
+    XCTAssertTrue([store save:NULL]);
+
+    NSError *error = nil;
+    NSArray *names = [store values:[Person class] properties:@[@"lastName"] predicate:nil sortDescriptors:@[[NSSortDescriptor sortDescriptorWithKey:@"lastName" ascending:YES]] distinct:YES error:&error];
+    XCTAssertNil(error);
+    XCTAssertEqualObjects([names valueForKey:@"lastName"], (@[@"Even", @"Odd"]));
+
+    XCTAssertEqualObjects([store aggregate:[Person class] function:MCTObjectAggregateFunctionMaximum key:@"remoteID" predicate:nil error:NULL], @(6));
+    XCTAssertEqualObjects([store aggregate:[Person class] function:MCTObjectAggregateFunctionSum key:@"remoteID" predicate:nil error:NULL], @(21));
+
+    NSArray *groups = [store aggregate:[Person class] function:MCTObjectAggregateFunctionSum key:@"remoteID" groupBy:@[@"lastName"] predicate:nil error:&error];
+    XCTAssertNil(error);
+    XCTAssertEqual(groups.count, 2);
+    for (NSDictionary *group in groups) {
+        NSNumber *expected = ([group[@"lastName"] isEqualToString:@"Even"]) ? @(12) : @(9);
+        XCTAssertEqualObjects(group[MCTObjectAggregateResultKey], expected);
+    }
+}
+
+- (void)testWorkingSetTrimsLeastRecentlyUsed {
+    for (NSInteger idx = 1; idx <= 20; idx++) {
+        Person *person = [self.store insertNewObject:[Person class]];
+        person.remoteID = @(idx);
+    }
+    XCTAssertTrue([self.store save:NULL]);
+
+    MCTWorkingSet *workingSet = [[MCTWorkingSet alloc] initWithMaximumObjectCount:8 maximumCost:0];
+    workingSet.trimRatio = 0.5;
+    self.store.workingSet = workingSet;
+    XCTAssertEqual(workingSet.context, self.store.context);
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Retains"];
+    [self.store.context performBlock:^{
+        // Faults have to be released for the working set to bound memory.
+        XCTAssertFalse(self.store.context.retainsRegisteredObjects);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:2.0 handler:nil];
+
+    NSArray *people = [self.store all:[Person class] predicate:nil sortDescriptors:@[[NSSortDescriptor sortDescriptorWithKey:@"remoteID" ascending:YES]]];
+    XCTAssertEqual(people.count, 20);
+    for (Person *person in people) {
+        [person willAccessValueForKey:nil];
+    }
+    Person *recent = [self.store objectOfClass:[Person class] withValue:@(1) forKey:@"remoteID"];
+    XCTAssertNotNil(recent);
+
+    MCTWorkingSetReclaim reclaim = [workingSet trim];
+    XCTAssertEqual(reclaim.objectCount, 16);
+    XCTAssertGreaterThan(reclaim.cost, 0);
+    XCTAssertEqual(workingSet.reclaimedObjectCount, 16);
+    XCTAssertFalse(recent.isFault);
+    XCTAssertEqual([[people filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"isFault == YES"]] count], 16);
+
+    XCTAssertEqual([workingSet trim].objectCount, 0);
+
+    recent.firstName = @"Changed";
+    reclaim = [workingSet trimAll];
+    XCTAssertEqual(reclaim.objectCount, 3);
+    XCTAssertFalse(recent.isFault);
+    XCTAssertEqualObjects(recent.firstName, @"Changed");
+
+    self.store.workingSet = nil;
+    XCTAssertNil(workingSet.context);
+}
+
 @end
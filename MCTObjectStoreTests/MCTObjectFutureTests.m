@@ -0,0 +1,106 @@
+/*!
+ * MCTObjectFutureTests.m
+ * MCTObjectStore
+ *
+ * Created by Skylar Schipper on 10/17/26
+ */
+
+#import <XCTest/XCTest.h>
+#import <MCTObjectStore/MCTObjectStore.h>
+
+#import "Person.h"
+
+@interface MCTObjectFutureTests : XCTestCase
+
+@property (nonatomic, strong) MCTObjectContext *store;
+
+@end
+
+@implementation MCTObjectFutureTests
+
+- (void)setUp {
+    [super setUp];
+    self.store = [[MCTObjectContext alloc] init];
+
+    XCTAssertTrue([self.store prepareWithModelName:@"TestModel" bundle:[NSBundle bundleForClass:self.class] storeURL:nil]);
+}
+
+// MARK: - Tests
+- (void)testFetchReturnsObjectIDs {
+    Person *person = [self.store insertNewObject:[Person class]];
+    person.firstName = @"Future";
+    XCTAssertTrue([self.store save:NULL]);
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Fetch"];
+    [[self.store futureAll:[Person class] predicate:nil sortDescriptors:nil] onComplete:^(NSArray<NSManagedObjectID *> *result, NSError *error) {
+        XCTAssertTrue([NSThread isMainThread]);
+        XCTAssertNil(error);
+        XCTAssertEqual(result.count, 1);
+        XCTAssertTrue([[result firstObject] isKindOfClass:[NSManagedObjectID class]]);
+        XCTAssertEqualObjects([result firstObject], person.objectID);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:2.0 handler:nil];
+}
+
+- (void)testChainedInsertAndSave {
+    MCTObjectContext *private = [self.store newObjectContextWithType:NSPrivateQueueConcurrencyType error:NULL];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Insert & save"];
+    [[[private futureInsertNewObject:[Person class]] then:^MCTObjectFuture *(NSManagedObjectID *objectID) {
+        XCTAssertFalse(objectID.isTemporaryID);
+        return [private futureSave];
+    }] onComplete:^(NSNumber *result, NSError *error) {
+        XCTAssertNil(error);
+        XCTAssertTrue([result boolValue]);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:2.0 handler:nil];
+
+    XCTAssertEqual([Person countInContext:self.store.context error:NULL], 1);
+}
+
+- (void)testCancelledWorkDoesNotRun {
+    MCTObjectContext *private = [self.store newObjectContextWithType:NSPrivateQueueConcurrencyType error:NULL];
+
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [private performAsyncInContext:^(NSManagedObjectContext *ctx) {
+        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    }];
+
+    BOOL __block performed = NO;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Cancel"];
+    MCTObjectFuture *future = [private futureInContext:^(NSManagedObjectContext *ctx) {
+        performed = YES;
+    }];
+    [future onComplete:^(id result, NSError *error) {
+        XCTAssertEqual(error.code, MCTObjectStoreErrorCancelled);
+        [expectation fulfill];
+    }];
+    [future cancel];
+    dispatch_semaphore_signal(semaphore);
+
+    [self waitForExpectationsWithTimeout:2.0 handler:nil];
+
+    [private performInContext:^(NSManagedObjectContext *ctx) {}];
+    XCTAssertFalse(performed);
+    XCTAssertTrue([future isCancelled]);
+}
+
+- (void)testCancellingChainedFutureCancelsUpstream {
+    MCTObjectFuture *upstream = [[MCTObjectFuture alloc] initWithQueue:nil qualityOfService:NSQualityOfServiceDefault];
+    MCTObjectFuture *mapped = [upstream map:^id(id result) {
+        return result;
+    }];
+    MCTObjectFuture *chained = [mapped then:^MCTObjectFuture *(id result) {
+        return nil;
+    }];
+
+    [chained cancel];
+
+    XCTAssertTrue([chained isCancelled]);
+    XCTAssertTrue([mapped isCancelled]);
+    XCTAssertTrue([upstream isCancelled]);
+}
+
+@end
@@ -0,0 +1,86 @@
+/*!
+ * MCTObjectMetricsTests.m
+ * MCTObjectStore
+ *
+ * Created by Skylar Schipper on 10/17/26
+ */
+
+#import <XCTest/XCTest.h>
+#import <MCTObjectStore/MCTObjectStore.h>
+
+#import "Person.h"
+
+@interface MCTObjectMetricsTests : XCTestCase <MCTObjectMetricsObserver>
+
+@property (nonatomic, strong) MCTObjectContext *store;
+@property (nonatomic, strong) MCTObjectMetrics *metrics;
+@property (nonatomic, strong) XCTestExpectation *snapshotExpectation;
+@property (nonatomic, strong) MCTObjectMetricsSnapshot *observedSnapshot;
+
+@end
+
+@implementation MCTObjectMetricsTests
+
+- (void)setUp {
+    [super setUp];
+    self.metrics = [[MCTObjectMetrics alloc] init];
+    self.metrics.snapshotInterval = 0.0;
+
+    self.store = [[MCTObjectContext alloc] init];
+    self.store.metrics = self.metrics;
+
+    XCTAssertTrue([self.store prepareWithModelName:@"TestModel" bundle:[NSBundle bundleForClass:self.class] storeURL:nil]);
+}
+
+// MARK: - Observer
+- (void)metrics:(MCTObjectMetrics *)metrics didCaptureSnapshot:(MCTObjectMetricsSnapshot *)snapshot {
+    self.observedSnapshot = snapshot;
+    [self.snapshotExpectation fulfill];
+}
+
+// MARK: - Tests
+- (void)testRecordsContextOperations {
+    [self.store insertNewObject:[Person class]];
+    [self.store insertNewObject:[Person class]];
+    XCTAssertTrue([self.store save:NULL]);
+    XCTAssertEqual([[self.store all:[Person class]] count], 2);
+
+    MCTObjectMetricsSnapshot *snapshot = [self.metrics snapshot];
+    XCTAssertGreaterThanOrEqual([snapshot durationsForOperation:MCTObjectMetricsOperationPerform].count, 4);
+    XCTAssertEqual([snapshot durationsForOperation:MCTObjectMetricsOperationSave].count, 1);
+    XCTAssertEqual([snapshot sizesForOperation:MCTObjectMetricsOperationSave].maximum, 2);
+    XCTAssertEqual([snapshot durationsForOperation:MCTObjectMetricsOperationFetch].count, 1);
+    XCTAssertEqual([snapshot sizesForOperation:MCTObjectMetricsOperationFetch].total, 2);
+    XCTAssertGreaterThanOrEqual(snapshot.maximumQueueDepth, 1);
+
+    MCTObjectContext *child = [self.store newObjectContextWithType:NSPrivateQueueConcurrencyType error:NULL];
+    XCTAssertEqual(child.metrics, self.metrics);
+}
+
+- (void)testCaptureResetsAndNotifiesObservers {
+    [self.metrics addObserver:self];
+    [self.metrics recordOperation:MCTObjectMetricsOperationMerge waitTime:10 duration:100 size:3];
+
+    self.snapshotExpectation = [self expectationWithDescription:@"Snapshot"];
+    MCTObjectMetricsSnapshot *snapshot = [self.metrics captureSnapshot];
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+
+    XCTAssertEqual(self.observedSnapshot, snapshot);
+    XCTAssertEqual([snapshot durationsForOperation:MCTObjectMetricsOperationMerge].count, 1);
+    XCTAssertEqual([[self.metrics snapshot] durationsForOperation:MCTObjectMetricsOperationMerge].count, 0);
+}
+
+- (void)testHistogramPercentiles {
+    for (uint64_t value = 1; value <= 100; value++) {
+        [self.metrics recordOperation:MCTObjectMetricsOperationFetch waitTime:0 duration:value size:0];
+    }
+    MCTObjectMetricsHistogram *histogram = [[self.metrics snapshot] durationsForOperation:MCTObjectMetricsOperationFetch];
+    XCTAssertEqual(histogram.count, 100);
+    XCTAssertEqual(histogram.minimum, 1);
+    XCTAssertEqual(histogram.maximum, 100);
+    XCTAssertEqualWithAccuracy(histogram.mean, 50.5, 0.001);
+    XCTAssertEqual([histogram valueAtPercentile:0.5], 63);
+    XCTAssertEqual([histogram valueAtPercentile:1.0], 100);
+}
+
+@end
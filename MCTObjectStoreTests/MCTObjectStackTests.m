@@ -0,0 +1,327 @@
+/*!
+ * MCTObjectStackTests.m
+ * MCTObjectStore
+ *
+ * Created by Skylar Schipper on 10/17/26
+ */
+
+#import <XCTest/XCTest.h>
+#import <MCTObjectStore/MCTObjectStore.h>
+
+#import "Person.h"
+#import "User.h"
+
+@interface MCTObjectStackTests : XCTestCase
+
+@property (nonatomic, strong) NSURL *location;
+
+@end
+
+@implementation MCTObjectStackTests
+
+- (void)setUp {
+    [super setUp];
+    NSURL *directory = [[NSURL fileURLWithPath:NSTemporaryDirectory()] URLByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    [[NSFileManager defaultManager] createDirectoryAtURL:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+    self.location = [directory URLByAppendingPathComponent:@"Test.sqlite"];
+}
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtURL:[self.location URLByDeletingLastPathComponent] error:NULL];
+    [super tearDown];
+}
+
+// MARK: - Tests
+- (void)testAsyncPrepare {
+    MCTObjectStack *stack = [[MCTObjectStack alloc] init];
+
+    NSMutableArray *order = [NSMutableArray array];
+    [stack performWhenReady:^(MCTObjectStack *_stack) {
+        XCTAssertTrue([NSThread isMainThread]);
+        XCTAssertTrue([_stack isReady]);
+        [order addObject:@"ready"];
+    }];
+
+    [self expectationForNotification:MCTObjectStackDidBecomeReadyNotification object:stack handler:nil];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Prepare"];
+    NSProgress *progress = [stack prepareModelWithName:@"TestModel" bundle:[NSBundle bundleForClass:self.class] location:self.location completion:^(BOOL success, NSError *error) {
+        XCTAssertTrue(success);
+        XCTAssertNil(error);
+        [order addObject:@"completion"];
+        // The stack is ready but the waiting block hasn't run, this one goes after it.
+        [stack performWhenReady:^(MCTObjectStack *_stack) {
+            [order addObject:@"queued"];
+            [expectation fulfill];
+        }];
+    }];
+    XCTAssertFalse([stack isReady]);
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertEqualObjects(order, (@[@"completion", @"ready", @"queued"]));
+    XCTAssertEqual(progress.fractionCompleted, 1.0);
+    XCTAssertTrue([stack isReady]);
+
+    BOOL __block performed = NO;
+    [stack performWhenReady:^(MCTObjectStack *_stack) {
+        performed = YES;
+    }];
+    XCTAssertTrue(performed);
+
+    [stack performInMainContext:^(NSManagedObjectContext *ctx) {
+        [Person insertIntoContext:ctx];
+    }];
+    XCTAssertTrue([stack save:NULL]);
+}
+
+- (void)testAsyncPrepareMissingModel {
+    MCTObjectStack *stack = [[MCTObjectStack alloc] init];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Prepare"];
+    [stack prepareModelWithName:@"Missing" bundle:[NSBundle bundleForClass:self.class] location:self.location completion:^(BOOL success, NSError *error) {
+        XCTAssertFalse(success);
+        XCTAssertEqual(error.code, MCTObjectStoreErrorModelNotFound);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    XCTAssertFalse([stack isReady]);
+}
+
+- (void)testStoreConfiguration {
+    MCTStoreConfiguration *configuration = [MCTStoreConfiguration writeHeavyConfiguration];
+    configuration.mmapSize = 0;
+    XCTAssertEqualObjects([configuration pragmas], (@{@"journal_mode": @"WAL", @"synchronous": @"NORMAL", @"cache_size": @"-8192", @"mmap_size": @"0"}));
+    XCTAssertNil([configuration persistentStoreOptionsForStoreType:NSInMemoryStoreType][NSSQLitePragmasOption]);
+    XCTAssertEqualObjects([[MCTStoreConfiguration defaultConfiguration] persistentStoreOptionsForStoreType:NSSQLiteStoreType], [MCTObjectContext defaultPersistentStoreOptions]);
+
+    MCTObjectStack *stack = [[MCTObjectStack alloc] init];
+    stack.configuration = configuration;
+    XCTAssertTrue([stack prepareModelWithName:@"TestModel" bundle:[NSBundle bundleForClass:self.class] location:self.location error:NULL]);
+
+    NSPersistentStore *store = [stack.mainObjectContext.context.persistentStoreCoordinator.persistentStores firstObject];
+    XCTAssertEqualObjects(store.options[NSSQLitePragmasOption][@"synchronous"], @"NORMAL");
+
+    [stack performInMainContext:^(NSManagedObjectContext *ctx) {
+        Person *person = [Person insertIntoContext:ctx];
+        person.firstName = @"Tuned";
+    }];
+
+    NSError *error = nil;
+    XCTAssertFalse([stack checkpointPersistentStores:&error]);
+    XCTAssertEqual(error.code, MCTObjectStoreErrorUnsavedChanges);
+
+    XCTAssertTrue([stack save:NULL]);
+    XCTAssertTrue([stack checkpointPersistentStores:&error], @"%@",error);
+    XCTAssertTrue([stack vacuumPersistentStores:&error], @"%@",error);
+
+    store = [stack.mainObjectContext.context.persistentStoreCoordinator.persistentStores firstObject];
+    XCTAssertEqualObjects(store.options[NSSQLitePragmasOption][@"journal_mode"], @"WAL");
+    XCTAssertNil(store.options[NSSQLiteManualVacuumOption]);
+    XCTAssertEqual([Person countInContext:stack.mainObjectContext.context predicate:[NSPredicate predicateWithFormat:@"firstName == %@",@"Tuned"] error:NULL], 1);
+}
+
+- (void)testShards {
+    NSBundle *bundle = [NSBundle bundleForClass:self.class];
+    NSManagedObjectModel *model = [NSManagedObjectModel modelByMergingModels:@[[MCTObjectContext modelWithName:@"TestModel" bundle:bundle], [MCTObjectContext modelWithName:@"TestModel_2" bundle:bundle]]];
+    NSDictionary *entities = model.entitiesByName;
+    [model setEntities:@[entities[@"Person"], entities[@"PhoneNumber"]] forConfigurationName:@"People"];
+    [model setEntities:@[entities[@"User"]] forConfigurationName:@"Users"];
+
+    NSURL *directory = [self.location URLByDeletingLastPathComponent];
+    NSURL *users = [directory URLByAppendingPathComponent:@"Users.sqlite"];
+
+    MCTObjectStack *stack = [[MCTObjectStack alloc] init];
+    stack.shards = @[
+                     [MCTStoreShard shardWithConfigurationName:@"People" location:[directory URLByAppendingPathComponent:@"People.sqlite"]],
+                     [MCTStoreShard shardWithConfigurationName:@"Users" location:users]
+                     ];
+    NSError *error = nil;
+    XCTAssertTrue([stack prepareWithModel:model location:nil error:&error], @"%@",error);
+    XCTAssertEqual(stack.mainObjectContext.context.persistentStoreCoordinator.persistentStores.count, 2);
+    XCTAssertEqualObjects([[stack affectedStoresForClass:[Person class]] valueForKey:@"configurationName"], @[@"People"]);
+    XCTAssertEqualObjects([[stack affectedStoresForClass:[User class]] valueForKey:@"configurationName"], @[@"Users"]);
+
+    [stack performInMainContext:^(NSManagedObjectContext *ctx) {
+        Person *person = [Person insertIntoContext:ctx];
+        person.firstName = @"Sharded";
+        User *user = [User insertIntoContext:ctx];
+        [user setValue:@"1" forKey:@"localID"];
+    }];
+    XCTAssertTrue([stack save:&error], @"%@",error);
+
+    [self expectationForNotification:MCTObjectStackDidDestroyStoreNotification object:stack handler:^BOOL(NSNotification *notification) {
+        return [notification.userInfo[MCTObjectStackDestroyedStoreURLKey] isEqual:users];
+    }];
+    XCTAssertTrue([stack destroyStoreAtLocation:users type:NSSQLiteStoreType error:&error], @"%@",error);
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+
+    XCTAssertTrue([stack isReady]);
+    XCTAssertEqual(stack.mainObjectContext.context.persistentStoreCoordinator.persistentStores.count, 2);
+    XCTAssertEqual([[stack.mainObjectContext all:[User class]] count], 0);
+    XCTAssertEqual([[stack.mainObjectContext all:[Person class] where:@"firstName == %@",@"Sharded"] count], 1);
+}
+
+- (void)testAffectedStoresIncludeSubentities {
+    NSEntityDescription *child = [[NSEntityDescription alloc] init];
+    child.name = @"Child";
+    NSEntityDescription *parent = [[NSEntityDescription alloc] init];
+    parent.name = @"Parent";
+    parent.subentities = @[child];
+
+    NSManagedObjectModel *model = [[NSManagedObjectModel alloc] init];
+    model.entities = @[parent, child];
+    [model setEntities:@[parent] forConfigurationName:@"Parents"];
+    [model setEntities:@[child] forConfigurationName:@"Children"];
+
+    NSPersistentStoreCoordinator *coordinator = [[NSPersistentStoreCoordinator alloc] initWithManagedObjectModel:model];
+    XCTAssertNotNil([coordinator addPersistentStoreWithType:NSInMemoryStoreType configuration:@"Parents" URL:nil options:nil error:NULL]);
+    XCTAssertNotNil([coordinator addPersistentStoreWithType:NSInMemoryStoreType configuration:@"Children" URL:nil options:nil error:NULL]);
+
+    XCTAssertNil([coordinator mct_affectedStoresForEntityName:@"Parent"]);
+    XCTAssertEqualObjects([[coordinator mct_affectedStoresForEntityName:@"Child"] valueForKey:@"configurationName"], @[@"Children"]);
+}
+
+- (void)testReaderPool {
+    MCTObjectStack *stack = [[MCTObjectStack alloc] init];
+    XCTAssertTrue([stack prepareModelWithName:@"TestModel" bundle:[NSBundle bundleForClass:self.class] location:self.location error:NULL]);
+    NSPersistentStoreCoordinator *psc = stack.mainObjectContext.context.persistentStoreCoordinator;
+
+    [stack performInMainContext:^(NSManagedObjectContext *ctx) {
+        [Person insertIntoContext:ctx];
+    }];
+    XCTAssertTrue([stack save:NULL]);
+
+    [stack performInReader:^(NSManagedObjectContext *ctx) {
+        XCTAssertNotEqual(ctx.persistentStoreCoordinator, psc);
+        XCTAssertEqual([Person countInContext:ctx error:NULL], 1);
+        [Person insertIntoContext:ctx];
+    }];
+    [stack performInReader:^(NSManagedObjectContext *ctx) {
+        XCTAssertFalse([ctx hasChanges]);
+    }];
+
+    NSManagedObjectContext *snapshot = [stack.readerPool checkoutSnapshotContextWithTimeout:1.0 error:NULL];
+    XCTAssertNotNil(snapshot);
+    [snapshot performBlockAndWait:^{
+        XCTAssertEqual([[snapshot executeFetchRequest:[NSFetchRequest fetchRequestWithEntityName:[Person entityName]] error:NULL] count], 1);
+    }];
+
+    [stack performInMainContext:^(NSManagedObjectContext *ctx) {
+        [Person insertIntoContext:ctx];
+    }];
+    XCTAssertTrue([stack save:NULL]);
+
+    [snapshot performBlockAndWait:^{
+        XCTAssertEqual([[snapshot executeFetchRequest:[NSFetchRequest fetchRequestWithEntityName:[Person entityName]] error:NULL] count], 1);
+    }];
+    [stack.readerPool checkinContext:snapshot];
+
+    [stack performInReader:^(NSManagedObjectContext *ctx) {
+        XCTAssertNil(ctx.queryGenerationToken);
+        XCTAssertEqual([Person countInContext:ctx error:NULL], 2);
+    }];
+}
+
+- (void)testPersistentHistory {
+    MCTStoreConfiguration *configuration = [MCTStoreConfiguration defaultConfiguration];
+    configuration.tracksPersistentHistory = YES;
+
+    MCTObjectStack *stack = [[MCTObjectStack alloc] init];
+    stack.configuration = configuration;
+    XCTAssertTrue([stack prepareModelWithName:@"TestModel" bundle:[NSBundle bundleForClass:self.class] location:self.location error:NULL]);
+
+    Person __block *person = nil;
+    [stack performInMainContext:^(NSManagedObjectContext *ctx) {
+        person = [Person insertIntoContext:ctx];
+        person.firstName = @"Before";
+    }];
+    XCTAssertTrue([stack save:NULL]);
+
+    // Another coordinator on the same file, like an app extension.
+    MCTObjectContext *other = [[MCTObjectContext alloc] init];
+    XCTAssertTrue([other prepareWithModel:stack.mainObjectContext.context.persistentStoreCoordinator.managedObjectModel storeURL:self.location persistentStoreType:nil configuration:configuration contextType:NSPrivateQueueConcurrencyType error:NULL]);
+    NSManagedObjectID *objectID = person.objectID;
+    [other performInContext:^(NSManagedObjectContext *ctx) {
+        ctx.transactionAuthor = @"Extension";
+        [[ctx existingObjectWithID:objectID error:NULL] setValue:@"After" forKey:@"firstName"];
+    }];
+    XCTAssertTrue([other save:NULL]);
+    XCTAssertEqualObjects(person.firstName, @"Before");
+
+    NSError *error = nil;
+    XCTAssertTrue([stack mergeHistoryForConsumer:@"UI" error:&error], @"%@",error);
+    XCTAssertEqualObjects(person.firstName, @"After");
+
+    NSMutableArray *authors = [NSMutableArray array];
+    XCTAssertTrue([stack processHistoryForConsumer:@"Sync" error:&error usingBlock:^BOOL(NSArray<NSPersistentHistoryTransaction *> *transactions) {
+        [authors addObjectsFromArray:[transactions valueForKey:@"author"]];
+        return YES;
+    }], @"%@",error);
+    XCTAssertEqualObjects(authors, (@[stack.historyAuthor, @"Extension"]));
+
+    BOOL __block called = NO;
+    XCTAssertTrue([stack processHistoryForConsumer:@"Sync" error:&error usingBlock:^BOOL(NSArray<NSPersistentHistoryTransaction *> *transactions) {
+        called = YES;
+        return YES;
+    }]);
+    XCTAssertFalse(called);
+
+    // Pooled saves are the stack's own.
+    [stack performInDisposable:^(NSManagedObjectContext *ctx) {
+        [Person insertIntoContext:ctx];
+    }];
+    [authors removeAllObjects];
+    XCTAssertTrue([stack processHistoryForConsumer:@"Sync" error:&error usingBlock:^BOOL(NSArray<NSPersistentHistoryTransaction *> *transactions) {
+        [authors addObjectsFromArray:[transactions valueForKey:@"author"]];
+        return YES;
+    }], @"%@",error);
+    XCTAssertEqualObjects(authors, (@[stack.historyAuthor]));
+
+    XCTAssertTrue([stack pruneHistory:&error], @"%@",error);
+}
+
+- (void)testWriterTopology {
+    MCTObjectStack *stack = [[MCTObjectStack alloc] init];
+    stack.topology = MCTObjectStackTopologyWriter;
+    XCTAssertTrue([stack prepareModelWithName:@"TestModel" bundle:[NSBundle bundleForClass:self.class] location:self.location error:NULL]);
+    MCTObjectContext *writer = stack.writerObjectContext;
+    XCTAssertNotNil(writer);
+    XCTAssertEqual(stack.mainObjectContext.parentObjectContext, writer);
+    XCTAssertEqual(stack.privateObjectContext.context.parentContext, writer.context);
+
+    [stack performInPrivateContext:^(NSManagedObjectContext *ctx) {
+        Person *person = [Person insertIntoContext:ctx];
+        person.firstName = @"Private";
+    }];
+    [stack performInMainContext:^(NSManagedObjectContext *ctx) {
+        Person *person = [Person insertIntoContext:ctx];
+        person.firstName = @"Main";
+    }];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Write"];
+    [stack saveWithCompletion:^(BOOL success, NSError *error) {
+        XCTAssertTrue(success);
+        XCTAssertNil(error);
+        XCTAssertFalse([writer.context hasChanges]);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    NSArray *people = [stack.mainObjectContext all:[Person class] where:@"firstName == %@",@"Private"];
+    XCTAssertEqual(people.count, 1);
+    XCTAssertFalse([[people.firstObject objectID] isTemporaryID]);
+    [stack performInReader:^(NSManagedObjectContext *ctx) {
+        XCTAssertEqual([Person countInContext:ctx error:NULL], 2);
+    }];
+
+    [stack performInMainContext:^(NSManagedObjectContext *ctx) {
+        [Person insertIntoContext:ctx];
+    }];
+    XCTAssertTrue([stack flush:NULL]);
+    XCTAssertFalse([[writer performAndReturnInContext:^id(NSManagedObjectContext *ctx) {
+        return @([ctx hasChanges]);
+    }] boolValue]);
+    [stack performInReader:^(NSManagedObjectContext *ctx) {
+        XCTAssertEqual([Person countInContext:ctx error:NULL], 3);
+    }];
+}
+
+@end
@@ -18,6 +18,7 @@
 @property (nonatomic, retain) NSSet *phoneNumbers;
 
 - (NSArray *)orderedPhoneNumbers;
+- (NSArray *)sortedPhoneNumbers;
 
 @end
 
@@ -27,5 +27,10 @@
                                                   ]];
     }];
 }
+- (NSArray *)sortedPhoneNumbers {
+    return [self cachedOrderedRelations:@"phoneNumbers" sortDescriptors:@[
+                                                                         [NSSortDescriptor sortDescriptorWithKey:@"name" ascending:YES selector:@selector(caseInsensitiveCompare:)]
+                                                                         ]];
+}
 
 @end
@@ -17,4 +17,8 @@
 @dynamic name;
 @dynamic person;
 
++ (NSDictionary<NSString *, NSString *> *)remoteKeyMapping {
+    return @{@"id": @"remoteID", @"label": @"name", @"phone": @"number"};
+}
+
 @end
@@ -14,6 +14,10 @@
 @dynamic firstName;
 @dynamic lastName;
 
++ (BOOL)suppressesNoOpWrites {
+    return YES;
+}
+
 - (void)awakeFromInsert {
     [super awakeFromInsert];
 